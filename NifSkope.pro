@@ -130,6 +130,8 @@ HEADERS += \
 	src/data/nifvalue.h \
 	src/gl/marker/constraints.h \
 	src/gl/marker/furniture.h \
+	src/gl/bcdecoder.h \
+	src/gl/bcencoder.h \
 	src/gl/BSMesh.h \
 	src/gl/bsshape.h \
 	src/gl/controllers.h \
@@ -145,9 +147,13 @@ HEADERS += \
 	src/gl/gltex.h \
 	src/gl/gltexloaders.h \
 	src/gl/gltools.h \
+	src/gl/keysearch.h \
+	src/gl/mipgen.h \
+	src/gl/pixelconvert.h \
 	src/gl/renderer.h \
 	src/io/material.h \
 	src/io/MeshFile.h \
+	src/io/nifloader.h \
 	src/io/nifstream.h \
 	src/lib/importex/3ds.h \
 	src/lib/nvtristripwrapper.h \
@@ -177,6 +183,7 @@ HEADERS += \
 	src/ui/widgets/nifeditors.h \
 	src/ui/widgets/nifview.h \
 	src/ui/widgets/refrbrowser.h \
+	src/ui/widgets/texbatch.h \
 	src/ui/widgets/uvedit.h \
 	src/ui/widgets/valueedit.h \
 	src/ui/widgets/xmlcheck.h \
@@ -207,6 +214,8 @@ SOURCES += \
 	src/data/nifitem.cpp \
 	src/data/niftypes.cpp \
 	src/data/nifvalue.cpp \
+	src/gl/bcdecoder.cpp \
+	src/gl/bcencoder.cpp \
 	src/gl/BSMesh.cpp \
 	src/gl/bsshape.cpp \
 	src/gl/controllers.cpp \
@@ -222,9 +231,12 @@ SOURCES += \
 	src/gl/gltex.cpp \
 	src/gl/gltexloaders.cpp \
 	src/gl/gltools.cpp \
+	src/gl/mipgen.cpp \
+	src/gl/pixelconvert.cpp \
 	src/gl/renderer.cpp \
 	src/io/material.cpp \
 	src/io/MeshFile.cpp \
+	src/io/nifloader.cpp \
 	src/io/nifstream.cpp \
 	src/lib/importex/3ds.cpp \
 	src/lib/importex/importex.cpp \
@@ -273,6 +285,7 @@ SOURCES += \
 	src/ui/widgets/nifeditors.cpp \
 	src/ui/widgets/nifview.cpp \
 	src/ui/widgets/refrbrowser.cpp \
+	src/ui/widgets/texbatch.cpp \
 	src/ui/widgets/uvedit.cpp \
 	src/ui/widgets/valueedit.cpp \
 	src/ui/widgets/xmlcheck.cpp \
@@ -158,11 +158,37 @@ doxygen.commands += doxygen $${doxyfile} $$nt
 doxygen.CONFIG += recursive
 
 
+###############################
+## Benchmarks
+###############################
+# Builds the programs in ./bench and, except on Windows, runs them
+#
+# Usage:
+#    make bench
+#______________________________
+
+bench.target = bench
+
+# Vars
+benchout = $$syspath($${OUT_PWD}/benchmarks)
+
+# COMMANDS
+
+bench.commands += $$sprintf($$QMAKE_MKDIR_CMD, $${benchout}) $$nt
+bench.commands += cd $${benchout}
+bench.commands += && $$QMAKE_QMAKE $$syspath($${PWD}/bench/bench.pro) CONFIG+=release
+bench.commands += && $(MAKE)
+unix:bench.commands += && ./bcencode/bcencode && ./keysearch/keysearch && ./pixelconvert/pixelconvert
+bench.commands += $$nt
+
+bench.CONFIG += recursive
+
+
 ###############################
 ## ADD TARGETS
 ###############################
 
-QMAKE_EXTRA_TARGETS += docs doxygen
+QMAKE_EXTRA_TARGETS += docs doxygen bench
 
 
 
@@ -173,6 +199,8 @@ unset(indoc)
 unset(out)
 unset(outdoc)
 
+unset(benchout)
+
 unset(doxyfilein)
 unset(doxyfile)
 
@@ -0,0 +1,20 @@
+TEMPLATE = app
+TARGET = bcencode
+
+QT = core
+CONFIG += console c++20
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../.. ../../src
+!*msvc*:QMAKE_CXXFLAGS += -isystem $$PWD/../../lib/gli/gli -isystem $$PWD/../../lib/gli/external
+else:INCLUDEPATH += ../../lib/gli/gli ../../lib/gli/external
+
+HEADERS += \
+	../../src/gl/bcdecoder.h \
+	../../src/gl/bcencoder.h
+
+SOURCES += \
+	main.cpp \
+	../../src/gl/bcdecoder.cpp \
+	../../src/gl/bcencoder.cpp \
+	../../lib/half.cpp
@@ -0,0 +1,350 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+#include "gl/bcdecoder.h"
+#include "gl/bcencoder.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+
+/*! @file bench/bcencode/main.cpp
+ * @brief Times bcEncode() against the scalar encoder it replaced.
+ *
+ * Images with noise, smooth gradients, flat areas and hard alpha edges are encoded
+ * to DXT1 and DXT5. The blocks must be identical to those of the scalar encoder,
+ * and the error after decoding is printed to show the quality is unchanged.
+ */
+
+namespace reference
+{
+
+static inline quint16 pack565( const int * rgb )
+{
+	return quint16( ( ( rgb[0] * 31 + 127 ) / 255 ) << 11 | ( ( rgb[1] * 63 + 127 ) / 255 ) << 5 | ( rgb[2] * 31 + 127 ) / 255 );
+}
+
+static inline void unpack565( quint16 c, int * rgb )
+{
+	int r = ( c >> 11 ) & 0x1f;
+	int g = ( c >> 5 ) & 0x3f;
+	int b = c & 0x1f;
+
+	rgb[0] = ( r << 3 ) | ( r >> 2 );
+	rgb[1] = ( g << 2 ) | ( g >> 4 );
+	rgb[2] = ( b << 3 ) | ( b >> 2 );
+}
+
+static void readTile( const quint8 * rgba, int width, int height, int bx, int by, quint8 * tile )
+{
+	for ( int y = 0; y < 4; y++ ) {
+		const quint8 * row = rgba + size_t( std::min( by * 4 + y, height - 1 ) ) * width * 4;
+
+		for ( int x = 0; x < 4; x++ )
+			memcpy( tile + ( y * 4 + x ) * 4, row + std::min( bx * 4 + x, width - 1 ) * 4, 4 );
+	}
+}
+
+static void encodeColorBlock( const quint8 * tile, quint8 * block )
+{
+	int lo[3] = { 255, 255, 255 };
+	int hi[3] = { 0, 0, 0 };
+
+	for ( int i = 0; i < 16; i++ ) {
+		for ( int c = 0; c < 3; c++ ) {
+			lo[c] = std::min<int>( lo[c], tile[4 * i + c] );
+			hi[c] = std::max<int>( hi[c], tile[4 * i + c] );
+		}
+	}
+
+	int widest = 0;
+	for ( int c = 1; c < 3; c++ ) {
+		if ( hi[c] - lo[c] > hi[widest] - lo[widest] )
+			widest = c;
+	}
+
+	int center[3];
+	for ( int c = 0; c < 3; c++ )
+		center[c] = ( lo[c] + hi[c] ) / 2;
+
+	int cov[3] = {};
+	for ( int i = 0; i < 16; i++ ) {
+		int d = tile[4 * i + widest] - center[widest];
+		for ( int c = 0; c < 3; c++ )
+			cov[c] += d * ( tile[4 * i + c] - center[c] );
+	}
+
+	for ( int c = 0; c < 3; c++ ) {
+		int inset = ( hi[c] - lo[c] ) >> 4;
+		lo[c] += inset;
+		hi[c] -= inset;
+
+		if ( cov[c] < 0 )
+			std::swap( lo[c], hi[c] );
+	}
+
+	quint16 c0 = pack565( hi );
+	quint16 c1 = pack565( lo );
+
+	if ( c0 < c1 )
+		std::swap( c0, c1 );
+
+	quint32 indices = 0;
+
+	if ( c0 != c1 ) {
+		int pal[4][3];
+		unpack565( c0, pal[0] );
+		unpack565( c1, pal[1] );
+
+		for ( int c = 0; c < 3; c++ ) {
+			pal[2][c] = ( 2 * pal[0][c] + pal[1][c] ) / 3;
+			pal[3][c] = ( pal[0][c] + 2 * pal[1][c] ) / 3;
+		}
+
+		for ( int i = 0; i < 16; i++ ) {
+			const quint8 * p = tile + 4 * i;
+			int best = 0;
+			int bestDist = INT_MAX;
+
+			for ( int k = 0; k < 4; k++ ) {
+				int dr = p[0] - pal[k][0];
+				int dg = p[1] - pal[k][1];
+				int db = p[2] - pal[k][2];
+				int dist = dr * dr + dg * dg + db * db;
+
+				if ( dist < bestDist ) {
+					bestDist = dist;
+					best = k;
+				}
+			}
+
+			indices |= quint32( best ) << ( 2 * i );
+		}
+	}
+
+	qToLittleEndian( c0, block );
+	qToLittleEndian( c1, block + 2 );
+	qToLittleEndian( indices, block + 4 );
+}
+
+static void encodeAlphaBlock( const quint8 * tile, quint8 * block )
+{
+	int lo = 255;
+	int hi = 0;
+
+	for ( int i = 0; i < 16; i++ ) {
+		lo = std::min<int>( lo, tile[4 * i + 3] );
+		hi = std::max<int>( hi, tile[4 * i + 3] );
+	}
+
+	quint64 bits = 0;
+
+	if ( hi != lo ) {
+		int pal[8] = { hi, lo };
+		for ( int k = 1; k < 7; k++ )
+			pal[k + 1] = ( ( 7 - k ) * hi + k * lo ) / 7;
+
+		for ( int i = 0; i < 16; i++ ) {
+			int a = tile[4 * i + 3];
+			int best = 0;
+			int bestDist = INT_MAX;
+
+			for ( int k = 0; k < 8; k++ ) {
+				int dist = std::abs( a - pal[k] );
+
+				if ( dist < bestDist ) {
+					bestDist = dist;
+					best = k;
+				}
+			}
+
+			bits |= quint64( best ) << ( 3 * i );
+		}
+	}
+
+	block[0] = quint8( hi );
+	block[1] = quint8( lo );
+
+	for ( int b = 0; b < 6; b++ )
+		block[2 + b] = quint8( bits >> ( 8 * b ) );
+}
+
+//! The scalar encoder used before the SSE2 version, unchanged
+static void bcEncode( bool alpha, const quint8 * rgba, int width, int height, quint8 * out )
+{
+	int blocksX = ( width + 3 ) / 4;
+	int blocksY = ( height + 3 ) / 4;
+	quint8 tile[64];
+
+	for ( int by = 0; by < blocksY; by++ ) {
+		for ( int bx = 0; bx < blocksX; bx++ ) {
+			readTile( rgba, width, height, bx, by, tile );
+
+			if ( alpha ) {
+				encodeAlphaBlock( tile, out );
+				out += 8;
+			}
+
+			encodeColorBlock( tile, out );
+			out += 8;
+		}
+	}
+}
+
+}
+
+//! A test image, filled by one of the generators below
+struct Image
+{
+	const char * name;
+	int width;
+	int height;
+	std::vector<quint8> rgba;
+};
+
+static Image makeImage( const char * name, int width, int height, int kind, std::mt19937 & rng )
+{
+	Image img = { name, width, height, std::vector<quint8>( size_t( width ) * height * 4 ) };
+	std::uniform_int_distribution<int> byte( 0, 255 );
+
+	for ( int y = 0; y < height; y++ ) {
+		for ( int x = 0; x < width; x++ ) {
+			quint8 * p = img.rgba.data() + ( size_t( y ) * width + x ) * 4;
+
+			switch ( kind ) {
+			case 0:	// Noise
+				for ( int c = 0; c < 4; c++ )
+					p[c] = quint8( byte( rng ) );
+				break;
+			case 1:	// Gradients with a little noise, like a photo texture
+				p[0] = quint8( std::clamp( x * 255 / width + byte( rng ) / 32, 0, 255 ) );
+				p[1] = quint8( std::clamp( y * 255 / height + byte( rng ) / 32, 0, 255 ) );
+				p[2] = quint8( ( x + y ) * 127 / ( width + height ) );
+				p[3] = quint8( 255 - x * 255 / width );
+				break;
+			default:	// Flat areas with cut out alpha, like foliage
+				bool inside = ( ( x / 7 ) + ( y / 5 ) ) % 3 != 0;
+				p[0] = inside ? 40 : 200;
+				p[1] = inside ? 120 : 180;
+				p[2] = inside ? 30 : 160;
+				p[3] = inside ? 255 : 0;
+				break;
+			}
+		}
+	}
+
+	return img;
+}
+
+//! Runs @p encode @p runs times, returning the fastest run in milliseconds
+template <typename F>
+static double bestOf( int runs, F encode )
+{
+	double best = 1e30;
+	for ( int r = 0; r < runs; r++ ) {
+		auto start = std::chrono::steady_clock::now();
+		encode();
+		auto stop = std::chrono::steady_clock::now();
+		best = std::min( best, std::chrono::duration<double, std::milli>( stop - start ).count() );
+	}
+	return best;
+}
+
+//! Root mean square error of the decoded blocks, over the channels the format keeps
+static double decodedError( gli::format format, const Image & img, const std::vector<quint8> & blocks, bool alpha )
+{
+	std::vector<quint8> decoded( img.rgba.size() );
+	if ( !bcDecode( format, blocks.data(), img.width, img.height, decoded.data() ) )
+		return -1.0;
+
+	double sum = 0.0;
+	int channels = alpha ? 4 : 3;
+	for ( size_t i = 0; i < img.rgba.size(); i += 4 ) {
+		for ( int c = 0; c < channels; c++ ) {
+			double d = double( img.rgba[i + c] ) - decoded[i + c];
+			sum += d * d;
+		}
+	}
+	return std::sqrt( sum / ( img.rgba.size() / 4 * channels ) );
+}
+
+int main()
+{
+	std::mt19937 rng( 1 );
+	bool ok = true;
+
+	std::vector<Image> images;
+	images.push_back( makeImage( "noise", 1024, 1024, 0, rng ) );
+	images.push_back( makeImage( "gradient", 1024, 1024, 1, rng ) );
+	images.push_back( makeImage( "cutout", 1024, 1024, 2, rng ) );
+	images.push_back( makeImage( "noise odd", 37, 11, 0, rng ) );
+	images.push_back( makeImage( "tiny", 1, 3, 0, rng ) );
+
+	std::printf( "%-10s %-5s %10s %12s %10s %8s %6s\n", "image", "fmt", "size", "reference ms", "bcEncode ms", "speedup", "rmse" );
+	for ( const Image & img : images ) {
+		for ( bool alpha : { false, true } ) {
+			gli::format format = alpha ? gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16 : gli::FORMAT_RGB_DXT1_UNORM_BLOCK8;
+			size_t size = size_t( ( img.width + 3 ) / 4 ) * ( ( img.height + 3 ) / 4 ) * ( alpha ? 16 : 8 );
+
+			std::vector<quint8> expected( size );
+			std::vector<quint8> actual( size, 0xcd );
+
+			int runs = ( img.width * img.height > 4096 ) ? 5 : 1000;
+			double refMs = bestOf( runs, [&]() {
+				reference::bcEncode( alpha, img.rgba.data(), img.width, img.height, expected.data() );
+			} );
+			double newMs = bestOf( runs, [&]() {
+				bcEncode( format, img.rgba.data(), img.width, img.height, actual.data() );
+			} );
+
+			bool same = ( expected == actual );
+			ok = ok && same;
+
+			std::printf( "%-10s %-5s %4dx%-5d %12.3f %10.3f %7.1fx %6.2f%s\n", img.name, alpha ? "DXT5" : "DXT1",
+						 img.width, img.height, refMs, newMs, refMs / newMs, decodedError( format, img, actual, alpha ),
+						 same ? "" : "  DIFFERS" );
+		}
+	}
+
+	std::printf( ok ? "bcEncode matches the reference\n" : "bcEncode DIFFERS from the reference\n" );
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,19 @@
+###############################
+## Benchmarks
+###############################
+#
+# Standalone programs timing hot paths of NifSkope against the simpler code
+# they replaced, and checking that both give the same results.
+#
+# "make bench" in the NifSkope build directory builds and runs them, or by hand:
+#	qmake ../bench/bench.pro CONFIG+=release && make
+#	./bcencode/bcencode
+#	./keysearch/keysearch
+#	./pixelconvert/pixelconvert
+
+TEMPLATE = subdirs
+
+SUBDIRS += \
+	bcencode \
+	keysearch \
+	pixelconvert
@@ -0,0 +1,11 @@
+TEMPLATE = app
+TARGET = keysearch
+
+CONFIG += console c++20
+CONFIG -= qt app_bundle
+
+INCLUDEPATH += ../../src
+
+HEADERS += ../../src/gl/keysearch.h
+
+SOURCES += main.cpp
@@ -0,0 +1,204 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+#include "gl/keysearch.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+
+/*! @file bench/keysearch/main.cpp
+ * @brief Times findKeys() against the plain walk from the previous key.
+ *
+ * Each track is played back at 60 fps, where the walk is hard to beat, and then
+ * scrubbed to random times, where it has to cross the track. Every lookup is also
+ * checked against the walk, including on tracks where several keys share a time.
+ *
+ * The tracks are synthetic rather than read from a .kf, so that the benchmark doesn't need
+ * NifModel and Qt: keys 1/30 s apart, the rate most exported animations are sampled at,
+ * with and without keys repeating the time before them like those at the seams of clips.
+ */
+
+struct Key
+{
+	float time;
+	float value;
+};
+
+//! The lookup used by ValueInterpolator::getFrame before findKeys()
+static void walkKeys( const Key * keyData, int iKey, float inTime, const Key *& pKey1, const Key *& pKey2 )
+{
+	const Key * pKey = keyData + iKey;
+	if ( pKey->time < inTime ) {
+		do {
+			pKey++;
+		} while( pKey->time < inTime );
+
+		pKey1 = ( pKey->time == inTime ) ? pKey : ( pKey - 1 );
+		pKey2 = pKey;
+
+	} else if ( pKey->time > inTime ) {
+		do {
+			pKey--;
+		} while( pKey->time > inTime );
+
+		pKey1 = pKey;
+		pKey2 = ( pKey->time == inTime ) ? pKey : ( pKey + 1 );
+
+	} else {
+		pKey1 = pKey2 = pKey;
+	}
+}
+
+//! A track of @p nKeys keys 1/30 s apart, where every @p dupEvery th key repeats the time before it
+static std::vector<Key> makeTrack( int nKeys, int dupEvery )
+{
+	std::vector<Key> keys( nKeys );
+	float t = 0.0f;
+	for ( int i = 0; i < nKeys; i++ ) {
+		if ( i > 0 && !( dupEvery > 0 && i % dupEvery == 0 ) )
+			t += 1.0f / 30.0f;
+		keys[i] = { t, float( i ) };
+	}
+	return keys;
+}
+
+//! Times for playing back at 60 fps, including every key time, and for random times
+static std::vector<float> makeTimes( const std::vector<Key> & keys, bool scrub, std::mt19937 & rng )
+{
+	float start = keys.front().time;
+	float stop = keys.back().time;
+	std::vector<float> times;
+	if ( scrub ) {
+		std::uniform_int_distribution<size_t> pick( 0, keys.size() - 1 );
+		std::uniform_real_distribution<float> range( start, stop );
+		for ( int i = 0; i < 200000; i++ )
+			times.push_back( ( i % 4 ) ? range( rng ) : keys[pick( rng )].time );
+	} else {
+		while ( times.size() < 200000 ) {
+			for ( float t = start; t < stop; t += 1.0f / 60.0f )
+				times.push_back( t );
+			for ( const Key & k : keys )
+				times.push_back( k.time );
+		}
+	}
+	return times;
+}
+
+//! Looks up every time in turn like getFrame does, returning the nanoseconds per lookup
+template <typename F>
+static double timeLookups( const std::vector<Key> & keys, const std::vector<float> & times, F lookup, long long & checksum )
+{
+	const Key * keyData = keys.data();
+	int lastKey = int( keys.size() ) - 1;
+	int iKey = 0;
+
+	auto start = std::chrono::steady_clock::now();
+	for ( float t : times ) {
+		const Key * pKey1;
+		const Key * pKey2;
+		if ( t <= keyData[0].time ) {
+			pKey1 = pKey2 = keyData;
+		} else if ( t >= keyData[lastKey].time ) {
+			pKey1 = pKey2 = keyData + lastKey;
+		} else {
+			lookup( keyData, lastKey, iKey, t, pKey1, pKey2 );
+		}
+		iKey = int( pKey1 - keyData );
+		checksum += iKey + ( pKey2 - keyData );
+	}
+	auto stop = std::chrono::steady_clock::now();
+
+	return std::chrono::duration<double, std::nano>( stop - start ).count() / times.size();
+}
+
+//! Whether findKeys() gives the walk's keys for every time, starting from the same key each time
+static bool checkTrack( const std::vector<Key> & keys, const std::vector<float> & times )
+{
+	const Key * keyData = keys.data();
+	int lastKey = int( keys.size() ) - 1;
+	int iKey = 0;
+
+	for ( float t : times ) {
+		if ( t <= keyData[0].time || t >= keyData[lastKey].time )
+			continue;
+
+		const Key * walk1;
+		const Key * walk2;
+		const Key * find1;
+		const Key * find2;
+		walkKeys( keyData, iKey, t, walk1, walk2 );
+		findKeys( keyData, lastKey, iKey, t, find1, find2 );
+		if ( walk1 != find1 || walk2 != find2 ) {
+			std::printf( "  mismatch at t=%g from key %d: walk %d-%d, findKeys %d-%d\n", t, iKey,
+						 int( walk1 - keyData ), int( walk2 - keyData ), int( find1 - keyData ), int( find2 - keyData ) );
+			return false;
+		}
+		iKey = int( walk1 - keyData );
+	}
+	return true;
+}
+
+int main()
+{
+	std::mt19937 rng( 1 );
+	bool ok = true;
+
+	std::printf( "%6s %5s %-8s %12s %12s\n", "keys", "dups", "times", "walk ns", "findKeys ns" );
+	for ( int nKeys : { 16, 120, 1000, 10000 } ) {
+		for ( int dupEvery : { 0, 5 } ) {
+			std::vector<Key> keys = makeTrack( nKeys, dupEvery );
+			for ( bool scrub : { false, true } ) {
+				std::vector<float> times = makeTimes( keys, scrub, rng );
+				ok = checkTrack( keys, times ) && ok;
+
+				long long sumWalk = 0, sumFind = 0;
+				double walkNs = timeLookups( keys, times, []( const Key * k, int, int i, float t, const Key *& p1, const Key *& p2 ) {
+					walkKeys( k, i, t, p1, p2 );
+				}, sumWalk );
+				double findNs = timeLookups( keys, times, []( const Key * k, int n, int i, float t, const Key *& p1, const Key *& p2 ) {
+					findKeys( k, n, i, t, p1, p2 );
+				}, sumFind );
+				ok = ok && sumWalk == sumFind;
+
+				std::printf( "%6d %5s %-8s %12.1f %12.1f\n", nKeys, dupEvery ? "yes" : "no",
+							 scrub ? "scrub" : "playback", walkNs, findNs );
+			}
+		}
+	}
+
+	std::printf( ok ? "findKeys matches the walk\n" : "findKeys DIFFERS from the walk\n" );
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,14 @@
+TEMPLATE = app
+TARGET = pixelconvert
+
+QT = core
+CONFIG += console c++20
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../../src
+
+HEADERS += ../../src/gl/pixelconvert.h
+
+SOURCES += \
+	main.cpp \
+	../../src/gl/pixelconvert.cpp
@@ -42,6 +42,16 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QFile>
 #include <QFileInfo>
 #include <QStringBuilder>
+#include <QtEndian>
+
+#include <algorithm>
+#include <future>
+#include <iterator>
+#include <vector>
+
+
+//! Minimum unpacked size of a BA2 texture chunk to be inflated on its own thread
+static const quint32 PARALLEL_CHUNK_SIZE = 256 * 1024;
 
 
 // see bsa.h
@@ -124,16 +134,188 @@ QByteArray gUncompress( const char * data, const int size )
 	return result;
 }
 
+//! Inflates a zlib or gzip stream into a preallocated buffer; returns the number of bytes written or -1
+static int gUncompressInto( const char * data, const int size, char * out, const int outSize )
+{
+	z_stream strm = {};
+	strm.avail_in = size;
+	strm.next_in = (Bytef*)(data);
+	strm.avail_out = outSize;
+	strm.next_out = (Bytef*)(out);
+
+	if ( inflateInit2( &strm, 15 + 32 ) != Z_OK ) // gzip decoding
+		return -1;
+
+	int ret = inflate( &strm, Z_FINISH );
+	int written = outSize - strm.avail_out;
+	inflateEnd( &strm );
+
+	if ( ret != Z_STREAM_END && ret != Z_BUF_ERROR )
+		return -1;
+
+	return written;
+}
+
 QByteArray gUncompress( const QByteArray & data, const int size )
 {
 	if ( data.size() <= 4 ) {
-		qWarning( "gUncompress: Input data is truncated" );
+		qDebug( "gUncompress: Input data is truncated" );
 		return QByteArray();
 	}
 
 	return gUncompress( data.data(), size );
 }
 
+//! Writes the DDS header for a BA2 texture whose mip chain starts at firstMip
+static bool F4TexDDSHeader( const F4TexInfo & info, int firstMip, QByteArray & content )
+{
+	quint32 width = std::max( info.width >> firstMip, 1 );
+	quint32 height = std::max( info.height >> firstMip, 1 );
+	quint32 numMips = std::max( info.numMips - firstMip, 1 );
+
+	DDS_HEADER ddsHeader = {};
+	DDS_HEADER_DXT10 dx10Header = {};
+
+	bool dx10 = false;
+
+	ddsHeader.dwSize = sizeof( ddsHeader );
+	ddsHeader.dwHeaderFlags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_LINEARSIZE | DDS_HEADER_FLAGS_MIPMAP;
+	ddsHeader.dwHeight = height;
+	ddsHeader.dwWidth = width;
+	ddsHeader.dwMipMapCount = numMips;
+	ddsHeader.ddspf.dwSize = sizeof( DDS_PIXELFORMAT );
+	ddsHeader.dwSurfaceFlags = DDS_SURFACE_FLAGS_TEXTURE | DDS_SURFACE_FLAGS_MIPMAP;
+
+	if ( info.unk16 == 2049 )
+		ddsHeader.dwCubemapFlags = DDS_CUBEMAP_ALLFACES;
+
+	bool supported = true;
+
+	switch ( info.format ) {
+	case DXGI_FORMAT_BC1_UNORM:
+		ddsHeader.ddspf.dwFlags = DDS_FOURCC;
+		ddsHeader.ddspf.dwFourCC = MAKEFOURCC( 'D', 'X', 'T', '1' );
+		ddsHeader.dwPitchOrLinearSize = width * height / 2;	// 4bpp
+		break;
+
+	case DXGI_FORMAT_BC2_UNORM:
+		ddsHeader.ddspf.dwFlags = DDS_FOURCC;
+		ddsHeader.ddspf.dwFourCC = MAKEFOURCC( 'D', 'X', 'T', '3' );
+		ddsHeader.dwPitchOrLinearSize = width * height;	// 8bpp
+		break;
+
+	case DXGI_FORMAT_BC3_UNORM:
+		ddsHeader.ddspf.dwFlags = DDS_FOURCC;
+		ddsHeader.ddspf.dwFourCC = MAKEFOURCC( 'D', 'X', 'T', '5' );
+		ddsHeader.dwPitchOrLinearSize = width * height;	// 8bpp
+		break;
+
+	case DXGI_FORMAT_BC5_UNORM:
+		ddsHeader.ddspf.dwFlags = DDS_FOURCC;
+		ddsHeader.ddspf.dwFourCC = MAKEFOURCC( 'A', 'T', 'I', '2' );
+		ddsHeader.dwPitchOrLinearSize = width * height;	// 8bpp
+		break;
+
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+		ddsHeader.ddspf.dwFlags = DDS_RGBA;
+		ddsHeader.ddspf.dwRGBBitCount = 32;
+		ddsHeader.ddspf.dwRBitMask = 0x00FF0000;
+		ddsHeader.ddspf.dwGBitMask = 0x0000FF00;
+		ddsHeader.ddspf.dwBBitMask = 0x000000FF;
+		ddsHeader.ddspf.dwABitMask = 0xFF000000;
+		ddsHeader.dwPitchOrLinearSize = width * height * 4;	// 32bpp
+		break;
+
+	case DXGI_FORMAT_R8_UNORM:
+		ddsHeader.ddspf.dwFlags = DDS_RGB;
+		ddsHeader.ddspf.dwRGBBitCount = 8;
+		ddsHeader.ddspf.dwRBitMask = 0xFF;
+		ddsHeader.dwPitchOrLinearSize = width * height;	// 8bpp
+		break;
+
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+		ddsHeader.ddspf.dwFlags = DDS_FOURCC;
+		ddsHeader.ddspf.dwFourCC = MAKEFOURCC( 'D', 'X', '1', '0' );
+		ddsHeader.dwPitchOrLinearSize = width * height / 2;
+
+		dx10 = true;
+		dx10Header.dxgiFormat = DXGI_FORMAT( info.format );
+		break;
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		ddsHeader.ddspf.dwFlags = DDS_FOURCC;
+		ddsHeader.ddspf.dwFourCC = MAKEFOURCC( 'D', 'X', '1', '0' );
+		ddsHeader.dwPitchOrLinearSize = width * height * 4;
+
+		dx10 = true;
+		dx10Header.dxgiFormat = DXGI_FORMAT( info.format );
+		break;
+
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		ddsHeader.ddspf.dwFlags = DDS_FOURCC;
+		ddsHeader.ddspf.dwFourCC = MAKEFOURCC( 'D', 'X', '1', '0' );
+		ddsHeader.dwPitchOrLinearSize = width * height;
+
+		dx10 = true;
+		dx10Header.dxgiFormat = DXGI_FORMAT( info.format );
+		break;
+	default:
+		supported = false;
+		break;
+	}
+
+	if ( !supported )
+		return false;
+
+	char dds[sizeof( ddsHeader )];
+	memcpy( dds, &ddsHeader, sizeof( ddsHeader ) );
+
+	int hdrSize = sizeof( ddsHeader ) + 4;
+
+	content.clear();
+	content.append( QByteArray::fromStdString( "DDS " ) );
+	content.append( QByteArray::fromRawData( dds, sizeof( ddsHeader ) ) );
+	Q_ASSERT( content.size() == hdrSize );
+
+	if ( dx10 ) {
+		dx10Header.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+		dx10Header.miscFlag = 0;
+		dx10Header.arraySize = 1;
+		dx10Header.miscFlags2 = 0;
+
+		char dds2[sizeof( dx10Header )];
+		memcpy( dds2, &dx10Header, sizeof( dx10Header ) );
+		content.append( QByteArray::fromRawData( dds2, sizeof( dx10Header ) ) );
+	}
+
+	return true;
+}
+
+//! Returns the first chunk of a BA2 texture without mips larger than maxSize, or -1 if unsupported
+static int F4TexFirstChunk( const F4Tex & tex, int maxSize )
+{
+	// Cubemap chunks hold all faces, they cannot be split by mip
+	if ( maxSize <= 0 || tex.chunks.isEmpty() || tex.header.unk16 == 2049 )
+		return -1;
+
+	int mip = 0;
+	while ( mip + 1 < tex.header.numMips && std::max( tex.header.width >> mip, tex.header.height >> mip ) > maxSize )
+		mip++;
+
+	for ( int i = 0; i < tex.chunks.count(); i++ ) {
+		if ( tex.chunks[i].startMip >= mip )
+			return i;
+	}
+
+	// The smallest chunk still holds larger mips, settle for it
+	return tex.chunks.count() - 1;
+}
+
 // see bsa.h
 BSA::BSA( const QString & filename )
 	: FSArchiveFile(), bsa( filename ), bsaInfo( QFileInfo(filename) ), status( "initialized" )
@@ -141,6 +323,7 @@ BSA::BSA( const QString & filename )
 	bsaPath = bsaInfo.absoluteFilePath();
 	bsaBase = bsaInfo.absolutePath();
 	bsaName = bsaInfo.fileName();
+	cacheId = bsaPath % QChar( '@' ) % QString::number( bsaInfo.lastModified().toMSecsSinceEpoch() );
 
 	root = new BSAFolder;
 }
@@ -476,33 +659,128 @@ qint64 BSA::fileSize( const QString & fn ) const
 
 // see bsa.h
 bool BSA::fileContents( const QString & fn, QByteArray & content )
+{
+	if ( !hasFile( fn ) )
+		return false;
+
+	if ( FSArchiveCache::lookup( cacheId, fn, content ) )
+		return true;
+
+	if ( !readFileContents( fn, content ) )
+		return false;
+
+	FSArchiveCache::insert( cacheId, fn, content );
+	return true;
+}
+
+// see bsa.h
+bool BSA::textureContents( const QString & fn, QByteArray & content, int maxSize )
+{
+	const BSAFile * file = getFile( fn );
+	if ( !file )
+		return false;
+
+	int firstChunk = F4TexFirstChunk( file->tex, maxSize );
+	if ( firstChunk <= 0 )
+		return false;
+
+	const QString key = fn % QChar( '#' ) % QString::number( firstChunk );
+	if ( FSArchiveCache::lookup( cacheId, key, content ) )
+		return true;
+
+	if ( !readTexture( file, firstChunk, content ) )
+		return false;
+
+	FSArchiveCache::insert( cacheId, key, content );
+	return true;
+}
+
+// see bsa.h
+bool BSA::fileHeader( const QString & fn, QByteArray & content, int size )
+{
+	const BSAFile * file = getFile( fn );
+	if ( !file )
+		return false;
+
+	if ( file->tex.chunks.count() ) {
+		if ( !F4TexDDSHeader( file->tex.header, 0, content ) )
+			return false;
+
+		content.truncate( size );
+		return true;
+	}
+
+	// Compressed files have to be inflated from the start anyway, and are then cached
+	bool packed = ( file->sizeFlags > 0 && (file->compressed() ^ compressToggle) ) || file->packedLength > 0;
+	if ( packed ) {
+		if ( !fileContents( fn, content ) )
+			return false;
+
+		content.truncate( size );
+		return true;
+	}
+
+	QMutexLocker lock( & bsaMutex );
+	if ( !bsa.seek( file->offset ) )
+		return false;
+
+	qint64 filesz = file->size();
+	if ( namePrefix ) {
+		quint8 len;
+		if ( bsa.read( (char *) &len, 1 ) != 1 || !bsa.seek( file->offset + 1 + len ) )
+			return false;
+
+		filesz -= len + 1;
+	}
+
+	content.resize( int( std::min<qint64>( filesz, size ) ) );
+	return bsa.read( content.data(), content.size() ) == content.size();
+}
+
+// see bsa.h
+bool BSA::readFileContents( const QString & fn, QByteArray & content )
 {
 	//qDebug() << "entering fileContents for" << fn;
 	if ( const BSAFile * file = getFile( fn ) )
 	{
+		if ( file->tex.chunks.count() )
+			return readTexture( file, 0, content );
+
 		QMutexLocker lock( & bsaMutex );
 		if ( bsa.seek( file->offset ) )
 		{
 			qint64 filesz = file->size();
 			bool ok = true;
-			if (namePrefix) {
-				char len;
-				ok = bsa.read(&len, 1);
-				filesz -= len + 1;
-				if (ok) ok = bsa.seek( file->offset + 1 + len );
+			if ( namePrefix ) {
+				quint8 len;
+				ok = bsa.read( (char *) &len, 1 ) == 1 && len + 1 <= filesz;
+				if ( ok ) {
+					filesz -= len + 1;
+					ok = bsa.seek( file->offset + 1 + len );
+				}
 			}
 
+			bool compressed = file->sizeFlags > 0 && (file->compressed() ^ compressToggle);
+
 			quint32 filesize = filesz;
-			if ( version == SSE_BSAHEADER_VERSION && file->sizeFlags > 0 && (file->compressed() ^ compressToggle) ) {
-				ok = bsa.read( (char*)&filesize, 4 );
-				filesz -= 4;
+			if ( ok && version == SSE_BSAHEADER_VERSION && compressed ) {
+				ok = filesz >= 4 && bsa.read( (char*)&filesize, 4 ) == 4;
+				if ( ok )
+					filesz -= 4;
 			}
 
 			content.resize( filesz );
 			if ( ok && bsa.read( content.data(), filesz ) == filesz ) {
-				if ( file->sizeFlags > 0 && (file->compressed() ^ compressToggle) ) {
+				// Anything short of the stored uncompressed size fails the read, it would be cached
+				if ( compressed ) {
 					// BSA
 					if ( version != SSE_BSAHEADER_VERSION ) {
+						if ( filesz <= 4 ) {
+							content.clear();
+							return false;
+						}
+
+						filesize = qFromLittleEndian<quint32>( (const uchar *) content.constData() );
 						content.remove( 0, 4 );
 						QByteArray tmp3( content );
 
@@ -518,176 +796,131 @@ bool BSA::fileContents( const QString & fn, QByteArray & content )
 
 						LZ4F_decompressOptions_t options = {};
 
-						LZ4F_decompress( dCtx, tmp.data(), &dstSize, content.data(), &srcSize, &options );
-						LZ4F_errorCode_t error = LZ4F_freeDecompressionContext( dCtx );
-						if ( error ) {
-							// TODO: Message logger
-							qDebug() << fn << "Error Code: " << error;
+						size_t result = LZ4F_decompress( dCtx, tmp.data(), &dstSize, content.data(), &srcSize, &options );
+						LZ4F_freeDecompressionContext( dCtx );
+						if ( LZ4F_isError( result ) || dstSize != filesize ) {
+							qDebug() << fn << "LZ4 error:" << ( LZ4F_isError( result ) ? LZ4F_getErrorName( result ) : "truncated" );
+							content.clear();
+							return false;
 						}
 
 						content = tmp;
 					}
+
+					if ( quint32( content.size() ) != filesize ) {
+						content.clear();
+						return false;
+					}
 				} else if ( file->packedLength > 0 && !file->tex.chunks.count() ) {
 					// General BA2
 					QByteArray tmp( content );
-					content.resize( file->unpackedLength );
 					content = gUncompress( tmp, file->packedLength );
-				} else if ( file->tex.chunks.count() ) {
-					// Fill DDS Header
-					DDS_HEADER ddsHeader = {};
-					DDS_HEADER_DXT10 dx10Header = {};
-
-					bool dx10 = false;
-
-					ddsHeader.dwSize = sizeof( ddsHeader );
-					ddsHeader.dwHeaderFlags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_LINEARSIZE | DDS_HEADER_FLAGS_MIPMAP;
-					ddsHeader.dwHeight = file->tex.header.height;
-					ddsHeader.dwWidth = file->tex.header.width;
-					ddsHeader.dwMipMapCount = file->tex.header.numMips;
-					ddsHeader.ddspf.dwSize = sizeof( DDS_PIXELFORMAT );
-					ddsHeader.dwSurfaceFlags = DDS_SURFACE_FLAGS_TEXTURE | DDS_SURFACE_FLAGS_MIPMAP;
-
-					if ( file->tex.header.unk16 == 2049 )
-						ddsHeader.dwCubemapFlags = DDS_CUBEMAP_ALLFACES;
-
-					bool supported = true;
-
-					switch ( file->tex.header.format ) {
-					case DXGI_FORMAT_BC1_UNORM:
-						ddsHeader.ddspf.dwFlags = DDS_FOURCC;
-						ddsHeader.ddspf.dwFourCC = MAKEFOURCC( 'D', 'X', 'T', '1' );
-						ddsHeader.dwPitchOrLinearSize = file->tex.header.width * file->tex.header.height / 2;	// 4bpp
-						break;
-
-					case DXGI_FORMAT_BC2_UNORM:
-						ddsHeader.ddspf.dwFlags = DDS_FOURCC;
-						ddsHeader.ddspf.dwFourCC = MAKEFOURCC( 'D', 'X', 'T', '3' );
-						ddsHeader.dwPitchOrLinearSize = file->tex.header.width * file->tex.header.height;	// 8bpp
-						break;
-
-					case DXGI_FORMAT_BC3_UNORM:
-						ddsHeader.ddspf.dwFlags = DDS_FOURCC;
-						ddsHeader.ddspf.dwFourCC = MAKEFOURCC( 'D', 'X', 'T', '5' );
-						ddsHeader.dwPitchOrLinearSize = file->tex.header.width * file->tex.header.height;	// 8bpp
-						break;
-
-					case DXGI_FORMAT_BC5_UNORM:
-						ddsHeader.ddspf.dwFlags = DDS_FOURCC;
-						ddsHeader.ddspf.dwFourCC = MAKEFOURCC( 'A', 'T', 'I', '2' );
-						ddsHeader.dwPitchOrLinearSize = file->tex.header.width * file->tex.header.height;	// 8bpp
-						break;
-
-					case DXGI_FORMAT_B8G8R8A8_UNORM:
-						ddsHeader.ddspf.dwFlags = DDS_RGBA;
-						ddsHeader.ddspf.dwRGBBitCount = 32;
-						ddsHeader.ddspf.dwRBitMask = 0x00FF0000;
-						ddsHeader.ddspf.dwGBitMask = 0x0000FF00;
-						ddsHeader.ddspf.dwBBitMask = 0x000000FF;
-						ddsHeader.ddspf.dwABitMask = 0xFF000000;
-						ddsHeader.dwPitchOrLinearSize = file->tex.header.width * file->tex.header.height * 4;	// 32bpp
-						break;
-
-					case DXGI_FORMAT_R8_UNORM:
-						ddsHeader.ddspf.dwFlags = DDS_RGB;
-						ddsHeader.ddspf.dwRGBBitCount = 8;
-						ddsHeader.ddspf.dwRBitMask = 0xFF;
-						ddsHeader.dwPitchOrLinearSize = file->tex.header.width * file->tex.header.height;	// 8bpp
-						break;
-
-					case DXGI_FORMAT_BC4_UNORM:
-					case DXGI_FORMAT_BC1_UNORM_SRGB:
-						ddsHeader.ddspf.dwFlags = DDS_FOURCC;
-						ddsHeader.ddspf.dwFourCC = MAKEFOURCC( 'D', 'X', '1', '0' );
-						ddsHeader.dwPitchOrLinearSize = file->tex.header.width * file->tex.header.height / 2;
-
-						dx10 = true;
-						dx10Header.dxgiFormat = DXGI_FORMAT( file->tex.header.format );
-						break;
-					case DXGI_FORMAT_R8G8B8A8_UNORM:
-					case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
-						ddsHeader.ddspf.dwFlags = DDS_FOURCC;
-						ddsHeader.ddspf.dwFourCC = MAKEFOURCC( 'D', 'X', '1', '0' );
-						ddsHeader.dwPitchOrLinearSize = file->tex.header.width * file->tex.header.height * 4;
-
-						dx10 = true;
-						dx10Header.dxgiFormat = DXGI_FORMAT( file->tex.header.format );
-						break;
-
-					case DXGI_FORMAT_BC7_UNORM:
-					case DXGI_FORMAT_BC5_SNORM:
-					case DXGI_FORMAT_BC2_UNORM_SRGB:
-					case DXGI_FORMAT_BC3_UNORM_SRGB:
-					case DXGI_FORMAT_BC7_UNORM_SRGB:
-						ddsHeader.ddspf.dwFlags = DDS_FOURCC;
-						ddsHeader.ddspf.dwFourCC = MAKEFOURCC( 'D', 'X', '1', '0' );
-						ddsHeader.dwPitchOrLinearSize = file->tex.header.width * file->tex.header.height;
-
-						dx10 = true;
-						dx10Header.dxgiFormat = DXGI_FORMAT( file->tex.header.format );
-						break;
-					default:
-						supported = false;
-						break;
-					}
 
-					if ( !supported )
+					if ( quint32( content.size() ) != file->unpackedLength ) {
+						content.clear();
 						return false;
+					}
+				}
 
-					char dds[sizeof( ddsHeader )];
-					memcpy( dds, &ddsHeader, sizeof( ddsHeader ) );
-
-					int texSize = 0; // = file->unpackedLength;
-					int hdrSize = sizeof( ddsHeader ) + 4;
+				return true;
+			}
+		}
+	}
+	content.clear();
+	return false;
+}
 
-					content.clear();
-					content.append( QByteArray::fromStdString( "DDS " ) );
-					content.append( QByteArray::fromRawData( dds, sizeof( ddsHeader ) ) );
-					Q_ASSERT( content.size() == hdrSize );
+// see bsa.h
+bool BSA::readTexture( const BSAFile * file, int firstChunk, QByteArray & content )
+{
+	const F4TexInfo & info = file->tex.header;
+	const QVector<F4TexChunk> chunks = file->tex.chunks.mid( firstChunk );
+	if ( !F4TexDDSHeader( info, chunks.first().startMip, content ) )
+		return false;
 
-					if ( dx10 ) {
-						dx10Header.resourceDimension = DDS_DIMENSION_TEXTURE2D;
-						dx10Header.miscFlag = 0;
-						dx10Header.arraySize = 1;
-						dx10Header.miscFlags2 = 0;
+	QMutexLocker lock( & bsaMutex );
 
-						char dds2[sizeof( dx10Header )];
-						memcpy( dds2, &dx10Header, sizeof( dx10Header ) );
-						content.append( QByteArray::fromRawData( dds2, sizeof( dx10Header ) ) );
-					}
+	// Preallocate the output so every chunk has a known destination
+	QVector<int> chunkOffsets;
+	chunkOffsets.reserve( chunks.count() );
+	int texSize = 0;
+	for ( const F4TexChunk & chunk : chunks ) {
+		chunkOffsets.append( content.size() + texSize );
+		texSize += chunk.unpackedSize;
+	}
+	content.resize( content.size() + texSize );
+
+	// Read the chunks sequentially; stored chunks go straight into the output
+	QVector<QByteArray> packedChunks( chunks.count() );
+	for ( int i = 0; i < chunks.count(); i++ ) {
+		const F4TexChunk & chunk = chunks[i];
+		if ( !bsa.seek( chunk.offset ) ) {
+			qDebug() << "Seek error at " << chunk.offset;
+			content.clear();
+			return false;
+		}
 
-					// Start at 1st chunk now
-					for ( int i = 0; i < file->tex.chunks.count(); i++ ) {
-						const F4TexChunk & chunk = file->tex.chunks[i];
-						if ( bsa.seek( chunk.offset ) ) {
-							QByteArray chunkData;
-
-							if ( chunk.packedSize > 0 ) {
-								chunkData.resize( chunk.packedSize );
-								if ( bsa.read( chunkData.data(), chunk.packedSize ) == chunk.packedSize ) {
-									chunkData = gUncompress( chunkData, chunk.packedSize );
-
-									if ( chunkData.size() != chunk.unpackedSize )
-										qCritical() << "Size does not match at " << chunk.offset;
-								}
-							} else if ( !(bsa.read( chunkData.data(), chunk.unpackedSize ) == chunk.unpackedSize) ) {
-								qCritical() << "Size does not match at " << chunk.offset;
-							}
-							texSize += chunk.unpackedSize;
-
-							content.append( chunkData );
-							//Q_ASSERT( content.size() - hdrSize == texSize );
-						} else {
-							qCritical() << "Seek error";
-						}
-					}
+		bool ok;
+		if ( chunk.packedSize > 0 ) {
+			packedChunks[i].resize( chunk.packedSize );
+			ok = bsa.read( packedChunks[i].data(), chunk.packedSize ) == chunk.packedSize;
+		} else {
+			ok = bsa.read( content.data() + chunkOffsets[i], chunk.unpackedSize ) == chunk.unpackedSize;
+		}
 
-				}
+		if ( !ok ) {
+			qDebug() << "Size does not match at " << chunk.offset;
+			content.clear();
+			return false;
+		}
+	}
 
-				return true;
-			}
+	// The archive is no longer needed, let other readers in while inflating
+	lock.unlock();
+
+	char * texData = content.data();
+	auto inflateChunk = [&]( int i ) {
+		const F4TexChunk & chunk = chunks[i];
+		const QByteArray & packed = packedChunks.at( i );
+		if ( packed.isEmpty() )
+			return true;
+
+		int size = gUncompressInto( packed.constData(), packed.size(),
+									texData + chunkOffsets.at( i ), chunk.unpackedSize );
+		return size == int( chunk.unpackedSize );
+	};
+
+	// Inflate large chunks concurrently, each into its own range of the output
+	std::vector<std::future<bool>> jobs;
+	QVector<int> jobChunks;
+	QVector<int> failedChunks;
+	int numPacked = std::count_if( packedChunks.cbegin(), packedChunks.cend(),
+								   []( const QByteArray & c ) { return !c.isEmpty(); } );
+	bool ok = true;
+	for ( int i = 0; i < packedChunks.count(); i++ ) {
+		if ( numPacked > 1 && chunks[i].unpackedSize >= PARALLEL_CHUNK_SIZE ) {
+			jobs.push_back( std::async( std::launch::async, inflateChunk, i ) );
+			jobChunks.append( i );
+		} else if ( !inflateChunk( i ) ) {
+			failedChunks.append( i );
 		}
 	}
-	return false;
+	// Wait for every job even after a failure, they all write into content
+	for ( size_t j = 0; j < jobs.size(); j++ ) {
+		if ( !jobs[j].get() )
+			failedChunks.append( jobChunks.at( int( j ) ) );
+	}
+
+	// Logged here rather than in the jobs, and without a message box: this may not be the GUI thread
+	for ( int i : failedChunks ) {
+		qDebug() << "Size does not match at " << chunks.at( i ).offset;
+		ok = false;
+	}
+
+	// Never hand out a partially decoded texture, it would end up in the cache
+	if ( !ok )
+		content.clear();
+	return ok;
 }
 
 // see bsa.h
@@ -801,90 +1034,315 @@ QDateTime BSA::fileTime( const QString & ) const
 	return bsaInfo.created( );
 }
 
-bool BSA::scan( const BSA::BSAFolder * folder, QStandardItem * item, QString path )
+bool BSA::fillModel( BSAModel * bsaModel, const QString & folder )
 {
-	if ( !folder || folder->children.count() == 0 )
-		return false;
+	return bsaModel->fill( getFolder( folder ), folder );
+}
+
+
+BSAModel::BSAModel( QObject * parent )
+	: QAbstractItemModel( parent )
+{
+
+}
+
+void BSAModel::clear()
+{
+	beginResetModel();
+	entries.clear();
+	topLevel.clear();
+	trigrams.clear();
+	endResetModel();
+}
+
+bool BSAModel::fill( const BSA::BSAFolder * folder, const QString & path )
+{
+	beginResetModel();
+	entries.clear();
+	topLevel.clear();
+	trigrams.clear();
+
+	if ( folder )
+		topLevel = addFolders( folder, -1, path );
 
-	auto& children = folder->children;
-	QHash<QString, BSAFolder *>::const_iterator i;
-	for ( i = children.begin(); i != children.end(); ++i ) {
-		auto f = i.value()->files;
-		auto c = i.value()->children;
-		if ( !f.count() && !c.count() )
+	endResetModel();
+
+	return !topLevel.isEmpty();
+}
+
+QVector<int> BSAModel::addFolders( const BSA::BSAFolder * folder, int parent, const QString & path )
+{
+	QVector<int> ids;
+
+	// Sorted by name so that the model is usable without a sorting proxy
+	QStringList names = folder->children.keys();
+	names.sort( Qt::CaseInsensitive );
+	for ( const QString & name : names ) {
+		const BSA::BSAFolder * child = folder->children.value( name );
+		if ( child->files.isEmpty() && child->children.isEmpty() )
 			continue;
 
-		auto folderItem = new QStandardItem( i.key() );
-		auto pathDummy = new QStandardItem( "" );
-		auto sizeDummy = new QStandardItem( "" );
+		int id = entries.count();
+		ids.append( id );
 
-		item->appendRow( { folderItem, pathDummy, sizeDummy } );
+		Entry e;
+		e.name = name;
+		e.path = ( path.isEmpty() ) ? name : path % "/" % name;
+		e.parent = parent;
+		e.row = ids.count() - 1;
+		e.folder = true;
+		entries.append( e );
 
 		// Recurse through folders
-		if ( c.count() ) {
-			QString fullpath = ((path.isEmpty()) ? path : path % "/") % i.key();
-			scan( i.value(), folderItem, fullpath );
-		}
+		QVector<int> children = addFolders( child, id, entries[id].path );
 
 		// List files
-		if ( f.count() ) {
-			QHash<QString, BSAFile *>::const_iterator it;
-			for ( it = f.begin(); it != f.end(); ++it ) {
-				QString fullpath = path % "/" % i.key() % "/" % it.key();
+		QStringList fileNames = child->files.keys();
+		fileNames.sort( Qt::CaseInsensitive );
+		for ( const QString & fileName : fileNames ) {
+			Entry f;
+			f.name = fileName;
+			f.parent = id;
+			f.row = children.count();
+			f.size = child->files.value( fileName )->size();
+			children.append( entries.count() );
+			entries.append( f );
+		}
 
-				int bytes = it.value()->size();
-				QString filesize = (bytes > 1024) ? QString::number( bytes / 1024 ) + "KB" : QString::number( bytes ) + "B";
+		entries[id].children = children;
+	}
 
-				auto fileItem = new QStandardItem( it.key() );
-				auto pathItem = new QStandardItem( fullpath );
-				auto sizeItem = new QStandardItem( filesize );
+	return ids;
+}
 
-				folderItem->appendRow( { fileItem, pathItem, sizeItem } );
-			}
-		}
-	}
+QString BSAModel::filePath( int id ) const
+{
+	const Entry & e = entries.at( id );
+	if ( e.folder )
+		return QString();
 
-	return true;
+	return entries.at( e.parent ).path % "/" % e.name;
 }
 
-bool BSA::fillModel( BSAModel * bsaModel, const QString & folder )
+int BSAModel::entryId( const QModelIndex & index )
 {
-	return scan( getFolder( folder ), bsaModel->invisibleRootItem(), folder );
+	return index.isValid() ? int( index.internalId() ) : -1;
 }
 
+QModelIndex BSAModel::index( int row, int column, const QModelIndex & parent ) const
+{
+	if ( column < 0 || column >= columnCount() )
+		return QModelIndex();
 
-BSAModel::BSAModel( QObject * parent )
-	: QStandardItemModel( parent )
+	const QVector<int> & rows = ( parent.isValid() ) ? entries.at( entryId( parent ) ).children : topLevel;
+	if ( row < 0 || row >= rows.count() )
+		return QModelIndex();
+
+	return createIndex( row, column, quintptr( rows.at( row ) ) );
+}
+
+QModelIndex BSAModel::parent( const QModelIndex & index ) const
+{
+	if ( !index.isValid() )
+		return QModelIndex();
+
+	int p = entries.at( entryId( index ) ).parent;
+	if ( p < 0 )
+		return QModelIndex();
+
+	return createIndex( entries.at( p ).row, 0, quintptr( p ) );
+}
+
+int BSAModel::rowCount( const QModelIndex & parent ) const
+{
+	if ( !parent.isValid() )
+		return topLevel.count();
+	if ( parent.column() > 0 )
+		return 0;
+
+	return entries.at( entryId( parent ) ).children.count();
+}
+
+int BSAModel::columnCount( const QModelIndex & ) const
 {
+	return 3;
+}
 
+QVariant BSAModel::data( const QModelIndex & index, int role ) const
+{
+	if ( !index.isValid() || ( role != Qt::DisplayRole && role != Qt::EditRole ) )
+		return QVariant();
+
+	int id = entryId( index );
+	const Entry & e = entries.at( id );
+	switch ( index.column() ) {
+	case 0:
+		return e.name;
+	case 1:
+		return filePath( id );
+	case 2:
+		if ( e.folder )
+			return QString();
+		return ( e.size > 1024 ) ? QString::number( e.size / 1024 ) + "KB" : QString::number( e.size ) + "B";
+	default:
+		return QVariant();
+	}
 }
 
-void BSAModel::init()
+QVariant BSAModel::headerData( int section, Qt::Orientation orientation, int role ) const
 {
-	setColumnCount( 3 );
-	setHorizontalHeaderLabels( { "File", "Path", "Size" } );
+	static const QStringList labels{ "File", "Path", "Size" };
+	if ( orientation == Qt::Horizontal && role == Qt::DisplayRole )
+		return labels.value( section );
+
+	return QVariant();
 }
 
 Qt::ItemFlags BSAModel::flags( const QModelIndex & index ) const
 {
-	return QStandardItemModel::flags( index ) ^ Qt::ItemIsEditable;
+	if ( !index.isValid() )
+		return Qt::NoItemFlags;
+
+	return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+
+//! Packs three characters into a trigram key
+static inline quint64 trigramKey( const QChar * c )
+{
+	return ( quint64( c[0].unicode() ) << 32 ) | ( quint64( c[1].unicode() ) << 16 ) | quint64( c[2].unicode() );
+}
+
+void BSAModel::buildTrigrams() const
+{
+	for ( int id = 0; id < entries.count(); id++ ) {
+		if ( entries.at( id ).folder )
+			continue;
+
+		const QString path = filePath( id ).toLower();
+		for ( int i = 0; i + 2 < path.length(); i++ ) {
+			// Ids are added in ascending order, so each list stays sorted and unique
+			QVector<int> & list = trigrams[trigramKey( path.constData() + i )];
+			if ( list.isEmpty() || list.last() != id )
+				list.append( id );
+		}
+	}
+}
+
+bool BSAModel::trigramCandidates( const QRegExp & filter, QVector<int> & candidates ) const
+{
+	if ( filter.patternSyntax() != QRegExp::Wildcard && filter.patternSyntax() != QRegExp::WildcardUnix )
+		return false;
+
+	const QString pattern = filter.pattern().toLower();
+	if ( pattern.contains( '\\' ) )
+		return false;
+
+	// Literal runs of the pattern; wildcards and character sets split them
+	QStringList literals;
+	QString literal;
+	bool inSet = false;
+	for ( const QChar c : pattern ) {
+		if ( inSet ) {
+			inSet = ( c != ']' );
+		} else if ( c == '*' || c == '?' || c == '[' ) {
+			inSet = ( c == '[' );
+			literals << literal;
+			literal.clear();
+		} else {
+			literal += c;
+		}
+	}
+	literals << literal;
+
+	QVector<const QVector<int> *> lists;
+	for ( const QString & l : literals ) {
+		for ( int i = 0; i + 2 < l.length(); i++ ) {
+			if ( trigrams.isEmpty() )
+				buildTrigrams();
+
+			auto it = trigrams.constFind( trigramKey( l.constData() + i ) );
+			if ( it == trigrams.constEnd() ) {
+				// A trigram of the pattern that is in no path, nothing can match
+				candidates.clear();
+				return true;
+			}
+			lists.append( &it.value() );
+		}
+	}
+
+	// Patterns without a trigram cannot be narrowed down
+	if ( lists.isEmpty() )
+		return false;
+
+	std::sort( lists.begin(), lists.end(), []( const QVector<int> * a, const QVector<int> * b ) {
+		return a->count() < b->count();
+	} );
+
+	candidates = *lists.first();
+	for ( int i = 1; i < lists.count() && !candidates.isEmpty(); i++ ) {
+		QVector<int> common;
+		std::set_intersection( candidates.cbegin(), candidates.cend(), lists[i]->cbegin(), lists[i]->cend(),
+							   std::back_inserter( common ) );
+		candidates = common;
+	}
+
+	return true;
+}
+
+QVector<bool> BSAModel::match( const QRegExp & filter, bool nameOnly, const QStringList & filetypes ) const
+{
+	QVector<bool> accepted( entries.count(), false );
+
+	auto test = [&]( int id ) {
+		const Entry & e = entries.at( id );
+		if ( e.folder )
+			return;
+
+		const QString path = filePath( id );
+
+		bool typeMatch = filetypes.isEmpty();
+		for ( const QString & f : filetypes )
+			typeMatch |= path.endsWith( f, Qt::CaseInsensitive );
+
+		if ( !typeMatch || !( nameOnly ? e.name : path ).contains( filter ) )
+			return;
+
+		// If children match, parent matches
+		accepted[id] = true;
+		for ( int p = e.parent; p >= 0 && !accepted.at( p ); p = entries.at( p ).parent )
+			accepted[p] = true;
+	};
+
+	QVector<int> candidates;
+	if ( trigramCandidates( filter, candidates ) ) {
+		for ( int id : candidates )
+			test( id );
+	} else {
+		for ( int id = 0; id < entries.count(); id++ )
+			test( id );
+	}
+
+	return accepted;
 }
 
 
 BSAProxyModel::BSAProxyModel( QObject * parent )
 	: QSortFilterProxyModel( parent )
 {
-
+	connect( this, &QSortFilterProxyModel::sourceModelChanged, this, [this]() { matchDirty = true; } );
+	connect( this, &QSortFilterProxyModel::modelReset, this, [this]() { matchDirty = true; } );
 }
 
 void BSAProxyModel::setFiletypes( QStringList types )
 {
 	filetypes = types;
+	matchDirty = true;
 }
 
 void BSAProxyModel::setFilterByNameOnly( bool nameOnly )
 {
 	filterByNameOnly = nameOnly;
+	matchDirty = true;
 
 	setFilterRegExp( filterRegExp() );
 }
@@ -896,36 +1354,18 @@ void BSAProxyModel::resetFilter()
 
 bool BSAProxyModel::filterAcceptsRow( int sourceRow, const QModelIndex & sourceParent ) const
 {
-	if ( !filterRegExp().isEmpty() ) {
-		
-		QModelIndex sourceIndex0 = sourceModel()->index( sourceRow, 0, sourceParent );
-		QModelIndex sourceIndex1 = sourceModel()->index( sourceRow, 1, sourceParent );
-		if ( sourceIndex0.isValid() ) {
-			// If children match, parent matches
-			int c = sourceModel()->rowCount( sourceIndex0 );
-			for ( int i = 0; i < c; ++i ) {
-				if ( filterAcceptsRow( i, sourceIndex0 ) )
-					return true;
-			}
-
-			QString key0 = sourceModel()->data( sourceIndex0, filterRole() ).toString();
-			QString key1 = sourceModel()->data( sourceIndex1, filterRole() ).toString();
-			
-			bool typeMatch = true;
-			if ( filetypes.count() ) {
-				typeMatch = false;
-				for ( auto f : filetypes ) {
-					typeMatch |= key1.endsWith( f, Qt::CaseInsensitive );
-				}
-			}
-
-			bool stringMatch = (filterByNameOnly) ? key0.contains( filterRegExp() ) : key1.contains( filterRegExp() );
-
-			return typeMatch && stringMatch;
-		}
+	auto model = qobject_cast<const BSAModel *>( sourceModel() );
+	if ( !model || filterRegExp().isEmpty() )
+		return QSortFilterProxyModel::filterAcceptsRow( sourceRow, sourceParent );
+
+	// Match the whole archive once per filter instead of recursing for every row
+	if ( matchDirty || filterRegExp() != matchedFilter ) {
+		accepted = model->match( filterRegExp(), filterByNameOnly, filetypes );
+		matchedFilter = filterRegExp();
+		matchDirty = false;
 	}
 
-	return QSortFilterProxyModel::filterAcceptsRow( sourceRow, sourceParent );
+	return accepted.value( BSAModel::entryId( model->index( sourceRow, 0, sourceParent ) ), false );
 }
 
 bool BSAProxyModel::lessThan( const QModelIndex & left, const QModelIndex & right ) const
@@ -35,7 +35,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "fsengine.h"
 
-#include <QStandardItemModel>
+#include <QAbstractItemModel>
 #include <QSortFilterProxyModel>
 
 #include <QDebug>
@@ -44,6 +44,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QFileInfo>
 #include <QHash>
 #include <QMutex>
+#include <QRegExp>
+#include <QVector>
 
 #include <memory>
 
@@ -264,11 +266,38 @@ public:
 	qint64 fileSize( const QString & ) const override final;
 	//! Returns the contents of the specified file
 	/*!
+	* Decompressed contents are kept in the FSArchiveCache, so repeated reads
+	* of the same file skip the archive I/O and decompression.
+	*
 	* \param fn The filename to get the contents for
 	* \param content Reference to the byte array that holds the file contents
 	* \return True if successful
 	*/
 	bool fileContents( const QString &, QByteArray & ) override final;
+	//! Returns a reduced texture holding only the mips no larger than maxSize
+	/*!
+	* Only the DX10 chunks covering the smaller mips are read, so a low resolution
+	* preview costs a fraction of the full texture. Because of the chunk granularity
+	* the largest mip can exceed maxSize when the smallest chunk holds larger mips.
+	*
+	* \param fn The filename to get the contents for
+	* \param content Reference to the byte array that holds the file contents
+	* \param maxSize The largest wanted width or height
+	* \return False if the file is not a DX10 texture, is a cubemap, or has no chunk to skip
+	*/
+	bool textureContents( const QString &, QByteArray &, int maxSize ) override final;
+	//! Returns at most the first size bytes of the specified file
+	/*!
+	* The DDS header of DX10 textures is rebuilt from the texture record and
+	* uncompressed files are read only partially, so probing a texture header
+	* does not read or inflate its data.
+	*
+	* \param fn The filename to get the header for
+	* \param content Reference to the byte array that holds the header
+	* \param size The number of bytes wanted
+	* \return True if successful
+	*/
+	bool fileHeader( const QString &, QByteArray &, int size ) override final;
 	
 	//! See QFileInfo::ownerId().
 	uint ownerId( const QString & ) const override final;
@@ -334,10 +363,14 @@ public:
 	//! Gets the specified file, or null if not found
 	const BSAFile * getFile( QString fn ) const;
 
-	bool scan( const BSA::BSAFolder *, QStandardItem *, QString );
+	//! Fills the archive browser model with the subfolders of the given folder
 	bool fillModel( BSAModel *, const QString & );
 
 protected:
+	//! Reads and decompresses the contents of the specified file, bypassing the cache
+	bool readFileContents( const QString &, QByteArray & );
+	//! Reads a DX10 texture as DDS, starting at the given chunk; fails if any chunk cannot be read or inflated
+	bool readTexture( const BSAFile * file, int firstChunk, QByteArray & content );
 	
 	//! The %BSA file
 	QFile bsa;
@@ -357,6 +390,8 @@ protected:
 	QString bsaBase;
 	//! The name of the file, e.g. "test.bsa"
 	QString bsaName;
+	//! Identifies the archive in the FSArchiveCache; includes the modification time
+	QString cacheId;
 	
 	//! Map of folders inside a %BSA
 	QHash<QString, BSAFolder *> folders;
@@ -379,16 +414,70 @@ protected:
 };
 
 
-class BSAModel : public QStandardItemModel
+//! A read-only tree model over the folder and file tables of a %BSA
+/*!
+ * Entries live in a flat table and QModelIndex::internalId() holds the entry ID,
+ * so no item objects are created per file. A trigram index over the file paths
+ * is built on the first filter and narrows down the files matched by BSAProxyModel.
+ */
+class BSAModel : public QAbstractItemModel
 {
 	Q_OBJECT
 
 public:
 	BSAModel( QObject * parent = nullptr );
 
-	void init();
+	//! Rebuilds the model from the subfolders of a folder; returns false if there are none
+	bool fill( const BSA::BSAFolder * folder, const QString & path );
+	//! Removes all entries
+	void clear();
+
+	//! Matches the files against a filter; accepted files and their parent folders are true
+	QVector<bool> match( const QRegExp & filter, bool nameOnly, const QStringList & filetypes ) const;
+
+	//! Returns the entry ID of an index, or -1 if invalid
+	static int entryId( const QModelIndex & index );
 
+	QModelIndex index( int row, int column, const QModelIndex & parent = QModelIndex() ) const override;
+	QModelIndex parent( const QModelIndex & index ) const override;
+	int rowCount( const QModelIndex & parent = QModelIndex() ) const override;
+	int columnCount( const QModelIndex & parent = QModelIndex() ) const override;
+	QVariant data( const QModelIndex & index, int role = Qt::DisplayRole ) const override;
+	QVariant headerData( int section, Qt::Orientation orientation, int role = Qt::DisplayRole ) const override;
 	Qt::ItemFlags flags( const QModelIndex & index ) const override;
+
+protected:
+	//! A file or folder of the model
+	struct Entry
+	{
+		QString name;
+		//! Full path of a folder inside the %BSA, empty for files
+		QString path;
+		//! The parent folder, or -1 for top level folders
+		int parent = -1;
+		//! Row inside the parent
+		int row = 0;
+		bool folder = false;
+		quint32 size = 0;
+		//! Subfolders followed by files
+		QVector<int> children;
+	};
+
+	//! Appends the non-empty subfolders of a folder and their files; returns their IDs
+	QVector<int> addFolders( const BSA::BSAFolder * folder, int parent, const QString & path );
+	//! Returns the full path of a file inside the %BSA
+	QString filePath( int id ) const;
+
+	//! Builds the trigram index of the lowercase file paths
+	void buildTrigrams() const;
+	//! Gets the files which contain every trigram of a wildcard filter; returns false if not applicable
+	bool trigramCandidates( const QRegExp & filter, QVector<int> & candidates ) const;
+
+	QVector<Entry> entries;
+	QVector<int> topLevel;
+
+	//! Sorted file IDs per trigram, built on demand
+	mutable QHash<quint64, QVector<int>> trigrams;
 };
 
 
@@ -413,6 +502,11 @@ protected:
 private:
 	QStringList filetypes;
 	bool filterByNameOnly = false;
+
+	//! Result of BSAModel::match() for the current filter
+	mutable QVector<bool> accepted;
+	mutable QRegExp matchedFilter;
+	mutable bool matchDirty = true;
 };
 
 #endif
@@ -37,6 +37,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QDebug>
 #include <QMap>
 #include <QMutex>
+#include <QStringBuilder>
 #include <QStringList>
 
 
@@ -71,3 +72,75 @@ FSArchiveHandler::~FSArchiveHandler()
 	if ( ! archive->ref.deref() )
 		delete archive;
 }
+
+
+//! Default budget of the decompressed entry cache in bytes
+static const qint64 FSARCHIVECACHE_DEFAULT_BYTES = 256 * 1024 * 1024;
+
+//! Cost of an entry in the decompressed entry cache (KiB, rounded up)
+static int entryCost( qint64 bytes )
+{
+	return int( ( bytes + 1023 ) / 1024 );
+}
+
+FSArchiveCache::FSArchiveCache()
+{
+	entries.setMaxCost( entryCost( FSARCHIVECACHE_DEFAULT_BYTES ) );
+}
+
+FSArchiveCache * FSArchiveCache::get()
+{
+	static auto instance{new FSArchiveCache{}};
+	return instance;
+}
+
+QString FSArchiveCache::key( const QString & archive, const QString & file )
+{
+	return archive % QChar( '|' ) % file.toLower();
+}
+
+// see fsengine.h
+bool FSArchiveCache::lookup( const QString & archive, const QString & file, QByteArray & content )
+{
+	auto cache = get();
+	QMutexLocker lock( &cache->mutex );
+
+	// QCache::object() also marks the entry as most recently used
+	if ( QByteArray * data = cache->entries.object( key( archive, file ) ) ) {
+		content = *data;
+		return true;
+	}
+
+	return false;
+}
+
+// see fsengine.h
+void FSArchiveCache::insert( const QString & archive, const QString & file, const QByteArray & content )
+{
+	if ( content.isEmpty() )
+		return;
+
+	auto cache = get();
+	QMutexLocker lock( &cache->mutex );
+
+	// Entries larger than the whole budget are rejected (and deleted) by QCache
+	cache->entries.insert( key( archive, file ), new QByteArray( content ), entryCost( content.size() ) );
+}
+
+// see fsengine.h
+void FSArchiveCache::clear()
+{
+	auto cache = get();
+	QMutexLocker lock( &cache->mutex );
+
+	cache->entries.clear();
+}
+
+// see fsengine.h
+void FSArchiveCache::setMaxBytes( qint64 bytes )
+{
+	auto cache = get();
+	QMutexLocker lock( &cache->mutex );
+
+	cache->entries.setMaxCost( entryCost( bytes ) );
+}
@@ -38,6 +38,9 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QDateTime>
 
 #include <QAtomicInt>
+#include <QByteArray>
+#include <QCache>
+#include <QMutex>
 
 #include <memory>
 
@@ -86,6 +89,25 @@ public:
 	virtual bool hasFile( const QString & ) const = 0;
 	virtual qint64 fileSize( const QString & ) const = 0;
 	virtual bool fileContents( const QString &, QByteArray & ) = 0;
+	//! Returns a reduced texture holding only the mips no larger than maxSize
+	/*!
+	 * Returns false if the archive cannot provide a reduced version of the file,
+	 * in which case fileContents() should be used instead.
+	 */
+	virtual bool textureContents( const QString &, QByteArray &, int ) { return false; }
+	//! Returns at most the first size bytes of a file
+	/*!
+	 * The default implementation reads the whole file; archives override it
+	 * where the start of a file can be read on its own.
+	 */
+	virtual bool fileHeader( const QString & fn, QByteArray & content, int size )
+	{
+		if ( !fileContents( fn, content ) )
+			return false;
+
+		content.truncate( size );
+		return true;
+	}
 	virtual QString getAbsoluteFilePath( const QString & ) const = 0;
 
 	virtual uint ownerId( const QString & ) const = 0;
@@ -99,4 +121,35 @@ protected:
 	friend class FSArchiveHandler;
 };
 
+
+//! A size-bounded LRU cache of decompressed archive entries
+/*!
+ * Entries are keyed by an archive identifier and the lowercase file path
+ * inside the archive, and hold the decompressed file contents. QByteArray is
+ * implicitly shared so a hit costs no copy.
+ */
+class FSArchiveCache
+{
+public:
+	//! Looks up the contents of an entry; returns false on a miss
+	static bool lookup( const QString & archive, const QString & file, QByteArray & content );
+	//! Stores the contents of an entry, evicting the least recently used entries if needed
+	static void insert( const QString & archive, const QString & file, const QByteArray & content );
+	//! Removes all entries
+	static void clear();
+
+	//! Sets the maximum total size of the cached entries in bytes
+	static void setMaxBytes( qint64 bytes );
+
+private:
+	FSArchiveCache();
+
+	static FSArchiveCache * get();
+	static QString key( const QString & archive, const QString & file );
+
+	QMutex mutex;
+	//! Cost of each entry is its size in KiB
+	QCache<QString, QByteArray> entries;
+};
+
 #endif
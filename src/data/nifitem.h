@@ -339,6 +339,14 @@ public:
 	//! Return the parent model.
 	BaseModel * model() { return parentModel; }
 
+	//! Move the item and all its descendants to another model (see NifModel::takeContents()).
+	void setModel( BaseModel * model )
+	{
+		parentModel = model;
+		for ( NifItem * c : childItems )
+			c->setModel( model );
+	}
+
 	//! Return the parent item.
 	const NifItem * parent() const { return parentItem; }
 
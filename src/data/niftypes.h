@@ -1125,6 +1125,12 @@ public:
 		return rotation * v * scale + translation;
 	}
 
+	//! Equality operator
+	bool operator==( const Transform & other ) const
+	{
+		return rotation == other.rotation && translation == other.translation && scale == other.scale;
+	}
+
 	//! Returns a matrix holding the transform
 	Matrix4 toMatrix4() const;
 
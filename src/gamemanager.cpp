@@ -256,23 +256,26 @@ void GameManager::update_settings( int& manager_version, QProgressDialog * dlg )
 
 QList<FSArchiveFile*> GameManager::opened_archives( const GameMode game )
 {
-	if ( !status(game) )
-		return {};
-
 	QList<FSArchiveFile *> archives;
-	if ( game == FALLOUT_3NV ) {
-		for ( const auto& an : get()->handles.value(FALLOUT_3) )
-			archives.append(an->getArchive());
-		for ( const auto& an : get()->handles.value(FALLOUT_NV) )
-			archives.append(an->getArchive());
-	}
-	else {
-		for ( const auto& an : get()->handles.value(game) )
-			archives.append(an->getArchive());
-	}
+	for ( const auto& an : opened_archive_handles(game) )
+		archives.append(an->getArchive());
 	return archives;
 }
 
+QList<std::shared_ptr<FSArchiveHandler>> GameManager::opened_archive_handles( const GameMode game )
+{
+	auto mgr = get();
+	QMutexLocker locker(&mgr->mutex);
+
+	auto enabled_handles = [mgr]( const GameMode g ) {
+		return mgr->game_status.value(g, false) ? mgr->handles.value(g) : QList<std::shared_ptr<FSArchiveHandler>>();
+	};
+
+	if ( game == FALLOUT_3NV )
+		return enabled_handles(FALLOUT_3) + enabled_handles(FALLOUT_NV);
+	return enabled_handles(game);
+}
+
 bool GameManager::archive_contains_folder( const QString& archive, const QString& folder )
 {
 	if ( BSA::canOpen(archive) ) {
@@ -220,7 +220,10 @@ public:
 
 	static GameManager* get();
 
+	//! Archives opened for the game; the pointers are only safe to use on the GUI thread
 	static QList <FSArchiveFile *> opened_archives(const GameMode game);
+	//! Handles of the archives opened for the game, which keep them open while held by worker threads
+	static QList<std::shared_ptr<FSArchiveHandler>> opened_archive_handles(const GameMode game);
 	static bool archive_contains_folder(const QString& archive, const QString& folder);
 
 	//! Game installation path
@@ -27,6 +27,14 @@ BSMesh::BSMesh( Scene * _scene, NifFieldConst _block )
 
 void BSMesh::transformShapes()
 {
+	if ( isHidden() )
+		return;
+
+	if ( doSkinning() ) {
+		applySkinning( Transform() );
+	} else {
+		applyRigidTransforms();
+	}
 }
 
 void BSMesh::drawShapes(NodeList* secondPass, bool presort)
@@ -40,14 +48,23 @@ void BSMesh::drawShapes(NodeList* secondPass, bool presort)
 		return;
 	}
 
+	if ( scene->queueShape(this) )
+		return;
+
 	auto nif = NifModel::fromIndex(iBlock);
 	if ( lodLevel != scene->lodLevel ) {
 		lodLevel = scene->lodLevel;
 		updateData();
+		transformShapes();
 	}
 
+	// Picking reads the skinned vertices
+	if ( Node::SELECTING )
+		applyCpuSkinning();
+
+	// Skinned vertices are in world space
 	glPushMatrix();
-	glMultMatrix(viewTrans());
+	glMultMatrix(transformRigid ? viewTrans() : scene->view);
 
 	glEnable(GL_POLYGON_OFFSET_FILL);
 	if ( drawInSecondPass )
@@ -56,8 +73,10 @@ void BSMesh::drawShapes(NodeList* secondPass, bool presort)
 		glPolygonOffset(1.0f, 2.0f);
 
 
+	auto fn = scene->renderer->fn;
+
 	glEnableClientState(GL_VERTEX_ARRAY);
-	glVertexPointer(3, GL_FLOAT, 0, transVerts.constData());
+	vertexBuffer.vertexPointer(fn, transVerts);
 
 	if ( Node::SELECTING ) {
 		if ( scene->isSelModeObject() ) {
@@ -69,7 +88,7 @@ void BSMesh::drawShapes(NodeList* secondPass, bool presort)
 
 	if ( !Node::SELECTING ) {
 		glEnable(GL_FRAMEBUFFER_SRGB);
-		shader = scene->renderer->setupProgram(this, shader);
+		shader = scene->renderer->setupProgram(this);
 
 	} else {
 		glDisable(GL_FRAMEBUFFER_SRGB);
@@ -78,19 +97,18 @@ void BSMesh::drawShapes(NodeList* secondPass, bool presort)
 	if ( !Node::SELECTING ) {
 		if ( transNorms.count() ) {
 			glEnableClientState(GL_NORMAL_ARRAY);
-			glNormalPointer(GL_FLOAT, 0, transNorms.constData());
+			normalBuffer.normalPointer(fn, transNorms);
 		}
 
 		if ( transColors.count() && scene->hasOption(Scene::DoVertexColors) ) {
 			glEnableClientState(GL_COLOR_ARRAY);
-			glColorPointer(4, GL_FLOAT, 0, transColors.constData());
+			colorBuffer.colorPointer(fn, transColors);
 		} else {
 			glColor(Color3(1.0f, 1.0f, 1.0f));
 		}
 	}
 
-	if ( sortedTriangles.count() )
-		glDrawElements(GL_TRIANGLES, sortedTriangles.count() * 3, GL_UNSIGNED_SHORT, sortedTriangles.constData());
+	drawTriangles(sortedTriangles, 0, sortedTriangles.count());
 	
 	if ( !Node::SELECTING )
 		scene->renderer->stopProgram();
@@ -114,14 +132,10 @@ void BSMesh::drawShapes(NodeList* secondPass, bool presort)
 		glEnable(GL_POLYGON_OFFSET_FILL);
 		glPolygonOffset(-0.5f, -1.5f);
 		glLineWidth(1.4f);
+		glDisableClientState(GL_NORMAL_ARRAY);
+		glDisableClientState(GL_COLOR_ARRAY);
 		glColor(Color4(0.5, 0.5, 0.5, 0.1));
-		for ( const Triangle& tri : sortedTriangles ) {
-			glBegin(GL_TRIANGLES);
-			glVertex(transVerts.value(tri.v1()));
-			glVertex(transVerts.value(tri.v2()));
-			glVertex(transVerts.value(tri.v3()));
-			glEnd();
-		}
+		drawTriangles(sortedTriangles, 0, sortedTriangles.count());
 	}
 
 	glDisableClientState(GL_VERTEX_ARRAY);
@@ -157,7 +171,7 @@ void BSMesh::drawSelection() const
 
 	glDisable(GL_FRAMEBUFFER_SRGB);
 	glPushMatrix();
-	glMultMatrix(viewTrans());
+	glMultMatrix(transformRigid ? viewTrans() : scene->view);
 
 	if ( blk == iBlock ) {
 
@@ -169,13 +183,10 @@ void BSMesh::drawSelection() const
 		glPointSize(1.5f);
 		glLineWidth(1.6f);
 		glNormalColor();
-		for ( const Triangle& tri : sortedTriangles ) {
-			glBegin(GL_TRIANGLES);
-			glVertex(transVerts.value(tri.v1()));
-			glVertex(transVerts.value(tri.v2()));
-			glVertex(transVerts.value(tri.v3()));
-			glEnd();
-		}
+		glEnableClientState(GL_VERTEX_ARRAY);
+		glVertexPointer(3, GL_FLOAT, 0, transVerts.constData());
+		glDrawTriangles(sortedTriangles);
+		glDisableClientState(GL_VERTEX_ARRAY);
 
 		glDisable(GL_POLYGON_OFFSET_FILL);
 
@@ -189,6 +200,8 @@ void BSMesh::drawSelection() const
 
 BoundSphere BSMesh::bounds() const
 {
+	updateSkinBounds();
+
 	if ( needUpdateBounds ) {
 		needUpdateBounds = false;
 		if ( transVerts.count() ) {
@@ -278,13 +291,22 @@ void BSMesh::updateDataImpl()
 		else {
 			sortedTriangles = mesh->triangles;
 		}
-		transVerts = mesh->positions;
+		verts = mesh->positions;
+		norms = mesh->normals;
+		tangents = mesh->tangents;
+		bitangents = mesh->bitangents;
+		hasVertexNormals = !norms.empty();
+		hasVertexTangents = !tangents.empty();
+		hasVertexBitangents = !bitangents.empty();
+
+		transformRigid = true;
+		transVerts = verts;
 		coords = mesh->coords;
 		transColors = mesh->colors;
 		hasVertexColors = !transColors.empty();
-		transNorms = mesh->normals;
-		transTangents = mesh->tangents;
-		transBitangents = mesh->bitangents;
+		transNorms = norms;
+		transTangents = tangents;
+		transBitangents = bitangents;
 		weightsUNORM = mesh->weights;
 		gpuLODs = mesh->lods;
 
@@ -325,6 +347,20 @@ void BSMesh::updateDataImpl()
 			}
 		}
 	}
+	// Skinning, with the vertex weights from the mesh file
+	if ( iSkin.isValid() && weightsUNORM.count() == verts.count() ) {
+		initSkinBones( model->field(iSkin).child("Bones"), model->field(iSkinData).child("Bone List"), block );
+
+		int nBones = bones.count();
+		for ( int v = 0; v < weightsUNORM.count(); v++ ) {
+			for ( const BoneWeightUNORM16 & bw : weightsUNORM[v].weightsUNORM ) {
+				if ( bw.weight > 0.0f && bw.bone < nBones )
+					bones[bw.bone].vertexWeights << VertexWeight( v, bw.weight );
+			}
+		}
+		isSkinned = ( nBones > 0 );
+	}
+
 	// Do after dependent blocks above
 	for ( const auto link : links ) {
 		auto idx = model->getBlockIndex(link);
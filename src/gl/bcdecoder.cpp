@@ -0,0 +1,931 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+#include "bcdecoder.h"
+
+#include "lib/half.h"
+
+#include <QThread>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <vector>
+
+
+/*! @file bcdecoder.cpp
+ * @brief Software decoder for BC1-BC7 block compressed textures.
+ *
+ * Every block is decoded into a 4x4 tile of RGBA8 pixels, which is then clipped
+ * into the output image. Blocks are independent, so large images are decoded
+ * in bands of block rows on several threads.
+ */
+
+//! Minimum number of blocks in an image before it is decoded on several threads
+static const int BC_PARALLEL_MIN_BLOCKS = 4096;
+
+//! Block compressed encodings understood by the decoder
+enum BlockType
+{
+	BLOCK_NONE,
+	BLOCK_BC1,      //!< DXT1 with 1-bit alpha
+	BLOCK_BC1_RGB,  //!< DXT1 without alpha
+	BLOCK_BC2,      //!< DXT3
+	BLOCK_BC3,      //!< DXT5
+	BLOCK_BC4,      //!< ATI1N, unsigned
+	BLOCK_BC4_S,    //!< ATI1N, signed
+	BLOCK_BC5,      //!< ATI2N, unsigned
+	BLOCK_BC5_S,    //!< ATI2N, signed
+	BLOCK_BC6H,     //!< BPTC half float, unsigned
+	BLOCK_BC6H_S,   //!< BPTC half float, signed
+	BLOCK_BC7       //!< BPTC
+};
+
+static BlockType blockType( gli::format format, bool * srgb = nullptr )
+{
+	bool isSrgb = false;
+	BlockType type = BLOCK_NONE;
+
+	switch ( format ) {
+	case gli::FORMAT_RGB_DXT1_SRGB_BLOCK8:
+		isSrgb = true;
+		[[fallthrough]];
+	case gli::FORMAT_RGB_DXT1_UNORM_BLOCK8:
+		type = BLOCK_BC1_RGB;
+		break;
+	case gli::FORMAT_RGBA_DXT1_SRGB_BLOCK8:
+		isSrgb = true;
+		[[fallthrough]];
+	case gli::FORMAT_RGBA_DXT1_UNORM_BLOCK8:
+		type = BLOCK_BC1;
+		break;
+	case gli::FORMAT_RGBA_DXT3_SRGB_BLOCK16:
+		isSrgb = true;
+		[[fallthrough]];
+	case gli::FORMAT_RGBA_DXT3_UNORM_BLOCK16:
+		type = BLOCK_BC2;
+		break;
+	case gli::FORMAT_RGBA_DXT5_SRGB_BLOCK16:
+		isSrgb = true;
+		[[fallthrough]];
+	case gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16:
+		type = BLOCK_BC3;
+		break;
+	case gli::FORMAT_R_ATI1N_UNORM_BLOCK8:
+		type = BLOCK_BC4;
+		break;
+	case gli::FORMAT_R_ATI1N_SNORM_BLOCK8:
+		type = BLOCK_BC4_S;
+		break;
+	case gli::FORMAT_RG_ATI2N_UNORM_BLOCK16:
+		type = BLOCK_BC5;
+		break;
+	case gli::FORMAT_RG_ATI2N_SNORM_BLOCK16:
+		type = BLOCK_BC5_S;
+		break;
+	case gli::FORMAT_RGB_BP_UFLOAT_BLOCK16:
+		type = BLOCK_BC6H;
+		break;
+	case gli::FORMAT_RGB_BP_SFLOAT_BLOCK16:
+		type = BLOCK_BC6H_S;
+		break;
+	case gli::FORMAT_RGBA_BP_SRGB_BLOCK16:
+		isSrgb = true;
+		[[fallthrough]];
+	case gli::FORMAT_RGBA_BP_UNORM_BLOCK16:
+		type = BLOCK_BC7;
+		break;
+	default:
+		break;
+	}
+
+	if ( srgb )
+		*srgb = isSrgb;
+
+	return type;
+}
+
+static int blockSize( BlockType type )
+{
+	switch ( type ) {
+	case BLOCK_BC1:
+	case BLOCK_BC1_RGB:
+	case BLOCK_BC4:
+	case BLOCK_BC4_S:
+		return 8;
+	default:
+		return 16;
+	}
+}
+
+//! Reads a 128-bit block least significant bit first
+class BlockBits
+{
+public:
+	BlockBits( const quint8 * block )
+		: lo( qFromLittleEndian<quint64>( block ) ), hi( qFromLittleEndian<quint64>( block + 8 ) )
+	{
+	}
+
+	quint32 read( int count )
+	{
+		if ( count == 0 )
+			return 0;
+
+		quint32 v = quint32( lo & ( ( quint64( 1 ) << count ) - 1 ) );
+		lo = ( lo >> count ) | ( hi << ( 64 - count ) );
+		hi >>= count;
+		return v;
+	}
+
+private:
+	quint64 lo;
+	quint64 hi;
+};
+
+
+/*
+ * BC1-BC5
+ */
+
+static inline void unpack565( quint16 c, quint8 * rgba )
+{
+	quint8 r = ( c >> 11 ) & 0x1f;
+	quint8 g = ( c >> 5 ) & 0x3f;
+	quint8 b = c & 0x1f;
+
+	rgba[0] = quint8( ( r << 3 ) | ( r >> 2 ) );
+	rgba[1] = quint8( ( g << 2 ) | ( g >> 4 ) );
+	rgba[2] = quint8( ( b << 3 ) | ( b >> 2 ) );
+	rgba[3] = 255;
+}
+
+//! Decode the colour half of a BC1-BC3 block; alpha is only written by BC1
+static void decodeColorBlock( const quint8 * block, quint8 * tile, BlockType type )
+{
+	quint16 c0 = qFromLittleEndian<quint16>( block );
+	quint16 c1 = qFromLittleEndian<quint16>( block + 2 );
+
+	quint8 pal[4][4];
+	unpack565( c0, pal[0] );
+	unpack565( c1, pal[1] );
+
+	// BC2 and BC3 always use the four colour mode
+	if ( c0 > c1 || ( type != BLOCK_BC1 && type != BLOCK_BC1_RGB ) ) {
+		for ( int c = 0; c < 3; c++ ) {
+			pal[2][c] = quint8( ( 2 * pal[0][c] + pal[1][c] ) / 3 );
+			pal[3][c] = quint8( ( pal[0][c] + 2 * pal[1][c] ) / 3 );
+		}
+		pal[2][3] = pal[3][3] = 255;
+	} else {
+		for ( int c = 0; c < 3; c++ ) {
+			pal[2][c] = quint8( ( pal[0][c] + pal[1][c] ) / 2 );
+			pal[3][c] = 0;
+		}
+		pal[2][3] = 255;
+		pal[3][3] = ( type == BLOCK_BC1 ) ? 0 : 255;
+	}
+
+	quint32 indices = qFromLittleEndian<quint32>( block + 4 );
+
+	if ( type == BLOCK_BC1 || type == BLOCK_BC1_RGB ) {
+		for ( int i = 0; i < 16; i++, indices >>= 2 )
+			memcpy( tile + 4 * i, pal[indices & 3], 4 );
+	} else {
+		for ( int i = 0; i < 16; i++, indices >>= 2 )
+			memcpy( tile + 4 * i, pal[indices & 3], 3 );
+	}
+}
+
+//! Decode the explicit 4-bit alpha of a BC2 block
+static void decodeExplicitAlpha( const quint8 * block, quint8 * tile )
+{
+	quint64 bits = qFromLittleEndian<quint64>( block );
+
+	for ( int i = 0; i < 16; i++, bits >>= 4 )
+		tile[4 * i + 3] = quint8( ( bits & 0xf ) * 17 );
+}
+
+//! Decode a BC4 channel, as used by BC3 alpha and BC4/BC5
+static void decodeChannelBlock( const quint8 * block, quint8 * tile, int channel, bool isSigned )
+{
+	int a0 = isSigned ? std::max<int>( qint8( block[0] ), -127 ) : block[0];
+	int a1 = isSigned ? std::max<int>( qint8( block[1] ), -127 ) : block[1];
+
+	int pal[8] = { a0, a1 };
+
+	if ( a0 > a1 ) {
+		for ( int k = 1; k < 7; k++ )
+			pal[k + 1] = ( ( 7 - k ) * a0 + k * a1 ) / 7;
+	} else {
+		for ( int k = 1; k < 5; k++ )
+			pal[k + 1] = ( ( 5 - k ) * a0 + k * a1 ) / 5;
+		pal[6] = isSigned ? -127 : 0;
+		pal[7] = isSigned ? 127 : 255;
+	}
+
+	quint8 values[8];
+	for ( int k = 0; k < 8; k++ )
+		values[k] = isSigned ? quint8( ( ( pal[k] + 127 ) * 255 + 127 ) / 254 ) : quint8( pal[k] );
+
+	// 48 bits of 3-bit indices
+	quint64 indices = qFromLittleEndian<quint64>( block ) >> 16;
+
+	for ( int i = 0; i < 16; i++, indices >>= 3 )
+		tile[4 * i + channel] = values[indices & 7];
+}
+
+
+/*
+ * BC6H and BC7 partitions
+ */
+
+//! Subset of each pixel for the 64 two-subset partitions, one bit per pixel
+static const quint16 partitions2[64] = {
+	0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80,
+	0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+	0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce,
+	0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+	0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a,
+	0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+	0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c,
+	0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22
+};
+
+//! Subset of each pixel for the 64 three-subset partitions
+static const quint8 partitions3[64][16] = {
+	{ 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2 }, { 0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1 },
+	{ 0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1 }, { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2 }, { 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2 },
+	{ 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1 }, { 0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2 }, { 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2 },
+	{ 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2 },
+	{ 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2 }, { 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2 },
+	{ 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2 }, { 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0 },
+	{ 0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2 }, { 0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0 },
+	{ 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2 }, { 0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1 },
+	{ 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2 }, { 0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1 },
+	{ 0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2 }, { 0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0 },
+	{ 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0 }, { 0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2 },
+	{ 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0 }, { 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1 },
+	{ 0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2 }, { 0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2 },
+	{ 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1 }, { 0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1 },
+	{ 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2 }, { 0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1 },
+	{ 0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2 }, { 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0 },
+	{ 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0 }, { 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0 },
+	{ 0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0 }, { 0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1 },
+	{ 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1 }, { 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2 },
+	{ 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1 }, { 0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2 },
+	{ 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1 }, { 0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1 },
+	{ 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1 }, { 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1 },
+	{ 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2 }, { 0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1 },
+	{ 0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2 }, { 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2 },
+	{ 0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2 }, { 0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2 },
+	{ 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2 }, { 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2 },
+	{ 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2 },
+	{ 0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2 }, { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2 },
+	{ 0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1 }, { 0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2 },
+	{ 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2 }, { 0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0 }
+};
+
+//! Anchor pixel of the second subset of the two-subset partitions
+static const quint8 anchors2[64] = {
+	15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+	15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+	15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+	 6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15
+};
+
+//! Anchor pixels of the second and third subsets of the three-subset partitions
+static const quint8 anchors3[64][2] = {
+	{  3, 15 }, {  3,  8 }, { 15,  8 }, { 15,  3 }, {  8, 15 }, {  3, 15 }, { 15,  3 }, { 15,  8 },
+	{  8, 15 }, {  8, 15 }, {  6, 15 }, {  6, 15 }, {  6, 15 }, {  5, 15 }, {  3, 15 }, {  3,  8 },
+	{  3, 15 }, {  3,  8 }, {  8, 15 }, { 15,  3 }, {  3, 15 }, {  3,  8 }, {  6, 15 }, { 10,  8 },
+	{  5,  3 }, {  8, 15 }, {  8,  6 }, {  6, 10 }, {  8, 15 }, {  5, 15 }, { 15, 10 }, { 15,  8 },
+	{  8, 15 }, { 15,  3 }, {  3, 15 }, {  5, 10 }, {  6, 10 }, { 10,  8 }, {  8,  9 }, { 15, 10 },
+	{ 15,  6 }, {  3, 15 }, { 15,  8 }, {  5, 15 }, { 15,  3 }, { 15,  6 }, { 15,  6 }, { 15,  8 },
+	{  3, 15 }, { 15,  3 }, {  5, 15 }, {  5, 15 }, {  5, 15 }, {  8, 15 }, {  5, 15 }, { 10, 15 },
+	{  5, 15 }, { 10, 15 }, {  8, 15 }, { 13, 15 }, { 15,  3 }, { 12, 15 }, {  3, 15 }, {  3,  8 }
+};
+
+static const int weights2[4] = { 0, 21, 43, 64 };
+static const int weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+static const int weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static inline const int * weightTable( int bits )
+{
+	return ( bits == 2 ) ? weights2 : ( bits == 3 ) ? weights3 : weights4;
+}
+
+static inline int interpolate( int e0, int e1, int w )
+{
+	return ( ( 64 - w ) * e0 + w * e1 + 32 ) >> 6;
+}
+
+
+/*
+ * BC7
+ */
+
+//! Bit layout of a BC7 mode
+struct Bc7Mode
+{
+	int subsets;
+	int partitionBits;
+	int rotationBits;
+	int selectorBits;
+	int colorBits;
+	int alphaBits;
+	int endpointPBits; //!< One p-bit per endpoint
+	int sharedPBits;   //!< One p-bit per subset
+	int indexBits;
+	int index2Bits;
+};
+
+static const Bc7Mode bc7Modes[8] = {
+	{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+	{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+	{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+	{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+	{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+	{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+	{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+	{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+};
+
+static void decodeBC7( const quint8 * block, quint8 * tile )
+{
+	BlockBits bits( block );
+
+	int mode = 0;
+	while ( mode < 8 && !bits.read( 1 ) )
+		mode++;
+
+	// Reserved mode, decodes to transparent black
+	if ( mode == 8 ) {
+		memset( tile, 0, 64 );
+		return;
+	}
+
+	const Bc7Mode & m = bc7Modes[mode];
+
+	int partition = bits.read( m.partitionBits );
+	int rotation  = bits.read( m.rotationBits );
+	int selector  = bits.read( m.selectorBits );
+
+	// [subset][endpoint][channel]
+	int ep[3][2][4];
+
+	for ( int c = 0; c < 3; c++ )
+		for ( int s = 0; s < m.subsets; s++ )
+			for ( int e = 0; e < 2; e++ )
+				ep[s][e][c] = bits.read( m.colorBits );
+
+	for ( int s = 0; s < m.subsets; s++ )
+		for ( int e = 0; e < 2; e++ )
+			ep[s][e][3] = bits.read( m.alphaBits );
+
+	int colorBits = m.colorBits;
+	int alphaBits = m.alphaBits;
+
+	if ( m.endpointPBits || m.sharedPBits ) {
+		for ( int s = 0; s < m.subsets; s++ ) {
+			int p = m.sharedPBits ? bits.read( 1 ) : 0;
+			for ( int e = 0; e < 2; e++ ) {
+				if ( m.endpointPBits )
+					p = bits.read( 1 );
+				for ( int c = 0; c < 4; c++ )
+					ep[s][e][c] = ( ep[s][e][c] << 1 ) | p;
+			}
+		}
+
+		colorBits++;
+		if ( alphaBits )
+			alphaBits++;
+	}
+
+	// Expand to 8 bits by replicating the high bits
+	for ( int s = 0; s < m.subsets; s++ ) {
+		for ( int e = 0; e < 2; e++ ) {
+			for ( int c = 0; c < 3; c++ ) {
+				int v = ep[s][e][c] << ( 8 - colorBits );
+				ep[s][e][c] = v | ( v >> colorBits );
+			}
+
+			if ( alphaBits ) {
+				int v = ep[s][e][3] << ( 8 - alphaBits );
+				ep[s][e][3] = v | ( v >> alphaBits );
+			} else {
+				ep[s][e][3] = 255;
+			}
+		}
+	}
+
+	int subset[16];
+	for ( int i = 0; i < 16; i++ ) {
+		if ( m.subsets == 2 )
+			subset[i] = ( partitions2[partition] >> i ) & 1;
+		else if ( m.subsets == 3 )
+			subset[i] = partitions3[partition][i];
+		else
+			subset[i] = 0;
+	}
+
+	int anchors[3] = { 0, 0, 0 };
+	if ( m.subsets == 2 ) {
+		anchors[1] = anchors2[partition];
+	} else if ( m.subsets == 3 ) {
+		anchors[1] = anchors3[partition][0];
+		anchors[2] = anchors3[partition][1];
+	}
+
+	// The anchor index of each subset drops its implicit high bit
+	int index[16];
+	for ( int i = 0; i < 16; i++ )
+		index[i] = bits.read( m.indexBits - ( i == anchors[subset[i]] ? 1 : 0 ) );
+
+	int index2[16];
+	for ( int i = 0; i < 16; i++ )
+		index2[i] = bits.read( m.index2Bits ? m.index2Bits - ( i == 0 ? 1 : 0 ) : 0 );
+
+	const int * colorWeights = weightTable( m.indexBits );
+	const int * alphaWeights = colorWeights;
+	const int * colorIndex = index;
+	const int * alphaIndex = index;
+
+	if ( m.index2Bits ) {
+		alphaWeights = weightTable( m.index2Bits );
+		alphaIndex = index2;
+
+		if ( selector ) {
+			std::swap( colorWeights, alphaWeights );
+			std::swap( colorIndex, alphaIndex );
+		}
+	}
+
+	for ( int i = 0; i < 16; i++ ) {
+		const int ( &e )[2][4] = ep[subset[i]];
+		quint8 * px = tile + 4 * i;
+
+		int cw = colorWeights[colorIndex[i]];
+		int aw = alphaWeights[alphaIndex[i]];
+
+		for ( int c = 0; c < 3; c++ )
+			px[c] = quint8( interpolate( e[0][c], e[1][c], cw ) );
+		px[3] = quint8( interpolate( e[0][3], e[1][3], aw ) );
+
+		if ( rotation )
+			std::swap( px[3], px[rotation - 1] );
+	}
+}
+
+
+/*
+ * BC6H
+ */
+
+//! Endpoint fields of a BC6H block
+enum Bc6Field
+{
+	F_END, F_D, F_RW, F_RX, F_RY, F_RZ, F_GW, F_GX, F_GY, F_GZ, F_BW, F_BX, F_BY, F_BZ
+};
+
+//! A run of bits of one field, stored from bit first to bit last
+struct Bc6Bits
+{
+	quint8 field;
+	quint8 first;
+	quint8 last;
+};
+
+//! Bit layout of a BC6H mode
+struct Bc6Mode
+{
+	quint8 code;
+	quint8 regions;
+	bool transformed;
+	quint8 endpointBits;
+	quint8 deltaBits[3];
+	Bc6Bits layout[25];
+};
+
+static const Bc6Mode bc6Modes[14] = {
+	{ 0x00, 2, true, 10, { 5, 5, 5 }, {
+		{ F_GY, 4, 4 }, { F_BY, 4, 4 }, { F_BZ, 4, 4 }, { F_RW, 0, 9 }, { F_GW, 0, 9 }, { F_BW, 0, 9 },
+		{ F_RX, 0, 4 }, { F_GZ, 4, 4 }, { F_GY, 0, 3 }, { F_GX, 0, 4 }, { F_BZ, 0, 0 }, { F_GZ, 0, 3 },
+		{ F_BX, 0, 4 }, { F_BZ, 1, 1 }, { F_BY, 0, 3 }, { F_RY, 0, 4 }, { F_BZ, 2, 2 }, { F_RZ, 0, 4 },
+		{ F_BZ, 3, 3 }, { F_D, 0, 4 } } },
+	{ 0x01, 2, true, 7, { 6, 6, 6 }, {
+		{ F_GY, 5, 5 }, { F_GZ, 4, 4 }, { F_GZ, 5, 5 }, { F_RW, 0, 6 }, { F_BZ, 0, 0 }, { F_BZ, 1, 1 },
+		{ F_BY, 4, 4 }, { F_GW, 0, 6 }, { F_BY, 5, 5 }, { F_BZ, 2, 2 }, { F_GY, 4, 4 }, { F_BW, 0, 6 },
+		{ F_BZ, 3, 3 }, { F_BZ, 5, 5 }, { F_BZ, 4, 4 }, { F_RX, 0, 5 }, { F_GY, 0, 3 }, { F_GX, 0, 5 },
+		{ F_GZ, 0, 3 }, { F_BX, 0, 5 }, { F_BY, 0, 3 }, { F_RY, 0, 5 }, { F_RZ, 0, 5 }, { F_D, 0, 4 } } },
+	{ 0x02, 2, true, 11, { 5, 4, 4 }, {
+		{ F_RW, 0, 9 }, { F_GW, 0, 9 }, { F_BW, 0, 9 }, { F_RX, 0, 4 }, { F_RW, 10, 10 }, { F_GY, 0, 3 },
+		{ F_GX, 0, 3 }, { F_GW, 10, 10 }, { F_BZ, 0, 0 }, { F_GZ, 0, 3 }, { F_BX, 0, 3 }, { F_BW, 10, 10 },
+		{ F_BZ, 1, 1 }, { F_BY, 0, 3 }, { F_RY, 0, 4 }, { F_BZ, 2, 2 }, { F_RZ, 0, 4 }, { F_BZ, 3, 3 },
+		{ F_D, 0, 4 } } },
+	{ 0x06, 2, true, 11, { 4, 5, 4 }, {
+		{ F_RW, 0, 9 }, { F_GW, 0, 9 }, { F_BW, 0, 9 }, { F_RX, 0, 3 }, { F_RW, 10, 10 }, { F_GZ, 4, 4 },
+		{ F_GY, 0, 3 }, { F_GX, 0, 4 }, { F_GW, 10, 10 }, { F_GZ, 0, 3 }, { F_BX, 0, 3 }, { F_BW, 10, 10 },
+		{ F_BZ, 1, 1 }, { F_BY, 0, 3 }, { F_RY, 0, 3 }, { F_BZ, 0, 0 }, { F_BZ, 2, 2 }, { F_RZ, 0, 3 },
+		{ F_GY, 4, 4 }, { F_BZ, 3, 3 }, { F_D, 0, 4 } } },
+	{ 0x0a, 2, true, 11, { 4, 4, 5 }, {
+		{ F_RW, 0, 9 }, { F_GW, 0, 9 }, { F_BW, 0, 9 }, { F_RX, 0, 3 }, { F_RW, 10, 10 }, { F_BY, 4, 4 },
+		{ F_GY, 0, 3 }, { F_GX, 0, 3 }, { F_GW, 10, 10 }, { F_BZ, 0, 0 }, { F_GZ, 0, 3 }, { F_BX, 0, 4 },
+		{ F_BW, 10, 10 }, { F_BY, 0, 3 }, { F_RY, 0, 3 }, { F_BZ, 1, 1 }, { F_BZ, 2, 2 }, { F_RZ, 0, 3 },
+		{ F_BZ, 4, 4 }, { F_BZ, 3, 3 }, { F_D, 0, 4 } } },
+	{ 0x0e, 2, true, 9, { 5, 5, 5 }, {
+		{ F_RW, 0, 8 }, { F_BY, 4, 4 }, { F_GW, 0, 8 }, { F_GY, 4, 4 }, { F_BW, 0, 8 }, { F_BZ, 4, 4 },
+		{ F_RX, 0, 4 }, { F_GZ, 4, 4 }, { F_GY, 0, 3 }, { F_GX, 0, 4 }, { F_BZ, 0, 0 }, { F_GZ, 0, 3 },
+		{ F_BX, 0, 4 }, { F_BZ, 1, 1 }, { F_BY, 0, 3 }, { F_RY, 0, 4 }, { F_BZ, 2, 2 }, { F_RZ, 0, 4 },
+		{ F_BZ, 3, 3 }, { F_D, 0, 4 } } },
+	{ 0x12, 2, true, 8, { 6, 5, 5 }, {
+		{ F_RW, 0, 7 }, { F_GZ, 4, 4 }, { F_BY, 4, 4 }, { F_GW, 0, 7 }, { F_BZ, 2, 2 }, { F_GY, 4, 4 },
+		{ F_BW, 0, 7 }, { F_BZ, 3, 3 }, { F_BZ, 4, 4 }, { F_RX, 0, 5 }, { F_GY, 0, 3 }, { F_GX, 0, 4 },
+		{ F_BZ, 0, 0 }, { F_GZ, 0, 3 }, { F_BX, 0, 4 }, { F_BZ, 1, 1 }, { F_BY, 0, 3 }, { F_RY, 0, 5 },
+		{ F_RZ, 0, 5 }, { F_D, 0, 4 } } },
+	{ 0x16, 2, true, 8, { 5, 6, 5 }, {
+		{ F_RW, 0, 7 }, { F_BZ, 0, 0 }, { F_BY, 4, 4 }, { F_GW, 0, 7 }, { F_GY, 5, 5 }, { F_GY, 4, 4 },
+		{ F_BW, 0, 7 }, { F_GZ, 5, 5 }, { F_BZ, 4, 4 }, { F_RX, 0, 4 }, { F_GZ, 4, 4 }, { F_GY, 0, 3 },
+		{ F_GX, 0, 5 }, { F_GZ, 0, 3 }, { F_BX, 0, 4 }, { F_BZ, 1, 1 }, { F_BY, 0, 3 }, { F_RY, 0, 4 },
+		{ F_BZ, 2, 2 }, { F_RZ, 0, 4 }, { F_BZ, 3, 3 }, { F_D, 0, 4 } } },
+	{ 0x1a, 2, true, 8, { 5, 5, 6 }, {
+		{ F_RW, 0, 7 }, { F_BZ, 1, 1 }, { F_BY, 4, 4 }, { F_GW, 0, 7 }, { F_BY, 5, 5 }, { F_GY, 4, 4 },
+		{ F_BW, 0, 7 }, { F_BZ, 5, 5 }, { F_BZ, 4, 4 }, { F_RX, 0, 4 }, { F_GZ, 4, 4 }, { F_GY, 0, 3 },
+		{ F_GX, 0, 4 }, { F_BZ, 0, 0 }, { F_GZ, 0, 3 }, { F_BX, 0, 5 }, { F_BY, 0, 3 }, { F_RY, 0, 4 },
+		{ F_BZ, 2, 2 }, { F_RZ, 0, 4 }, { F_BZ, 3, 3 }, { F_D, 0, 4 } } },
+	{ 0x1e, 2, false, 6, { 6, 6, 6 }, {
+		{ F_RW, 0, 5 }, { F_GZ, 4, 4 }, { F_BZ, 0, 0 }, { F_BZ, 1, 1 }, { F_BY, 4, 4 }, { F_GW, 0, 5 },
+		{ F_GY, 5, 5 }, { F_BY, 5, 5 }, { F_BZ, 2, 2 }, { F_GY, 4, 4 }, { F_BW, 0, 5 }, { F_GZ, 5, 5 },
+		{ F_BZ, 3, 3 }, { F_BZ, 5, 5 }, { F_BZ, 4, 4 }, { F_RX, 0, 5 }, { F_GY, 0, 3 }, { F_GX, 0, 5 },
+		{ F_GZ, 0, 3 }, { F_BX, 0, 5 }, { F_BY, 0, 3 }, { F_RY, 0, 5 }, { F_RZ, 0, 5 }, { F_D, 0, 4 } } },
+	{ 0x03, 1, false, 10, { 10, 10, 10 }, {
+		{ F_RW, 0, 9 }, { F_GW, 0, 9 }, { F_BW, 0, 9 }, { F_RX, 0, 9 }, { F_GX, 0, 9 }, { F_BX, 0, 9 } } },
+	{ 0x07, 1, true, 11, { 9, 9, 9 }, {
+		{ F_RW, 0, 9 }, { F_GW, 0, 9 }, { F_BW, 0, 9 }, { F_RX, 0, 8 }, { F_RW, 10, 10 },
+		{ F_GX, 0, 8 }, { F_GW, 10, 10 }, { F_BX, 0, 8 }, { F_BW, 10, 10 } } },
+	// The high endpoint bits of the last two modes are stored in reverse order
+	{ 0x0b, 1, true, 12, { 8, 8, 8 }, {
+		{ F_RW, 0, 9 }, { F_GW, 0, 9 }, { F_BW, 0, 9 }, { F_RX, 0, 7 }, { F_RW, 11, 10 },
+		{ F_GX, 0, 7 }, { F_GW, 11, 10 }, { F_BX, 0, 7 }, { F_BW, 11, 10 } } },
+	{ 0x0f, 1, true, 16, { 4, 4, 4 }, {
+		{ F_RW, 0, 9 }, { F_GW, 0, 9 }, { F_BW, 0, 9 }, { F_RX, 0, 3 }, { F_RW, 15, 10 },
+		{ F_GX, 0, 3 }, { F_GW, 15, 10 }, { F_BX, 0, 3 }, { F_BW, 15, 10 } } }
+};
+
+static inline int signExtend( int v, int bits )
+{
+	return ( v & ( 1 << ( bits - 1 ) ) ) ? ( v | ~( ( 1 << bits ) - 1 ) ) : v;
+}
+
+static int bc6Unquantize( int v, int bits, bool isSigned )
+{
+	if ( !isSigned ) {
+		if ( bits >= 15 || v == 0 )
+			return v;
+		if ( v == ( 1 << bits ) - 1 )
+			return 0xffff;
+		return ( ( v << 16 ) + 0x8000 ) >> bits;
+	}
+
+	if ( bits >= 16 )
+		return v;
+
+	bool negative = v < 0;
+	if ( negative )
+		v = -v;
+
+	int u;
+	if ( v == 0 )
+		u = 0;
+	else if ( v >= ( 1 << ( bits - 1 ) ) - 1 )
+		u = 0x7fff;
+	else
+		u = ( ( v << 15 ) + 0x4000 ) >> ( bits - 1 );
+
+	return negative ? -u : u;
+}
+
+static inline quint8 bc6ToUnorm8( int v, bool isSigned )
+{
+	quint16 half;
+	if ( !isSigned ) {
+		half = quint16( ( v * 31 ) >> 6 );
+	} else if ( v < 0 ) {
+		half = quint16( 0x8000 | ( ( -v * 31 ) >> 5 ) );
+	} else {
+		half = quint16( ( v * 31 ) >> 5 );
+	}
+
+	float f = halfToFloat( half );
+	return quint8( std::min( std::max( f, 0.0f ), 1.0f ) * 255.0f + 0.5f );
+}
+
+static void decodeBC6H( const quint8 * block, quint8 * tile, bool isSigned )
+{
+	BlockBits bits( block );
+
+	quint8 code = quint8( bits.read( 2 ) );
+	if ( code > 1 )
+		code |= quint8( bits.read( 3 ) << 2 );
+
+	const Bc6Mode * m = nullptr;
+	for ( const Bc6Mode & mode : bc6Modes ) {
+		if ( mode.code == code ) {
+			m = &mode;
+			break;
+		}
+	}
+
+	// Reserved mode, decodes to black
+	if ( !m ) {
+		for ( int i = 0; i < 16; i++ ) {
+			tile[4 * i] = tile[4 * i + 1] = tile[4 * i + 2] = 0;
+			tile[4 * i + 3] = 255;
+		}
+		return;
+	}
+
+	// Endpoints w, x, y, z for each channel; the fields are ordered by channel then endpoint
+	int fields[F_BZ + 1] = {};
+
+	for ( const Bc6Bits * b = m->layout; b->field != F_END; b++ ) {
+		int step = ( b->first <= b->last ) ? 1 : -1;
+		for ( int bit = b->first; ; bit += step ) {
+			fields[b->field] |= int( bits.read( 1 ) ) << bit;
+			if ( bit == b->last )
+				break;
+		}
+	}
+
+	int partition = fields[F_D];
+	int numEndpoints = m->regions * 2;
+	int ep[4][3];
+
+	for ( int c = 0; c < 3; c++ ) {
+		const int * f = fields + F_RW + 4 * c;
+		int epBits = m->endpointBits;
+
+		ep[0][c] = isSigned ? signExtend( f[0], epBits ) : f[0];
+
+		for ( int e = 1; e < numEndpoints; e++ ) {
+			int v = f[e];
+			if ( m->transformed || isSigned )
+				v = signExtend( v, m->deltaBits[c] );
+
+			if ( m->transformed ) {
+				v = ( ep[0][c] + v ) & ( ( 1 << epBits ) - 1 );
+				if ( isSigned )
+					v = signExtend( v, epBits );
+			}
+
+			ep[e][c] = v;
+		}
+
+		for ( int e = 0; e < numEndpoints; e++ )
+			ep[e][c] = bc6Unquantize( ep[e][c], epBits, isSigned );
+	}
+
+	int indexBits = ( m->regions == 2 ) ? 3 : 4;
+	const int * weights = weightTable( indexBits );
+
+	for ( int i = 0; i < 16; i++ ) {
+		int subset = ( m->regions == 2 ) ? ( ( partitions2[partition] >> i ) & 1 ) : 0;
+		bool anchor = ( i == 0 ) || ( m->regions == 2 && i == anchors2[partition] );
+		int w = weights[bits.read( indexBits - ( anchor ? 1 : 0 ) )];
+
+		quint8 * px = tile + 4 * i;
+		for ( int c = 0; c < 3; c++ )
+			px[c] = bc6ToUnorm8( interpolate( ep[2 * subset][c], ep[2 * subset + 1][c], w ), isSigned );
+		px[3] = 255;
+	}
+}
+
+
+/*
+ * Images
+ */
+
+static void decodeBlock( BlockType type, const quint8 * block, quint8 * tile )
+{
+	switch ( type ) {
+	case BLOCK_BC1:
+	case BLOCK_BC1_RGB:
+		decodeColorBlock( block, tile, type );
+		break;
+	case BLOCK_BC2:
+		decodeColorBlock( block + 8, tile, type );
+		decodeExplicitAlpha( block, tile );
+		break;
+	case BLOCK_BC3:
+		decodeColorBlock( block + 8, tile, type );
+		decodeChannelBlock( block, tile, 3, false );
+		break;
+	case BLOCK_BC4:
+	case BLOCK_BC4_S:
+		decodeChannelBlock( block, tile, 0, type == BLOCK_BC4_S );
+		for ( int i = 0; i < 16; i++ ) {
+			tile[4 * i + 1] = tile[4 * i + 2] = 0;
+			tile[4 * i + 3] = 255;
+		}
+		break;
+	case BLOCK_BC5:
+	case BLOCK_BC5_S:
+		decodeChannelBlock( block, tile, 0, type == BLOCK_BC5_S );
+		decodeChannelBlock( block + 8, tile, 1, type == BLOCK_BC5_S );
+		for ( int i = 0; i < 16; i++ ) {
+			tile[4 * i + 2] = 0;
+			tile[4 * i + 3] = 255;
+		}
+		break;
+	case BLOCK_BC6H:
+	case BLOCK_BC6H_S:
+		decodeBC6H( block, tile, type == BLOCK_BC6H_S );
+		break;
+	case BLOCK_BC7:
+		decodeBC7( block, tile );
+		break;
+	default:
+		break;
+	}
+}
+
+//! Decode the block rows [first, last) of an image
+static void decodeBlockRows( BlockType type, const quint8 * blocks, int width, int height, int first, int last, quint8 * rgba )
+{
+	int blocksX = ( width + 3 ) / 4;
+	int size = blockSize( type );
+	quint8 tile[64];
+
+	for ( int by = first; by < last; by++ ) {
+		const quint8 * block = blocks + size_t( by ) * blocksX * size;
+		int rows = std::min( 4, height - 4 * by );
+
+		for ( int bx = 0; bx < blocksX; bx++, block += size ) {
+			decodeBlock( type, block, tile );
+
+			int cols = std::min( 4, width - 4 * bx );
+			for ( int y = 0; y < rows; y++ )
+				memcpy( rgba + ( size_t( 4 * by + y ) * width + 4 * bx ) * 4, tile + 16 * y, 4 * cols );
+		}
+	}
+}
+
+bool bcIsSupported( gli::format format )
+{
+	return blockType( format ) != BLOCK_NONE;
+}
+
+bool bcDecode( gli::format format, const void * blocks, int width, int height, quint8 * rgba )
+{
+	BlockType type = blockType( format );
+	if ( type == BLOCK_NONE || width <= 0 || height <= 0 )
+		return false;
+
+	const quint8 * src = static_cast<const quint8 *>( blocks );
+	int blocksY = ( height + 3 ) / 4;
+	int blockCount = ( ( width + 3 ) / 4 ) * blocksY;
+
+	int threads = 1;
+	if ( blockCount >= BC_PARALLEL_MIN_BLOCKS )
+		threads = std::min( QThread::idealThreadCount(), blocksY );
+
+	if ( threads <= 1 ) {
+		decodeBlockRows( type, src, width, height, 0, blocksY, rgba );
+		return true;
+	}
+
+	std::vector<std::future<void>> jobs;
+	for ( int t = 0; t < threads; t++ ) {
+		int first = blocksY * t / threads;
+		int last = blocksY * ( t + 1 ) / threads;
+		jobs.push_back( std::async( std::launch::async, decodeBlockRows, type, src, width, height, first, last, rgba ) );
+	}
+
+	for ( auto & job : jobs )
+		job.get();
+
+	return true;
+}
+
+//! Convert uncompressed 8-bit pixels to RGBA8
+static bool convertToRGBA8( gli::format format, const quint8 * src, int count, quint8 * rgba )
+{
+	switch ( format ) {
+	case gli::FORMAT_RGBA8_UNORM_PACK8:
+	case gli::FORMAT_RGBA8_SRGB_PACK8:
+		memcpy( rgba, src, size_t( count ) * 4 );
+		return true;
+	case gli::FORMAT_BGRA8_UNORM_PACK8:
+	case gli::FORMAT_BGRA8_SRGB_PACK8:
+		for ( int i = 0; i < count; i++, src += 4, rgba += 4 ) {
+			rgba[0] = src[2];
+			rgba[1] = src[1];
+			rgba[2] = src[0];
+			rgba[3] = src[3];
+		}
+		return true;
+	case gli::FORMAT_RGB8_UNORM_PACK8:
+	case gli::FORMAT_RGB8_SRGB_PACK8:
+		for ( int i = 0; i < count; i++, src += 3, rgba += 4 ) {
+			memcpy( rgba, src, 3 );
+			rgba[3] = 255;
+		}
+		return true;
+	case gli::FORMAT_BGR8_UNORM_PACK8:
+	case gli::FORMAT_BGR8_SRGB_PACK8:
+		for ( int i = 0; i < count; i++, src += 3, rgba += 4 ) {
+			rgba[0] = src[2];
+			rgba[1] = src[1];
+			rgba[2] = src[0];
+			rgba[3] = 255;
+		}
+		return true;
+	default:
+		return false;
+	}
+}
+
+//! Whether convertToRGBA8() supports a format
+static bool isRGBA8Convertible( gli::format format, bool * srgb )
+{
+	switch ( format ) {
+	case gli::FORMAT_RGBA8_SRGB_PACK8:
+	case gli::FORMAT_BGRA8_SRGB_PACK8:
+	case gli::FORMAT_RGB8_SRGB_PACK8:
+	case gli::FORMAT_BGR8_SRGB_PACK8:
+		*srgb = true;
+		return true;
+	case gli::FORMAT_RGBA8_UNORM_PACK8:
+	case gli::FORMAT_BGRA8_UNORM_PACK8:
+	case gli::FORMAT_RGB8_UNORM_PACK8:
+	case gli::FORMAT_BGR8_UNORM_PACK8:
+		*srgb = false;
+		return true;
+	default:
+		return false;
+	}
+}
+
+gli::texture2d bcDecompress( const gli::texture & texture )
+{
+	if ( texture.empty() )
+		return gli::texture2d();
+
+	gli::format format = texture.format();
+
+	bool srgb = false;
+	bool compressed = ( blockType( format, &srgb ) != BLOCK_NONE );
+
+	if ( !compressed && !isRGBA8Convertible( format, &srgb ) )
+		return gli::texture2d();
+
+	auto extent = texture.extent( 0 );
+	gli::texture2d result( srgb ? gli::FORMAT_RGBA8_SRGB_PACK8 : gli::FORMAT_RGBA8_UNORM_PACK8,
+	                       gli::texture2d::extent_type( extent.x, extent.y ), texture.levels() );
+
+	for ( size_t level = 0; level < texture.levels(); level++ ) {
+		auto e = texture.extent( level );
+		auto src = static_cast<const quint8 *>( texture.data( 0, 0, level ) );
+		auto dst = static_cast<quint8 *>( result.data( 0, 0, level ) );
+
+		if ( compressed )
+			bcDecode( format, src, e.x, e.y, dst );
+		else
+			convertToRGBA8( format, src, e.x * e.y, dst );
+	}
+
+	return result;
+}
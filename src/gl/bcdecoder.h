@@ -0,0 +1,83 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+#ifndef BCDECODER_H
+#define BCDECODER_H
+
+#ifdef _MSC_VER
+#pragma warning(push, 0)
+#endif
+
+#include <gli.hpp>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include <QtGlobal>
+
+//! @file bcdecoder.h Software decoder for block compressed textures
+
+/*! Checks whether a format can be decoded by bcDecode().
+ *
+ * This covers BC1 to BC7, both UNORM/SNORM and sRGB variants.
+ */
+bool bcIsSupported( gli::format format );
+
+/*! Decodes one image of block compressed data to RGBA8 on the CPU.
+ *
+ * Large images are split into bands of block rows which are decoded in parallel.
+ * BC6H is decoded to half floats and clamped to [0, 1]; signed BC4/BC5 channels are
+ * remapped from [-1, 1] to [0, 255]; missing channels read as in GL, i.e. 0 for blue
+ * in BC5 and 255 for alpha.
+ *
+ * @param format	The block compressed format of the data.
+ * @param blocks	The blocks, in rows of ( width + 3 ) / 4 blocks.
+ * @param width		The width of the image in pixels.
+ * @param height	The height of the image in pixels.
+ * @param rgba		Receives width * height tightly packed RGBA8 pixels.
+ * @return			False if the format is not supported.
+ */
+bool bcDecode( gli::format format, const void * blocks, int width, int height, quint8 * rgba );
+
+/*! Decompresses the first face of a texture to RGBA8, without a GL context.
+ *
+ * All mipmap levels are decoded. Besides the formats supported by bcDecode(),
+ * uncompressed RGB(A)8 and BGR(A)8 textures are converted as well.
+ *
+ * @return	The decoded texture in FORMAT_RGBA8_UNORM_PACK8 or FORMAT_RGBA8_SRGB_PACK8,
+ *			or an empty texture if the format is not supported.
+ */
+gli::texture2d bcDecompress( const gli::texture & texture );
+
+#endif
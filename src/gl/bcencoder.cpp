@@ -0,0 +1,411 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+#include "bcencoder.h"
+#include "bcdecoder.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define BCENCODER_SSE2
+#include <emmintrin.h>
+#endif
+
+
+/*! @file bcencoder.cpp
+ * @brief Software encoder for BC1 and BC3 block compressed textures.
+ *
+ * Each 4x4 tile is compressed on its own: the colour end points are the
+ * diagonal of the bounding box of the tile which follows the colours, inset by
+ * a sixteenth to reduce the error of the extremes, and every pixel picks the
+ * nearest palette entry. The bounding box and the palette search use SSE2 where
+ * available; distances are exact integers, so the blocks are the same without it.
+ */
+
+static inline quint16 pack565( const int * rgb )
+{
+	return quint16( ( ( rgb[0] * 31 + 127 ) / 255 ) << 11 | ( ( rgb[1] * 63 + 127 ) / 255 ) << 5 | ( rgb[2] * 31 + 127 ) / 255 );
+}
+
+static inline void unpack565( quint16 c, int * rgb )
+{
+	int r = ( c >> 11 ) & 0x1f;
+	int g = ( c >> 5 ) & 0x3f;
+	int b = c & 0x1f;
+
+	rgb[0] = ( r << 3 ) | ( r >> 2 );
+	rgb[1] = ( g << 2 ) | ( g >> 4 );
+	rgb[2] = ( b << 3 ) | ( b >> 2 );
+}
+
+//! Copy a 4x4 tile of the image, repeating the last row and column past the edges
+static void readTile( const quint8 * rgba, int width, int height, int bx, int by, quint8 * tile )
+{
+	for ( int y = 0; y < 4; y++ ) {
+		const quint8 * row = rgba + size_t( std::min( by * 4 + y, height - 1 ) ) * width * 4;
+
+		for ( int x = 0; x < 4; x++ )
+			memcpy( tile + ( y * 4 + x ) * 4, row + std::min( bx * 4 + x, width - 1 ) * 4, 4 );
+	}
+}
+
+//! Per channel minimum and maximum of the 16 pixels of a tile
+static inline void tileBounds( const quint8 * tile, quint8 * lo, quint8 * hi )
+{
+#ifdef BCENCODER_SSE2
+	__m128i p0 = _mm_loadu_si128( (const __m128i *)( tile ) );
+	__m128i p1 = _mm_loadu_si128( (const __m128i *)( tile + 16 ) );
+	__m128i p2 = _mm_loadu_si128( (const __m128i *)( tile + 32 ) );
+	__m128i p3 = _mm_loadu_si128( (const __m128i *)( tile + 48 ) );
+
+	__m128i mn = _mm_min_epu8( _mm_min_epu8( p0, p1 ), _mm_min_epu8( p2, p3 ) );
+	__m128i mx = _mm_max_epu8( _mm_max_epu8( p0, p1 ), _mm_max_epu8( p2, p3 ) );
+
+	// Fold the four pixels of each register into the first one
+	mn = _mm_min_epu8( mn, _mm_srli_si128( mn, 8 ) );
+	mn = _mm_min_epu8( mn, _mm_srli_si128( mn, 4 ) );
+	mx = _mm_max_epu8( mx, _mm_srli_si128( mx, 8 ) );
+	mx = _mm_max_epu8( mx, _mm_srli_si128( mx, 4 ) );
+
+	quint32 l = quint32( _mm_cvtsi128_si32( mn ) );
+	quint32 h = quint32( _mm_cvtsi128_si32( mx ) );
+	memcpy( lo, &l, 4 );
+	memcpy( hi, &h, 4 );
+#else
+	for ( int c = 0; c < 4; c++ ) {
+		lo[c] = 255;
+		hi[c] = 0;
+	}
+
+	for ( int i = 0; i < 16; i++ ) {
+		for ( int c = 0; c < 4; c++ ) {
+			lo[c] = std::min( lo[c], tile[4 * i + c] );
+			hi[c] = std::max( hi[c], tile[4 * i + c] );
+		}
+	}
+#endif
+}
+
+//! Index of the nearest of the four palette colours for each pixel, two bits per pixel
+static quint32 colorIndices( const quint8 * tile, const int pal[4][3] )
+{
+	quint32 indices = 0;
+
+#ifdef BCENCODER_SSE2
+	// Red in the low and green in the high half of each 32-bit lane, blue on its own,
+	// so that _mm_madd_epi16 sums the squared differences
+	const __m128i lowByte = _mm_set1_epi32( 0xff );
+	const __m128i secondByte = _mm_set1_epi32( 0xff00 );
+
+	__m128i palRG[4], palB[4];
+	for ( int k = 0; k < 4; k++ ) {
+		palRG[k] = _mm_set1_epi32( pal[k][0] | ( pal[k][1] << 16 ) );
+		palB[k] = _mm_set1_epi32( pal[k][2] );
+	}
+
+	for ( int j = 0; j < 4; j++ ) {
+		__m128i v = _mm_loadu_si128( (const __m128i *)( tile + 16 * j ) );
+		__m128i rg = _mm_or_si128( _mm_and_si128( v, lowByte ), _mm_slli_epi32( _mm_and_si128( v, secondByte ), 8 ) );
+		__m128i b = _mm_and_si128( _mm_srli_epi32( v, 16 ), lowByte );
+
+		__m128i best = _mm_setzero_si128();
+		__m128i bestDist = _mm_setzero_si128();
+
+		for ( int k = 0; k < 4; k++ ) {
+			__m128i drg = _mm_sub_epi16( rg, palRG[k] );
+			__m128i db = _mm_sub_epi16( b, palB[k] );
+			__m128i dist = _mm_add_epi32( _mm_madd_epi16( drg, drg ), _mm_madd_epi16( db, db ) );
+
+			if ( k == 0 ) {
+				bestDist = dist;
+				continue;
+			}
+
+			// Like the scalar search, only a strictly closer entry replaces the best one
+			__m128i closer = _mm_cmplt_epi32( dist, bestDist );
+			bestDist = _mm_or_si128( _mm_and_si128( closer, dist ), _mm_andnot_si128( closer, bestDist ) );
+			best = _mm_or_si128( _mm_and_si128( closer, _mm_set1_epi32( k ) ), _mm_andnot_si128( closer, best ) );
+		}
+
+		alignas( 16 ) quint32 idx[4];
+		_mm_store_si128( (__m128i *)idx, best );
+
+		for ( int l = 0; l < 4; l++ )
+			indices |= idx[l] << ( 2 * ( 4 * j + l ) );
+	}
+#else
+	for ( int i = 0; i < 16; i++ ) {
+		const quint8 * p = tile + 4 * i;
+		int best = 0;
+		int bestDist = INT_MAX;
+
+		for ( int k = 0; k < 4; k++ ) {
+			int dr = p[0] - pal[k][0];
+			int dg = p[1] - pal[k][1];
+			int db = p[2] - pal[k][2];
+			int dist = dr * dr + dg * dg + db * db;
+
+			if ( dist < bestDist ) {
+				bestDist = dist;
+				best = k;
+			}
+		}
+
+		indices |= quint32( best ) << ( 2 * i );
+	}
+#endif
+
+	return indices;
+}
+
+//! Index of the nearest of the eight palette alphas for each pixel, three bits per pixel
+static quint64 alphaIndices( const quint8 * tile, const int pal[8] )
+{
+	quint64 bits = 0;
+
+#ifdef BCENCODER_SSE2
+	// Gather the 16 alphas into the bytes of one register
+	__m128i a0 = _mm_srli_epi32( _mm_loadu_si128( (const __m128i *)( tile ) ), 24 );
+	__m128i a1 = _mm_srli_epi32( _mm_loadu_si128( (const __m128i *)( tile + 16 ) ), 24 );
+	__m128i a2 = _mm_srli_epi32( _mm_loadu_si128( (const __m128i *)( tile + 32 ) ), 24 );
+	__m128i a3 = _mm_srli_epi32( _mm_loadu_si128( (const __m128i *)( tile + 48 ) ), 24 );
+	__m128i alpha = _mm_packus_epi16( _mm_packs_epi32( a0, a1 ), _mm_packs_epi32( a2, a3 ) );
+
+	__m128i best = _mm_setzero_si128();
+	__m128i bestDist = _mm_setzero_si128();
+
+	for ( int k = 0; k < 8; k++ ) {
+		__m128i p = _mm_set1_epi8( char( pal[k] ) );
+		__m128i dist = _mm_or_si128( _mm_subs_epu8( alpha, p ), _mm_subs_epu8( p, alpha ) );
+
+		if ( k == 0 ) {
+			bestDist = dist;
+			continue;
+		}
+
+		// There is no unsigned byte compare, bestDist <= dist is min( bestDist, dist ) == bestDist
+		__m128i keep = _mm_cmpeq_epi8( _mm_min_epu8( bestDist, dist ), bestDist );
+		bestDist = _mm_min_epu8( bestDist, dist );
+		best = _mm_or_si128( _mm_and_si128( keep, best ), _mm_andnot_si128( keep, _mm_set1_epi8( char( k ) ) ) );
+	}
+
+	alignas( 16 ) quint8 idx[16];
+	_mm_store_si128( (__m128i *)idx, best );
+
+	for ( int i = 0; i < 16; i++ )
+		bits |= quint64( idx[i] ) << ( 3 * i );
+#else
+	for ( int i = 0; i < 16; i++ ) {
+		int a = tile[4 * i + 3];
+		int best = 0;
+		int bestDist = INT_MAX;
+
+		for ( int k = 0; k < 8; k++ ) {
+			int dist = std::abs( a - pal[k] );
+
+			if ( dist < bestDist ) {
+				bestDist = dist;
+				best = k;
+			}
+		}
+
+		bits |= quint64( best ) << ( 3 * i );
+	}
+#endif
+
+	return bits;
+}
+
+//! Encode the colour half of a BC1-BC3 block, always in the four colour mode
+static void encodeColorBlock( const quint8 * tile, const quint8 * tileLo, const quint8 * tileHi, quint8 * block )
+{
+	int lo[3] = { tileLo[0], tileLo[1], tileLo[2] };
+	int hi[3] = { tileHi[0], tileHi[1], tileHi[2] };
+
+	// Take the diagonal of the box along which the colours vary, judged against the widest channel
+	int widest = 0;
+	for ( int c = 1; c < 3; c++ ) {
+		if ( hi[c] - lo[c] > hi[widest] - lo[widest] )
+			widest = c;
+	}
+
+	int center[3];
+	for ( int c = 0; c < 3; c++ )
+		center[c] = ( lo[c] + hi[c] ) / 2;
+
+	int cov[3] = {};
+	for ( int i = 0; i < 16; i++ ) {
+		int d = tile[4 * i + widest] - center[widest];
+		for ( int c = 0; c < 3; c++ )
+			cov[c] += d * ( tile[4 * i + c] - center[c] );
+	}
+
+	for ( int c = 0; c < 3; c++ ) {
+		int inset = ( hi[c] - lo[c] ) >> 4;
+		lo[c] += inset;
+		hi[c] -= inset;
+
+		if ( cov[c] < 0 )
+			std::swap( lo[c], hi[c] );
+	}
+
+	quint16 c0 = pack565( hi );
+	quint16 c1 = pack565( lo );
+
+	// c0 > c1 selects the four colour mode in BC1; equal end points only use index 0
+	if ( c0 < c1 )
+		std::swap( c0, c1 );
+
+	quint32 indices = 0;
+
+	if ( c0 != c1 ) {
+		int pal[4][3];
+		unpack565( c0, pal[0] );
+		unpack565( c1, pal[1] );
+
+		for ( int c = 0; c < 3; c++ ) {
+			pal[2][c] = ( 2 * pal[0][c] + pal[1][c] ) / 3;
+			pal[3][c] = ( pal[0][c] + 2 * pal[1][c] ) / 3;
+		}
+
+		indices = colorIndices( tile, pal );
+	}
+
+	qToLittleEndian( c0, block );
+	qToLittleEndian( c1, block + 2 );
+	qToLittleEndian( indices, block + 4 );
+}
+
+//! Encode the interpolated alpha of a BC3 block, always in the eight value mode
+static void encodeAlphaBlock( const quint8 * tile, int lo, int hi, quint8 * block )
+{
+	quint64 bits = 0;
+
+	if ( hi != lo ) {
+		int pal[8] = { hi, lo };
+		for ( int k = 1; k < 7; k++ )
+			pal[k + 1] = ( ( 7 - k ) * hi + k * lo ) / 7;
+
+		bits = alphaIndices( tile, pal );
+	}
+
+	block[0] = quint8( hi );
+	block[1] = quint8( lo );
+
+	for ( int b = 0; b < 6; b++ )
+		block[2 + b] = quint8( bits >> ( 8 * b ) );
+}
+
+// (public function, documented in bcencoder.h)
+bool bcEncode( gli::format format, const quint8 * rgba, int width, int height, void * blocks )
+{
+	bool alpha;
+
+	switch ( format ) {
+	case gli::FORMAT_RGB_DXT1_UNORM_BLOCK8:
+	case gli::FORMAT_RGB_DXT1_SRGB_BLOCK8:
+	case gli::FORMAT_RGBA_DXT1_UNORM_BLOCK8:
+	case gli::FORMAT_RGBA_DXT1_SRGB_BLOCK8:
+		alpha = false;
+		break;
+	case gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16:
+	case gli::FORMAT_RGBA_DXT5_SRGB_BLOCK16:
+		alpha = true;
+		break;
+	default:
+		return false;
+	}
+
+	int blocksX = ( width + 3 ) / 4;
+	int blocksY = ( height + 3 ) / 4;
+	auto out = static_cast<quint8 *>( blocks );
+	quint8 tile[64];
+	quint8 lo[4], hi[4];
+
+	for ( int by = 0; by < blocksY; by++ ) {
+		for ( int bx = 0; bx < blocksX; bx++ ) {
+			readTile( rgba, width, height, bx, by, tile );
+			tileBounds( tile, lo, hi );
+
+			if ( alpha ) {
+				encodeAlphaBlock( tile, lo[3], hi[3], out );
+				out += 8;
+			}
+
+			encodeColorBlock( tile, lo, hi, out );
+			out += 8;
+		}
+	}
+
+	return true;
+}
+
+// (public function, documented in bcencoder.h)
+gli::texture2d bcCompress( const gli::texture & texture )
+{
+	if ( texture.empty() || gli::is_compressed( texture.format() ) )
+		return gli::texture2d();
+
+	gli::texture2d image = bcDecompress( texture );
+	if ( image.empty() )
+		return gli::texture2d();
+
+	bool srgb = ( image.format() == gli::FORMAT_RGBA8_SRGB_PACK8 );
+
+	auto extent = image.extent( 0 );
+	auto pixels = static_cast<const quint8 *>( image.data( 0, 0, 0 ) );
+	bool alpha = false;
+
+	for ( size_t i = 0; i < size_t( extent.x ) * extent.y && !alpha; i++ )
+		alpha = ( pixels[4 * i + 3] != 255 );
+
+	gli::format format;
+	if ( alpha )
+		format = srgb ? gli::FORMAT_RGBA_DXT5_SRGB_BLOCK16 : gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16;
+	else
+		format = srgb ? gli::FORMAT_RGB_DXT1_SRGB_BLOCK8 : gli::FORMAT_RGB_DXT1_UNORM_BLOCK8;
+
+	gli::texture2d result( format, extent, image.levels() );
+
+	for ( size_t level = 0; level < image.levels(); level++ ) {
+		auto e = image.extent( level );
+		bcEncode( format, static_cast<const quint8 *>( image.data( 0, 0, level ) ), e.x, e.y, result.data( 0, 0, level ) );
+	}
+
+	return result;
+}
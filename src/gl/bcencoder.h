@@ -0,0 +1,76 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+#ifndef BCENCODER_H
+#define BCENCODER_H
+
+#ifdef _MSC_VER
+#pragma warning(push, 0)
+#endif
+
+#include <gli.hpp>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#include <QtGlobal>
+
+//! @file bcencoder.h Software encoder for BC1 and BC3 block compressed textures
+
+/*! Encodes one RGBA8 image to BC1 (DXT1) or BC3 (DXT5) blocks on the CPU.
+ *
+ * The end points are the inset bounding box of each block, which is fast and
+ * good enough for converting legacy textures. Partial blocks at the right and
+ * bottom edges repeat the last row and column.
+ *
+ * @param format	FORMAT_RGB(A)_DXT1 or FORMAT_RGBA_DXT5, UNORM or sRGB.
+ * @param rgba		The width * height tightly packed RGBA8 pixels.
+ * @param width		The width of the image in pixels.
+ * @param height	The height of the image in pixels.
+ * @param blocks	Receives the blocks, in rows of ( width + 3 ) / 4 blocks.
+ * @return			False if the format is not supported.
+ */
+bool bcEncode( gli::format format, const quint8 * rgba, int width, int height, void * blocks );
+
+/*! Compresses the first face of an uncompressed texture, without a GL context.
+ *
+ * All mipmap levels are encoded. Opaque textures are compressed to BC1 and
+ * textures with alpha to BC3; sRGB textures stay sRGB.
+ *
+ * @return	The compressed texture, or an empty texture if the texture is already
+ *			block compressed or its format is not supported by bcDecompress().
+ */
+gli::texture2d bcCompress( const gli::texture & texture );
+
+#endif
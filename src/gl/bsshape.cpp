@@ -256,7 +256,7 @@ void BSShape::transformShapes()
 	Node::transformShapes();
 
 	if ( doSkinning() ) {
-		applySkinningTransforms( scene->view );
+		applySkinning( Transform() );
 	} else {
 		applyRigidTransforms();
 	}
@@ -267,6 +267,8 @@ void BSShape::transformShapes()
 
 BoundSphere BSShape::bounds() const
 {
+	updateSkinBounds();
+
 	if ( needUpdateBounds ) {
 		needUpdateBounds = false;
 		if ( verts.count() ) {
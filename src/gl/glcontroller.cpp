@@ -33,6 +33,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "glcontroller.h"
 
 #include "gl/glscene.h"
+#include "gl/keysearch.h"
 
 
 //! @file glcontroller.cpp Controllable management, Interpolation management
@@ -208,26 +209,7 @@ bool ValueInterpolator<T>::getFrame( float inTime, ConstKeyPtr & pKey1, ConstKey
 
 	} else {
 		int iKey = ( keyIndexCache >= 0 && keyIndexCache <= lastKey ) ? keyIndexCache : 0;
-		ConstKeyPtr pKey = keyData + iKey;
-		if ( pKey->time < inTime ) {
-			do {
-				pKey++;
-			} while( pKey->time < inTime );
-
-			pKey1 = ( pKey->time == inTime ) ? pKey : ( pKey - 1 );
-			pKey2 = pKey;
-
-		} else if ( pKey->time > inTime ) {
-			do {
-				pKey--;
-			} while( pKey->time > inTime );
-
-			pKey1 = pKey;
-			pKey2 = ( pKey->time == inTime ) ? pKey : ( pKey + 1 );
-
-		} else { // pKey->time == inTime
-			pKey1 = pKey2 = pKey;
-		}
+		findKeys( keyData, lastKey, iKey, inTime, pKey1, pKey2 );
 	}
 
 	if ( pKey1 != pKey2 ) {
@@ -764,8 +764,8 @@ void Mesh::transformShapes()
 
 	if ( doSkinning() ) {
 		// TODO (Gavrant): I've no idea why it requires different transforms depending on whether it's partitioned or not.
-		Transform baseTrans = iSkinPart.isValid() ? scene->view : ( viewTrans() * skeletonTrans );
-		applySkinningTransforms( baseTrans );
+		Transform baseTrans = iSkinPart.isValid() ? Transform() : ( worldTrans() * skeletonTrans );
+		applySkinning( baseTrans );
 	} else {
 		applyRigidTransforms();
 	}
@@ -777,6 +777,8 @@ void Mesh::transformShapes()
 
 BoundSphere Mesh::bounds() const
 {
+	updateSkinBounds();
+
 	if ( needUpdateBounds ) {
 		needUpdateBounds = false;
 		boundSphere = BoundSphere( verts );
@@ -173,6 +173,7 @@ Node::Node( Scene * _scene, NifFieldConst _block )
 	: IControllable( _scene, _block ), parent( 0 ), ref( 0 )
 {
 	nodeId = 0;
+	sceneIndex = scene->registerNode();
 	flags.bits = 0;
 
 	updateSettings();
@@ -180,6 +181,11 @@ Node::Node( Scene * _scene, NifFieldConst _block )
 	connect( NifSkope::getOptions(), &SettingsDialog::saveSettings, this, &Node::updateSettings );
 }
 
+Node::~Node()
+{
+	scene->unregisterNode( sceneIndex );
+}
+
 void Node::updateSettings()
 {
 	QSettings settings;
@@ -334,8 +340,8 @@ void Node::activeProperties( PropertyList & list ) const
 
 const Transform & Node::viewTrans() const
 {
-	if ( scene->viewTrans.contains( nodeId ) )
-		return scene->viewTrans[ nodeId ];
+	if ( const Transform * cached = scene->viewTrans.get( sceneIndex ) )
+		return *cached;
 
 	Transform t;
 
@@ -344,22 +350,20 @@ const Transform & Node::viewTrans() const
 	else
 		t = scene->view * worldTrans();
 
-	scene->viewTrans.insert( nodeId, t );
-	return scene->viewTrans[ nodeId ];
+	return scene->viewTrans.set( sceneIndex, t );
 }
 
 const Transform & Node::worldTrans() const
 {
-	if ( scene->worldTrans.contains( nodeId ) )
-		return scene->worldTrans[ nodeId ];
+	if ( const Transform * cached = scene->worldTrans.get( sceneIndex ) )
+		return *cached;
 
 	Transform t = local;
 
 	if ( parent )
 		t = parent->worldTrans() * t;
 
-	scene->worldTrans.insert( nodeId, t );
-	return scene->worldTrans[ nodeId ];
+	return scene->worldTrans.set( sceneIndex, t );
 }
 
 Transform Node::localTrans( int root ) const
@@ -437,8 +441,11 @@ bool Node::isHidden() const
 
 void Node::transform()
 {
+	Transform prevLocal = local;
 	IControllable::transform();
 
+	worldChanged = scene->transformAll || !( local == prevLocal ) || ( parent && parent->worldChanged );
+
 	// if there's a rigid body attached, then calculate and cache the body's transform
 	// (need this later in the drawing stage for the constraints)
 	auto nif = NifModel::fromValidIndex( iBlock );
@@ -457,7 +464,7 @@ void Node::transform()
 					t.translation = Vector3( nif->get<Vector4>( cinfo, "Translation" ) * bhkScale( nif ) );
 				}
 
-				scene->bhkBodyTrans.insert( nif->getBlockNumber( iBody ), worldTrans() * t );
+				scene->setBodyTrans( nif->getBlockNumber( iBody ), worldTrans() * t );
 			}
 		}
 	}
@@ -474,6 +481,13 @@ void Node::transformShapes()
 	}
 }
 
+void Node::transformView()
+{
+	for ( Node * node : children.list() ) {
+		node->transformView();
+	}
+}
+
 void Node::draw()
 {
 	if ( isHidden() || iBlock == scene->currentBlock )
@@ -1017,11 +1031,11 @@ void drawHvkConstraint( const NifModel * nif, const QModelIndex & iConstraint, c
 
 	auto linkA = nif->getLink( iEntityA );
 	auto linkB = nif->getLink( iEntityB );
-	if ( !scene->bhkBodyTrans.contains( linkA ) || !scene->bhkBodyTrans.contains( linkB ) )
+	if ( !scene->hasBodyTrans( linkA ) || !scene->hasBodyTrans( linkB ) )
 		return;
 
-	tBodyA = scene->bhkBodyTrans.value( linkA );
-	tBodyB = scene->bhkBodyTrans.value( linkB );
+	tBodyA = scene->bodyTrans( linkA );
+	tBodyB = scene->bodyTrans( linkB );
 
 	auto hkFactor = bhkScaleMult( nif );
 	auto hkFactorInv = 1.0 / hkFactor;
@@ -1445,7 +1459,7 @@ void Node::drawHavok()
 
 	glPushMatrix();
 	glLoadMatrix( scene->view );
-	glMultMatrix( scene->bhkBodyTrans.value( nif->getBlockNumber( iBody ) ) );
+	glMultMatrix( scene->bodyTrans( nif->getBlockNumber( iBody ) ) );
 
 
 	//qDebug() << "draw obj" << nif->getBlockNumber( iObject ) << nif->itemName( iObject );
@@ -1780,7 +1794,8 @@ void Node::drawShapes( NodeList * secondPass, bool presort )
 		children.sort();
 
 	for ( Node * node : children.list() ) {
-		node->drawShapes( secondPass, presort );
+		if ( !node->cull() )
+			node->drawShapes( secondPass, presort );
 	}
 }
 
@@ -1803,6 +1818,39 @@ QString Node::textStats() const
 	return QString( "%1\n\nglobal\n%2\nlocal\n%3\n" ).arg( name, trans2string( worldTrans() ), trans2string( localTrans() ) );
 }
 
+void Node::updateTreeBounds()
+{
+	treeBounds = BoundSphere();
+	treeShapes = 0;
+
+	for ( Node * node : children.list() ) {
+		node->updateTreeBounds();
+		treeBounds |= node->treeBounds;
+		treeShapes += node->treeShapes;
+	}
+}
+
+void Node::expandTreeBounds( const Vector3 & pivot )
+{
+	for ( Node * node : children.list() ) {
+		node->expandTreeBounds( pivot );
+	}
+
+	if ( treeBounds.radius >= 0 )
+		treeBounds = BoundSphere( pivot, ( treeBounds.center - pivot ).length() + treeBounds.radius );
+}
+
+bool Node::cull() const
+{
+	if ( !scene->isCulled( treeBounds ) )
+		return false;
+
+	if ( !SELECTING )
+		scene->culledShapes += treeShapes;
+
+	return true;
+}
+
 BoundSphere Node::bounds() const
 {
 	BoundSphere boundsphere;
@@ -1889,15 +1937,36 @@ void LODNode::transform()
 {
 	Node::transform();
 
+	updateLevels();
+}
+
+void LODNode::transformView()
+{
+	// The shapes of a level coming into view have not been transformed while it was hidden
+	if ( updateLevels() )
+		scene->invalidateTransforms();
+
+	Node::transformView();
+}
+
+bool LODNode::updateLevels()
+{
 	if ( children.list().isEmpty() )
-		return;
+		return false;
+
+	bool changed = false;
+	auto setHidden = [&changed]( Node * child, bool hidden ) {
+		if ( child->flags.node.hidden != hidden ) {
+			child->flags.node.hidden = hidden;
+			changed = true;
+		}
+	};
 
 	if ( ranges.isEmpty() ) {
 		for ( Node * child : children.list() ) {
-			child->flags.node.hidden = true;
+			setHidden( child, child != children.list().first() );
 		}
-		children.list().first()->flags.node.hidden = false;
-		return;
+		return changed;
 	}
 
 	float distance = ( viewTrans() * center ).length();
@@ -1905,12 +1974,14 @@ void LODNode::transform()
 	int c = 0;
 	for ( Node * child : children.list() ) {
 		if ( c < ranges.count() )
-			child->flags.node.hidden = !( ranges[c].first <= distance && distance < ranges[c].second );
+			setHidden( child, !( ranges[c].first <= distance && distance < ranges[c].second ) );
 		else
-			child->flags.node.hidden = true;
+			setHidden( child, true );
 
 		c++;
 	}
+
+	return changed;
 }
 
 
@@ -1921,8 +1992,8 @@ BillboardNode::BillboardNode( Scene * _scene, NifFieldConst _block )
 
 const Transform & BillboardNode::viewTrans() const
 {
-	if ( scene->viewTrans.contains( nodeId ) )
-		return scene->viewTrans[ nodeId ];
+	if ( const Transform * cached = scene->viewTrans.get( sceneIndex ) )
+		return *cached;
 
 	Transform t;
 
@@ -1933,6 +2004,13 @@ const Transform & BillboardNode::viewTrans() const
 
 	t.rotation = Matrix();
 
-	scene->viewTrans.insert( nodeId, t );
-	return scene->viewTrans[ nodeId ];
+	return scene->viewTrans.set( sceneIndex, t );
+}
+
+void BillboardNode::updateTreeBounds()
+{
+	Node::updateTreeBounds();
+
+	// The children are turned to face the camera about the origin of the billboard
+	expandTreeBounds( worldTrans().translation );
 }
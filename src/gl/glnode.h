@@ -35,6 +35,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "gl/glcontrollable.h" // Inherited
 #include "gl/glproperty.h"
+#include "gl/gltools.h"
 
 #include <QList>
 #include <QPersistentModelIndex>
@@ -102,10 +103,13 @@ class Node : public IControllable
 
 public:
 	Node( Scene * _scene, NifFieldConst _block );
+	~Node();
 
 	static int SELECTING;
 
 	int id() const { return nodeId; }
+	//! Dense index of the node in its scene, for the transform caches
+	int sceneId() const { return sceneIndex; }
 
 	// IControllable
 
@@ -115,6 +119,8 @@ public:
 	// end IControllable
 
 	virtual void transformShapes();
+	//! Updates what depends on the view when only the camera moved since the last Scene::transform
+	virtual void transformView();
 
 	virtual void draw();
 	virtual void drawShapes( NodeList * secondPass = nullptr, bool presort = false );
@@ -123,7 +129,11 @@ public:
 	virtual void drawSelection() const;
 
 	virtual float viewDepth() const;
-	virtual class BoundSphere bounds() const;
+	virtual BoundSphere bounds() const;
+	//! Updates the world bounds of the shapes drawn by the node and its children
+	virtual void updateTreeBounds();
+	//! Is everything the node draws outside of the view? The shapes skipped are counted by the scene
+	bool cull() const;
 	virtual const Vector3 center() const;
 	virtual const Transform & viewTrans() const;
 	virtual const Transform & worldTrans() const;
@@ -133,6 +143,11 @@ public:
 	virtual bool isHidden() const;
 	virtual QString textStats() const;
 
+	//! Did the world transform change in the last full Scene::transform?
+	bool hasWorldChanged() const { return worldChanged; }
+	//! The number of shapes under the node, as of the last updateTreeBounds()
+	int treeShapeCount() const { return treeShapes; }
+
 	bool isVisible() const { return !isHidden(); }
 	bool isPresorted() const { return presorted; }
 	
@@ -178,8 +193,16 @@ protected:
 
 
 	bool presorted = false;
+	bool worldChanged = true;
+
+	//! Makes the bounds cover any rotation about pivot
+	void expandTreeBounds( const Vector3 & pivot );
+
+	BoundSphere treeBounds;
+	int treeShapes = 0;
 
 	int nodeId;
+	int sceneIndex;
 	int ref;
 };
 
@@ -209,6 +232,8 @@ public:
 
 	// end IControllable
 
+	void transformView() override;
+
 protected:
 	QList<QPair<float, float> > ranges;
 	QPersistentModelIndex iData;
@@ -216,6 +241,8 @@ protected:
 	Vector3 center;
 
 	void updateImpl( const NifModel * nif, const QModelIndex & block ) override;
+	//! Shows the child of the level the view distance falls into; returns true if a child was shown or hidden
+	bool updateLevels();
 };
 
 //! A Node that always faces the camera
@@ -225,6 +252,7 @@ public:
 	BillboardNode( Scene * _scene, NifFieldConst _block );
 
 	const Transform & viewTrans() const override;
+	void updateTreeBounds() override;
 };
 
 
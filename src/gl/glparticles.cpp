@@ -113,6 +113,18 @@ void Particles::transformShapes()
 {
 	Node::transformShapes();
 
+	transformVertices();
+}
+
+void Particles::transformView()
+{
+	Node::transformView();
+
+	transformVertices();
+}
+
+void Particles::transformVertices()
+{
 	Transform vtrans = viewTrans();
 
 	transVerts.resize( verts.count() );
@@ -128,6 +140,13 @@ BoundSphere Particles::bounds() const
 	return worldTrans() * sphere | Node::bounds();
 }
 
+void Particles::updateTreeBounds()
+{
+	Node::updateTreeBounds();
+	treeBounds |= bounds();
+	treeShapes++;
+}
+
 void Particles::drawShapes( NodeList * secondPass, bool presort )
 {
 	Q_UNUSED( presort );
@@ -52,14 +52,18 @@ public:
 	void transform() override;
 
 	void transformShapes() override;
+	void transformView() override;
 
 	void drawShapes( NodeList * secondPass = nullptr, bool presort = false ) override;
 
 	BoundSphere bounds() const override;
+	void updateTreeBounds() override;
 
 protected:
 	Controller * createController( NifFieldConst controllerBlock ) override;
 	void updateImpl( const NifModel * nif, const QModelIndex & index ) override;
+	//! Transforms the particles into view space
+	void transformVertices();
 
 	QPersistentModelIndex iData;
 	bool updateData = false;
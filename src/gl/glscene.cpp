@@ -47,9 +47,60 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QOpenGLFunctions>
 #include <QSettings>
 
+#include <algorithm>
+
 
 //! \file glscene.cpp %Scene management
 
+
+/*
+ *	TransformCache
+ */
+
+void TransformCache::reserve( int count )
+{
+	if ( count > int( entries.size() ) )
+		entries.resize( count );
+}
+
+void TransformCache::invalidate()
+{
+	// Stale entries are only recognised by their generation, so restart the count before it wraps
+	if ( ++generation == 0 ) {
+		for ( Entry & e : entries )
+			e.generation = 0;
+		generation = 1;
+	}
+}
+
+void TransformCache::reset()
+{
+	entries.clear();
+	generation = 1;
+}
+
+void TransformCache::release( int index )
+{
+	if ( index >= 0 && index < int( entries.size() ) )
+		entries[index].generation = 0;
+}
+
+const Transform & TransformCache::set( int index, const Transform & t )
+{
+	Q_ASSERT( index >= 0 );
+	reserve( index + 1 );
+
+	Entry & e = entries[index];
+	e.transform = t;
+	e.generation = generation;
+	return e.transform;
+}
+
+
+/*
+ *	Scene
+ */
+
 Scene::Scene( TexCache * texcache, QOpenGLContext * context, QOpenGLFunctions * functions, QObject * parent ) :
 	QObject( parent )
 {
@@ -100,6 +151,11 @@ Scene::Scene( TexCache * texcache, QOpenGLContext * context, QOpenGLFunctions *
 
 Scene::~Scene()
 {
+	// Deleted shapes unregister from the shapes list, which is destroyed before the node lists
+	roots.clear();
+	nodes.clear();
+	properties.clear();
+
 	delete renderer;
 }
 
@@ -112,6 +168,7 @@ void Scene::setGame( Game::GameMode newGame )
 void Scene::updateShaders()
 {
 	renderer->updateShaders();
+	invalidateTransforms();
 }
 
 void Scene::clear( bool flushTextures )
@@ -122,6 +179,13 @@ void Scene::clear( bool flushTextures )
 	roots.clear();
 	shapes.clear();
 
+	nodeCount = 0;
+	freeNodes.clear();
+	worldTrans.reset();
+	viewTrans.reset();
+	bhkBodyTrans.reset();
+	bodySlots.clear();
+
 	animGroups.clear();
 	animTags.clear();
 
@@ -129,6 +193,7 @@ void Scene::clear( bool flushTextures )
 	textures->flush();
 
 	sceneBoundsValid = timeBoundsValid = false;
+	invalidateTransforms();
 
 	setGame( Game::OTHER );
 }
@@ -172,6 +237,7 @@ void Scene::update( const NifModel * nif, const QModelIndex & index )
 	}
 
 	timeBoundsValid = false;
+	invalidateTransforms();
 }
 
 void Scene::updateSceneOptions( bool checked )
@@ -329,16 +395,41 @@ void Scene::setSequence( const QString & seqname )
 	}
 
 	timeBoundsValid = false;
+	invalidateTransforms();
 }
 
 void Scene::transform( const Transform & trans, float time )
 {
 	view = trans;
+	viewTrans.invalidate();
+
+	bool animated = animate && time != this->time;
 	this->time = time;
 
-	worldTrans.clear();
-	viewTrans.clear();
-	bhkBodyTrans.clear();
+	// The selection and the options decide how the shapes are skinned
+	if ( options != transformOptions || visMode != transformVisMode || currentBlock != transformBlock )
+		transformsValid = false;
+
+	if ( transformsValid && !animated ) {
+		// Only the view changed: the world transforms, skinned vertices and bounds are still valid
+		for ( Node * node : roots.list() ) {
+			node->transformView();
+		}
+
+		// Unless a level of detail came into view
+		if ( transformsValid )
+			return;
+	}
+
+	// After edits every node is updated, otherwise only the animated subtrees are skinned again
+	transformAll = !transformsValid;
+	transformsValid = true;
+	transformOptions = options;
+	transformVisMode = visMode;
+	transformBlock = currentBlock;
+
+	worldTrans.invalidate();
+	bhkBodyTrans.invalidate();
 
 	for ( Property * prop : properties.hash() ) {
 		prop->transform();
@@ -349,6 +440,10 @@ void Scene::transform( const Transform & trans, float time )
 	for ( Node * node : roots.list() ) {
 		node->transformShapes();
 	}
+	// The bounds are in world space, so they stay valid for culling while only the view changes
+	for ( Node * node : roots.list() ) {
+		node->updateTreeBounds();
+	}
 
 	sceneBoundsValid = false;
 
@@ -371,13 +466,25 @@ void Scene::draw()
 
 void Scene::drawShapes()
 {
+	frustum.update();
+	if ( !Node::SELECTING )
+		culledShapes = 0;
+
+	trackTextureUnits( true );
+
+	// Picking draws the shapes in a flat color, so there is no state to sort by
+	queueingShapes = !Node::SELECTING;
+
 	if ( hasOption(DoBlending) ) {
 		NodeList secondPass;
 
 		for ( Node * node : roots.list() ) {
-			node->drawShapes( &secondPass );
+			if ( !node->cull() )
+				node->drawShapes( &secondPass );
 		}
 
+		drawQueue();
+
 		if ( secondPass.list().count() > 0 )
 			drawSelection(); // for transparency pass
 
@@ -388,9 +495,47 @@ void Scene::drawShapes()
 		}
 	} else {
 		for ( Node * node : roots.list() ) {
-			node->drawShapes();
+			if ( !node->cull() )
+				node->drawShapes();
 		}
+
+		drawQueue();
+	}
+
+	trackTextureUnits( false );
+}
+
+bool Scene::queueShape( Shape * shape )
+{
+	// Presorted shapes are drawn in the order of the scene graph
+	if ( !queueingShapes || shape->isPresorted() )
+		return false;
+
+	shapeQueue.append( shape );
+	return true;
+}
+
+void Scene::drawQueue()
+{
+	queueingShapes = false;
+	if ( shapeQueue.isEmpty() )
+		return;
+
+	QVector<QPair<Renderer::StateKey, Shape *>> items;
+	items.reserve( shapeQueue.count() );
+	for ( Shape * shape : shapeQueue ) {
+		items.append( { renderer->stateKey( shape ), shape } );
 	}
+	shapeQueue.clear();
+
+	std::stable_sort( items.begin(), items.end(), []( const auto & a, const auto & b ) { return a.first < b.first; } );
+
+	// Consecutive shapes with the same program keep it bound
+	renderer->beginBatch();
+	for ( const auto & item : items ) {
+		item.second->drawShapes();
+	}
+	renderer->endBatch();
 }
 
 void Scene::drawNodes()
@@ -430,6 +575,46 @@ int Scene::registerShape( Shape * shape )
 	return shapes.count() - 1;
 }
 
+int Scene::registerNode()
+{
+	// Indices of deleted nodes are reused, so that patching the scene does not grow the caches
+	if ( !freeNodes.isEmpty() )
+		return freeNodes.takeLast();
+
+	// The node caches never grow during a lookup, which keeps the references they return valid
+	worldTrans.reserve( nodeCount + 1 );
+	viewTrans.reserve( nodeCount + 1 );
+	return nodeCount++;
+}
+
+void Scene::unregisterNode( int index )
+{
+	// The next node at this index must not see the transforms of this one
+	worldTrans.release( index );
+	viewTrans.release( index );
+	freeNodes.append( index );
+}
+
+void Scene::setBodyTrans( int block, const Transform & t )
+{
+	auto it = bodySlots.find( block );
+	if ( it == bodySlots.end() )
+		it = bodySlots.insert( block, bodySlots.count() );
+
+	bhkBodyTrans.set( it.value(), t );
+}
+
+bool Scene::hasBodyTrans( int block ) const
+{
+	auto it = bodySlots.constFind( block );
+	return it != bodySlots.constEnd() && bhkBodyTrans.contains( it.value() );
+}
+
+Transform Scene::bodyTrans( int block ) const
+{
+	return bhkBodyTrans.value( bodySlots.value( block, -1 ) );
+}
+
 BoundSphere Scene::bounds() const
 {
 	if ( !sceneBoundsValid ) {
@@ -489,12 +674,18 @@ float Scene::timeMax() const
 
 QString Scene::textStats()
 {
+	int shapeCount = 0;
+	for ( Node * node : roots.list() ) {
+		shapeCount += node->treeShapeCount();
+	}
+	QString culling = QString( "\nculled %1 of %2 shapes\n" ).arg( culledShapes ).arg( shapeCount );
+
 	for ( Node * node : nodes.list() ) {
 		if ( node->index() == currentBlock ) {
-			return node->textStats();
+			return node->textStats() + culling;
 		}
 	}
-	return QString();
+	return culling;
 }
 
 int Scene::bindTexture( const QString & fname )
@@ -47,6 +47,8 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QStack>
 #include <QStringList>
 
+#include <vector>
+
 
 //! @file glscene.h Scene
 
@@ -58,6 +60,50 @@ class QAction;
 class QOpenGLContext;
 class QOpenGLFunctions;
 
+
+//! Transforms cached by a dense index, all invalidated at once by advancing the generation
+class TransformCache final
+{
+public:
+	//! Make room for indices below count, so that set() does not move the entries
+	void reserve( int count );
+	//! Invalidate every entry
+	void invalidate();
+	//! Release every entry
+	void reset();
+	//! Invalidate the entry at index, so that the index can be reused
+	void release( int index );
+
+	//! The transform cached at index, or nullptr if it is not valid in the current generation
+	const Transform * get( int index ) const
+	{
+		if ( index < 0 || index >= int( entries.size() ) || entries[index].generation != generation )
+			return nullptr;
+		return &entries[index].transform;
+	}
+
+	bool contains( int index ) const { return get( index ) != nullptr; }
+
+	//! The transform cached at index, or the identity if it is not valid in the current generation
+	Transform value( int index ) const
+	{
+		const Transform * t = get( index );
+		return t ? *t : Transform();
+	}
+
+	const Transform & set( int index, const Transform & t );
+
+private:
+	struct Entry
+	{
+		Transform transform;
+		quint32 generation = 0;
+	};
+
+	std::vector<Entry> entries;
+	quint32 generation = 1;
+};
+
 class Scene final : public QObject
 {
 	Q_OBJECT
@@ -73,6 +119,8 @@ public:
 	void update( const NifModel * nif, const QModelIndex & index );
 
 	void transform( const Transform & trans, float time = 0.0 );
+	//! Makes the next transform() update every node, after the scene or the way it is drawn changed
+	void invalidateTransforms() { transformsValid = false; }
 
 	void draw();
 	void drawShapes();
@@ -81,6 +129,9 @@ public:
 	void drawFurn();
 	void drawSelection() const;
 
+	//! Queues an opaque shape while drawShapes() walks the scene graph; false if it is to be drawn right away
+	bool queueShape( Shape * shape );
+
 	void setSequence( const QString & seqname );
 
 	QString textStats();
@@ -169,12 +220,27 @@ public:
 
 	NodeList roots;
 
-	mutable QHash<int, Transform> worldTrans;
-	mutable QHash<int, Transform> viewTrans;
-	mutable QHash<int, Transform> bhkBodyTrans;
+	//! World and view transforms of the nodes, by Node::sceneId()
+	mutable TransformCache worldTrans;
+	mutable TransformCache viewTrans;
+
+	//! Cache the world transform of a havok body for this frame, by block number
+	void setBodyTrans( int block, const Transform & t );
+	//! Has the transform of a havok body been cached this frame?
+	bool hasBodyTrans( int block ) const;
+	//! The world transform of a havok body this frame, or the identity
+	Transform bodyTrans( int block ) const;
 
 	Transform view;
 
+	//! Is transform() updating every node, rather than only those that moved?
+	bool transformAll = true;
+
+	//! Is the sphere, in world space, outside of the view of the shapes being drawn?
+	bool isCulled( const BoundSphere & bounds ) const { return frustum.isOutside( view * bounds ); }
+	//! The number of shapes skipped by culling in the last drawShapes()
+	int culledShapes = 0;
+
 	bool animate;
 
 	float time;
@@ -190,6 +256,9 @@ public:
 
 	QVector<Shape *> shapes;
 	int registerShape( Shape * shape );
+	int registerNode();
+	//! Release the index of a deleted node for reuse
+	void unregisterNode( int index );
 
 	BoundSphere bounds() const;
 
@@ -206,6 +275,28 @@ public slots:
 	void updateLodLevel( int );
 
 protected:
+	//! The state of the last full transform(), which is skipped while only the view changes
+	bool transformsValid = false;
+	int nodeCount = 0;
+	//! Indices released by unregisterNode(), handed out again before new ones
+	QVector<int> freeNodes;
+
+	//! World transforms of the havok bodies, by their index in bodySlots
+	TransformCache bhkBodyTrans;
+	//! Dense index of each havok body in bhkBodyTrans, by block number
+	QHash<int, int> bodySlots;
+
+	Frustum frustum;
+
+	//! The opaque shapes collected by queueShape(), drawn sorted by their state
+	QVector<Shape *> shapeQueue;
+	bool queueingShapes = false;
+
+	void drawQueue();
+	SceneOptions transformOptions;
+	VisMode transformVisMode;
+	QPersistentModelIndex transformBlock;
+
 	mutable bool sceneBoundsValid, timeBoundsValid;
 	mutable BoundSphere bndSphere;
 	mutable float tMin = 0, tMax = 0;
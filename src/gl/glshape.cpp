@@ -38,6 +38,17 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "io/material.h"
 #include "lib/nvtristripwrapper.h"
 
+#include <QThread>
+
+#include <functional>
+#include <future>
+#include <vector>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define SKIN_SSE2
+#include <emmintrin.h>
+#endif
+
 
 Shape::Shape( Scene * _scene, NifFieldConst _block )
 	: Node( _scene, _block )
@@ -48,6 +59,11 @@ Shape::Shape( Scene * _scene, NifFieldConst _block )
 Shape::~Shape()
 {
 	qDeleteAll( selections );
+	qDeleteAll( coordBuffers );
+
+	// Shapes deleted when the scene is patched leave a gap, so that the numbers of the others stay valid for picking
+	if ( shapeNumber < scene->shapes.count() && scene->shapes.at( shapeNumber ) == this )
+		scene->shapes[shapeNumber] = nullptr;
 }
 
 void Shape::clear()
@@ -59,6 +75,7 @@ void Shape::clear()
 	transVerts.clear();
 	transNorms.clear();
 	transColors.clear();
+	transColorsDirty = true;
 	transTangents.clear();
 	transBitangents.clear();
 	sortedTriangles.clear();
@@ -68,6 +85,9 @@ void Shape::clear()
 	bsesp = nullptr;
 	alphaProperty = nullptr;
 
+	shaderRevision = 0;
+	gpuSkinning = false;
+
 	isDoubleSided = false;
 }
 
@@ -148,6 +168,13 @@ constexpr float VECTOR_MAX_SCALE = 25.0f;
 const Color4 BOUND_SPHERE_COLOR( 1, 1, 1, 0.4f );
 const Color4 BOUND_SPHERE_CENTER_COLOR( 1, 1, 1, 1 );
 
+void Shape::updateTreeBounds()
+{
+	Node::updateTreeBounds();
+	treeBounds |= bounds();
+	treeShapes++;
+}
+
 void Shape::drawShapes( NodeList * secondPass, bool presort )
 {
 	if ( numVerts <= 0 || isHidden() )
@@ -166,13 +193,18 @@ void Shape::drawShapes( NodeList * secondPass, bool presort )
 		return;
 	}
 
+	if ( scene->queueShape( this ) )
+		return;
+
 	// TODO: Option to hide Refraction and other post effects
 
-	// rigid mesh? then pass the transformation on to the gl layer
-	if ( transformRigid ) {
-		glPushMatrix();
-		glMultMatrix( viewTrans() );
-	}
+	// Picking reads the skinned vertices
+	if ( Node::SELECTING )
+		applyCpuSkinning();
+
+	// rigid mesh? then pass the transformation on to the gl layer, skinned vertices are in world space
+	glPushMatrix();
+	glMultMatrix( transformRigid ? viewTrans() : scene->view );
 
 	// Render polygon fill slightly behind alpha transparency, and alpha transparency - behind wireframe
 	glEnable( GL_POLYGON_OFFSET_FILL );
@@ -181,18 +213,20 @@ void Shape::drawShapes( NodeList * secondPass, bool presort )
 	else
 		glPolygonOffset( 1.0f, 2.0f );
 
+	auto fn = scene->renderer->fn;
+
 	glEnableClientState( GL_VERTEX_ARRAY );
-	glVertexPointer( 3, GL_FLOAT, 0, transVerts.constData() );
+	vertexBuffer.vertexPointer( fn, transVerts );
 
 	if ( !Node::SELECTING) { // Normal rendering
 		if ( transNorms.count() > 0 ) {
 			glEnableClientState( GL_NORMAL_ARRAY );
-			glNormalPointer( GL_FLOAT, 0, transNorms.constData() );
+			normalBuffer.normalPointer( fn, transNorms );
 		}
 
 		if ( transColors.count() ) {
 			glEnableClientState( GL_COLOR_ARRAY );
-			glColorPointer( 4, GL_FLOAT, 0, transColors.constData() );
+			colorBuffer.colorPointer( fn, transColors );
 		} else {
 			glColor( Color3( 1.0f, 1.0f, 1.0f ) );
 		}
@@ -202,7 +236,7 @@ void Shape::drawShapes( NodeList * secondPass, bool presort )
 		else
 			glDisable( GL_FRAMEBUFFER_SRGB );
 
-		shader = scene->renderer->setupProgram( this, shader );
+		shader = scene->renderer->setupProgram( this );
 	} else { // Selection rendering
 		if ( scene->isSelModeObject() ) {
 			glSelectionBufferColor( nodeId );
@@ -222,16 +256,16 @@ void Shape::drawShapes( NodeList * secondPass, bool presort )
 	// Draw triangles and strips
 	int lodLevel = isLOD ? scene->lodLevel : -1;
 	if ( lodLevel >= 0 && lodLevel < lodLevels.count() ) {
-		glDrawTriangles( lodLevels[lodLevel] );
+		drawTriangles( lodLevels[lodLevel] );
 	} else {
-		glDrawTriangles( triangles );
+		drawTriangles( triangles, 0, triangles.count() );
 	}
 
-	glDrawTriangles( stripTriangles );
+	drawTriangles( stripTriangles, 0, stripTriangles.count() );
 
 	// Post-drawing triangles and strips
 	if ( !Node::SELECTING )
-		scene->renderer->stopProgram();
+		scene->renderer->releaseProgram();
 
 	glDisableClientState( GL_VERTEX_ARRAY );
 	glDisableClientState( GL_NORMAL_ARRAY );
@@ -253,8 +287,7 @@ void Shape::drawShapes( NodeList * secondPass, bool presort )
 		glEnd();
 	}
 
-	if ( transformRigid )
-		glPopMatrix();
+	glPopMatrix();
 }
 
 void Shape::drawSelection() const
@@ -371,6 +404,7 @@ void Shape::updateData()
 	updateDataImpl();
 
 	numVerts = verts.count();
+	transColorsDirty = true;
 
 	// Validate vertex data
 	normalizeVectorSize( norms, numVerts, hasVertexNormals );
@@ -388,10 +422,14 @@ void Shape::updateData()
 	for ( auto pSelection : selections )
 		pSelection->postUpdate();
 
+	initSkinInfluences();
+
 	// Sort selections from the highest level to the lowest, 
 	// so the deeper a selection is within its block, the closer to the start the selection would be.
 	std::sort( selections.begin(), selections.end(), []( ShapeSelectionBase * a, ShapeSelectionBase * b ) { return a->level > b->level; });
 
+	invalidateBuffers();
+
 	if ( isLOD )
 		emit model->lodSliderChanged( true );
 }
@@ -411,8 +449,11 @@ void Shape::updateImpl( const NifModel * nif, const QModelIndex & index )
 {
 	Node::updateImpl( nif, index );
 
+	// Reset the selected shader program so that its conditions are reassessed
+	if ( shaderRevision && isShaderInput( index ) )
+		shaderRevision = 0;
+
 	if ( index == iBlock ) {
-		shader = ""; // Reset stored shader so it can reassess conditions
 
 		bslsp = nullptr;
 		bsesp = nullptr;
@@ -483,66 +524,379 @@ void Shape::initSkinBones( NifFieldConst nodeMapRoot, NifFieldConst nodeListRoot
 	addBoneSelection( nodeListRoot, nullptr );
 }
 
+void Shape::initSkinInfluences()
+{
+	skinOffsets.clear();
+	skinBones.clear();
+	skinWeights.clear();
+	gpuSkinBones.clear();
+	gpuSkinWeights.clear();
+
+	if ( !isSkinned || numVerts <= 0 )
+		return;
+
+	// Count the influences of each vertex, then turn the counts into offsets
+	skinOffsets.fill( 0, numVerts + 1 );
+	for ( const SkinBone & bone : bones ) {
+		for ( const VertexWeight & vw : bone.vertexWeights ) {
+			if ( vw.vertex >= 0 && vw.vertex < numVerts )
+				skinOffsets[vw.vertex + 1]++;
+		}
+	}
+	for ( int i = 0; i < numVerts; i++ )
+		skinOffsets[i + 1] += skinOffsets[i];
+
+	int nInfluences = skinOffsets[numVerts];
+	skinBones.resize( nInfluences );
+	skinWeights.resize( nInfluences );
+
+	QVector<int> next = skinOffsets;
+	for ( int b = 0; b < bones.count(); b++ ) {
+		for ( const VertexWeight & vw : bones[b].vertexWeights ) {
+			if ( vw.vertex >= 0 && vw.vertex < numVerts ) {
+				int i = next[vw.vertex]++;
+				skinBones[i] = b;
+				skinWeights[i] = vw.weight;
+			}
+		}
+	}
+}
+
+void Shape::initGpuSkinInfluences()
+{
+	gpuSkinBones.fill( Vector4(), numVerts );
+	gpuSkinWeights.fill( Vector4(), numVerts );
+	gpuSkinBoneBuffer.invalidate();
+	gpuSkinWeightBuffer.invalidate();
+
+	if ( skinOffsets.count() != numVerts + 1 )
+		return;
+
+	for ( int v = 0; v < numVerts; v++ ) {
+		// Keep the four strongest influences, sorted by weight
+		int best[4] = { -1, -1, -1, -1 };
+		for ( int i = skinOffsets[v]; i < skinOffsets[v + 1]; i++ ) {
+			for ( int k = 0; k < 4; k++ ) {
+				if ( best[k] < 0 || skinWeights[i] > skinWeights[best[k]] ) {
+					for ( int j = 3; j > k; j-- )
+						best[j] = best[j - 1];
+					best[k] = i;
+					break;
+				}
+			}
+		}
+
+		// Scale the weights back to a total of one, so that the blended matrix keeps w at one
+		float total = 0.0f;
+		for ( int k = 0; k < 4 && best[k] >= 0; k++ )
+			total += skinWeights[best[k]];
+		if ( total <= 0.0f )
+			continue;
+
+		for ( int k = 0; k < 4 && best[k] >= 0; k++ ) {
+			gpuSkinBones[v][k] = skinBones[best[k]];
+			gpuSkinWeights[v][k] = skinWeights[best[k]] / total;
+		}
+	}
+}
+
+//! Minimum number of vertices for each thread of CPU skinning
+static const int SKIN_PARALLEL_MIN_VERTICES = 16384;
+
+//! Bone transform in columns: rotation * scale, translation and then the rotation alone for the normals
+struct SkinMatrix
+{
+	alignas(16) float c[7][4];
+
+	SkinMatrix( const Transform & t )
+	{
+		for ( int col = 0; col < 3; col++ ) {
+			for ( int row = 0; row < 3; row++ ) {
+				c[col][row] = t.rotation( row, col ) * t.scale;
+				c[col + 4][row] = t.rotation( row, col );
+			}
+			c[col][3] = c[col + 4][3] = 0.0f;
+		}
+		for ( int row = 0; row < 3; row++ )
+			c[3][row] = t.translation[row];
+		c[3][3] = 0.0f;
+	}
+};
+
+//! Inputs and outputs of CPU skinning; the vector arrays are normals, tangents and bitangents, nullptr if unused
+struct SkinArrays
+{
+	const int * offsets;
+	const int * bones;
+	const float * weights;
+	const SkinMatrix * matrices;
+
+	const Vector3 * verts;
+	Vector3 * transVerts;
+	const Vector3 * vectors[3];
+	Vector3 * transVectors[3];
+};
+
+//! Skins the vertices [first, last) by blending the matrices of their bones
+static void skinVertices( const SkinArrays & a, int first, int last )
+{
+	for ( int v = first; v < last; v++ ) {
+		int iBegin = a.offsets[v];
+		int iEnd = a.offsets[v + 1];
+
+#ifdef SKIN_SSE2
+		__m128 c[7];
+		for ( int j = 0; j < 7; j++ )
+			c[j] = _mm_setzero_ps();
+
+		for ( int i = iBegin; i < iEnd; i++ ) {
+			__m128 w = _mm_set1_ps( a.weights[i] );
+			const SkinMatrix & m = a.matrices[a.bones[i]];
+			for ( int j = 0; j < 7; j++ )
+				c[j] = _mm_add_ps( c[j], _mm_mul_ps( w, _mm_load_ps( m.c[j] ) ) );
+		}
+
+		auto transform = [&c]( const Vector3 & in, int col ) {
+			__m128 r = _mm_add_ps( _mm_mul_ps( c[col], _mm_set1_ps( in[0] ) ),
+			                       _mm_add_ps( _mm_mul_ps( c[col + 1], _mm_set1_ps( in[1] ) ),
+			                                   _mm_mul_ps( c[col + 2], _mm_set1_ps( in[2] ) ) ) );
+			if ( col == 0 )
+				r = _mm_add_ps( r, c[3] );
+
+			alignas(16) float out[4];
+			_mm_store_ps( out, r );
+			return Vector3( out[0], out[1], out[2] );
+		};
+#else
+		float c[7][3] = {};
+		for ( int i = iBegin; i < iEnd; i++ ) {
+			float w = a.weights[i];
+			const SkinMatrix & m = a.matrices[a.bones[i]];
+			for ( int j = 0; j < 7; j++ ) {
+				c[j][0] += w * m.c[j][0];
+				c[j][1] += w * m.c[j][1];
+				c[j][2] += w * m.c[j][2];
+			}
+		}
+
+		auto transform = [&c]( const Vector3 & in, int col ) {
+			Vector3 r;
+			for ( int row = 0; row < 3; row++ ) {
+				r[row] = c[col][row] * in[0] + c[col + 1][row] * in[1] + c[col + 2][row] * in[2];
+				if ( col == 0 )
+					r[row] += c[3][row];
+			}
+			return r;
+		};
+#endif
+
+		a.transVerts[v] = transform( a.verts[v], 0 );
+		for ( int k = 0; k < 3; k++ ) {
+			if ( a.vectors[k] )
+				a.transVectors[k][v] = transform( a.vectors[k][v], 4 ).normalize();
+		}
+	}
+}
+
+//! Shares the transformed array with the data, invalidating the buffer only if it was not shared yet
+static void shareArray( QVector<Vector3> & trans, const QVector<Vector3> & data, GLBuffer & buffer )
+{
+	if ( trans.constData() != data.constData() || trans.count() != data.count() ) {
+		trans = data;
+		buffer.invalidate();
+	}
+}
+
+void Shape::applySkinning( const Transform & skinTransform )
+{
+	// The skinned vertices stay as they are while nothing they depend on moved
+	if ( !transformRigid && !scene->transformAll && !isSkinningAnimated() )
+		return;
+
+	// The selected shape is skinned on the CPU so that its selection can be drawn from the skinned vertices
+	if ( scene->renderer->canSkin( this ) && !isDataSelected() && applyGpuSkinningTransforms( skinTransform ) )
+		return;
+
+	applySkinningTransforms( skinTransform );
+}
+
+bool Shape::applyGpuSkinningTransforms( const Transform & skinTransform )
+{
+	QVector<Matrix4> matrices( bones.count() );
+	BoundSphere skinBounds;
+	for ( int b = 0; b < bones.count(); b++ ) {
+		const SkinBone & bone = bones[b];
+		Transform boneTrans = bone.localTransform( skinTransform, skeletonRoot );
+		matrices[b] = ( boneTrans * bone.transform ).toMatrix4();
+
+		// The bounding spheres of the bones are in bone space
+		skinBounds |= boneTrans * bone.boundSphere;
+	}
+
+	// Without the bones' bounding spheres the bounds could only come from the skinned vertices
+	if ( skinBounds.radius <= 0.0f )
+		return false;
+
+	transformRigid = false;
+	gpuSkinning = true;
+	gpuSkinMatrices = matrices;
+	lastSkinTransform = skinTransform;
+
+	if ( gpuSkinBones.count() != numVerts )
+		initGpuSkinInfluences();
+
+	// The vertex shader reads the unskinned arrays
+	shareArray( transVerts, verts, vertexBuffer );
+	shareArray( transNorms, norms, normalBuffer );
+	shareArray( transTangents, tangents, tangentBuffer );
+	shareArray( transBitangents, bitangents, bitangentBuffer );
+
+	boundSphere = skinBounds;
+	boundSphere.applyInv( worldTrans() );
+	needUpdateSkinBounds = false;
+	needUpdateBounds = false;
+	return true;
+}
+
+bool Shape::isSkinningAnimated() const
+{
+	if ( worldChanged )
+		return true;
+
+	// Morphs change the vertices
+	for ( Controller * ctrl : controllers ) {
+		if ( ctrl->isActive() )
+			return true;
+	}
+
+	for ( const SkinBone & bone : bones ) {
+		if ( bone.node && bone.node->hasWorldChanged() )
+			return true;
+	}
+
+	return false;
+}
+
+void Shape::applyCpuSkinning()
+{
+	if ( gpuSkinning )
+		applySkinningTransforms( lastSkinTransform );
+}
+
+bool Shape::isDataSelected() const
+{
+	const QModelIndex & iSelBlock = scene->currentBlock;
+	return iSelBlock.isValid()
+		&& ( iSelBlock == iBlock || iSelBlock == iData || iSelBlock == iSkin || iSelBlock == iSkinData || iSelBlock == iSkinPart || iSelBlock == iExtraData );
+}
+
 void Shape::applySkinningTransforms( const Transform & skinTransform )
 {
 	transformRigid = false;
+	gpuSkinning = false;
+	lastSkinTransform = skinTransform;
+
+	std::vector<SkinMatrix> matrices;
+	matrices.reserve( bones.count() );
+	for ( const SkinBone & bone : bones )
+		matrices.emplace_back( bone.localTransform( skinTransform, skeletonRoot ) * bone.transform );
+
+	// Vectors past the skinned vertices are not influenced by any bone
+	auto prepare = []( QVector<Vector3> & trans, int count, int nSkinned ) {
+		trans.resize( count );
+		for ( int i = nSkinned; i < count; i++ )
+			trans[i] = Vector3();
+		return trans.data();
+	};
 
-	transVerts.resize( numVerts );
-	transVerts.fill( Vector3() );
-	transNorms.resize( norms.count() );
-	transNorms.fill( Vector3() );
-	transTangents.resize( tangents.count() );
-	transTangents.fill( Vector3() );
-	transBitangents.resize( bitangents.count() );
-	transBitangents.fill( Vector3() );
+	int nSkinned = ( skinOffsets.count() == numVerts + 1 ) ? numVerts : 0;
+
+	SkinArrays arrays;
+	arrays.offsets = skinOffsets.constData();
+	arrays.bones = skinBones.constData();
+	arrays.weights = skinWeights.constData();
+	arrays.matrices = matrices.data();
+	arrays.verts = verts.constData();
+	arrays.transVerts = prepare( transVerts, numVerts, nSkinned );
+
+	const QVector<Vector3> * vectors[3] = { &norms, &tangents, &bitangents };
+	QVector<Vector3> * transVectors[3] = { &transNorms, &transTangents, &transBitangents };
+	bool hasVectors[3] = { hasVertexNormals, hasVertexTangents, hasVertexBitangents };
+	for ( int k = 0; k < 3; k++ ) {
+		int count = vectors[k]->count();
+		bool skin = hasVectors[k] && count >= nSkinned;
+		arrays.vectors[k] = skin ? vectors[k]->constData() : nullptr;
+		arrays.transVectors[k] = prepare( *transVectors[k], count, skin ? nSkinned : 0 );
+	}
 
-	for ( SkinBone & bone : bones ) {
-		Transform t = bone.localTransform( skinTransform, skeletonRoot ) * bone.transform;
+	int threads = std::min( QThread::idealThreadCount(), nSkinned / SKIN_PARALLEL_MIN_VERTICES );
+	if ( threads <= 1 ) {
+		skinVertices( arrays, 0, nSkinned );
+	} else {
+		std::vector<std::future<void>> jobs;
+		for ( int t = 0; t < threads; t++ )
+			jobs.push_back( std::async( std::launch::async, skinVertices, std::cref( arrays ), nSkinned * t / threads, nSkinned * ( t + 1 ) / threads ) );
 
-		for ( const VertexWeight & vw : bone.vertexWeights ) {
-			transVerts[vw.vertex] += t * verts[vw.vertex] * vw.weight;
-			if ( hasVertexNormals )
-				transNorms[vw.vertex] += t.rotation * norms[vw.vertex] * vw.weight;
-			if ( hasVertexTangents )
-				transTangents[vw.vertex] += t.rotation * tangents[vw.vertex] * vw.weight;
-			if ( hasVertexBitangents )
-				transBitangents[vw.vertex] += t.rotation * bitangents[vw.vertex] * vw.weight;
-		}
+		for ( auto & job : jobs )
+			job.get();
 	}
 
-	for ( auto & v : transNorms )
-		v.normalize();
-	for ( auto & v : transTangents )
-		v.normalize();
-	for ( auto & v : transBitangents )
-		v.normalize();
+	vertexBuffer.invalidate();
+	normalBuffer.invalidate();
+	tangentBuffer.invalidate();
+	bitangentBuffer.invalidate();
 
-	boundSphere = BoundSphere( transVerts );
-	boundSphere.applyInv( viewTrans() );
+	// The bounds are only computed from the skinned vertices when they are asked for
+	skinWorldTrans = worldTrans();
+	needUpdateSkinBounds = true;
 	needUpdateBounds = false;
 }
 
+void Shape::updateSkinBounds() const
+{
+	if ( needUpdateSkinBounds ) {
+		needUpdateSkinBounds = false;
+		boundSphere = BoundSphere( transVerts );
+		boundSphere.applyInv( skinWorldTrans );
+	}
+}
+
 void Shape::applyRigidTransforms()
 {
 	transformRigid = true;
+	gpuSkinning = false;
+
+	// Finish the bounds of the skinned vertices before they are replaced
+	updateSkinBounds();
 
-	transVerts = verts;
-	transNorms = norms;
-	transTangents = tangents;
-	transBitangents = bitangents;
+	// The arrays stay shared with the data while it does not change, so the buffers are left alone
+	shareArray( transVerts, verts, vertexBuffer );
+	shareArray( transNorms, norms, normalBuffer );
+	shareArray( transTangents, tangents, tangentBuffer );
+	shareArray( transBitangents, bitangents, bitangentBuffer );
 }
 
 void Shape::applyColorTransforms( float alphaBlend )
 {
 	auto shaderColorMode = bssp ? bssp->vertexColorMode : ShaderColorMode::FromData;
 	bool doVCs = ( shaderColorMode == ShaderColorMode::FromData ) ? hasVertexColors : ( shaderColorMode == ShaderColorMode::Yes );
+	bool opaque = bssp && ( bssp->isVertexAlphaAnimation || !bssp->hasVertexAlpha );
+
+	// Only rebuilt, and uploaded again, after the data, the shader flags or the material alpha have changed
+	if ( !transColorsDirty && doVCs == transColorsVCs && opaque == transColorsOpaque && alphaBlend == transColorsAlpha )
+		return;
+
+	transColorsDirty = false;
+	transColorsVCs = doVCs;
+	transColorsOpaque = opaque;
+	transColorsAlpha = alphaBlend;
 
 	if ( doVCs && numVerts > 0 ) {
 		transColors = colors;
 		if ( alphaBlend != 1.0f ) {
 			for ( auto & c : transColors )
 				c.setAlpha( c.alpha() * alphaBlend );
-		} else if ( bssp && ( bssp->isVertexAlphaAnimation || !bssp->hasVertexAlpha ) ) {
+		} else if ( opaque ) {
 			for ( auto & c : transColors )
 				c.setAlpha( 1.0f );
 		}
@@ -556,6 +910,51 @@ void Shape::applyColorTransforms( float alphaBlend )
 		for ( int i = transColors.count(); i < numVerts; i++ )
 			transColors << Color4( 0, 0, 0, 1 );
 	}
+
+	colorBuffer.invalidate();
+}
+
+GLBuffer * Shape::coordBuffer( int set )
+{
+	while ( coordBuffers.count() <= set )
+		coordBuffers << new GLBuffer();
+
+	return coordBuffers[set];
+}
+
+void Shape::invalidateBuffers()
+{
+	vertexBuffer.invalidate();
+	normalBuffer.invalidate();
+	colorBuffer.invalidate();
+	tangentBuffer.invalidate();
+	bitangentBuffer.invalidate();
+	for ( GLBuffer * buffer : coordBuffers )
+		buffer->invalidate();
+
+	triangleBuffer.invalidate();
+	stripBuffer.invalidate();
+	sortedBuffer.invalidate();
+}
+
+void Shape::drawTriangles( const QVector<Triangle> & tris, int iStartOffset, int nTris )
+{
+	auto fn = scene->renderer->fn;
+
+	if ( &tris == &triangles )
+		triangleBuffer.drawTriangles( fn, tris, iStartOffset, nTris );
+	else if ( &tris == &stripTriangles )
+		stripBuffer.drawTriangles( fn, tris, iStartOffset, nTris );
+	else if ( &tris == &sortedTriangles )
+		sortedBuffer.drawTriangles( fn, tris, iStartOffset, nTris );
+	else
+		glDrawTriangles( tris, iStartOffset, nTris );
+}
+
+void Shape::drawTriangles( const TriangleRange * range )
+{
+	if ( range )
+		drawTriangles( range->triangles(), range->realStart, range->realLength );
 }
 
 void Shape::resetBlockData()
@@ -608,6 +1007,22 @@ void Shape::resetBlockData()
 	selections.clear();
 }
 
+bool Shape::isShaderInput( const QModelIndex & index ) const
+{
+	if ( index == iBlock || index == iData )
+		return true;
+
+	// The parents' property links decide which properties are active
+	for ( const Node * node = parentNode(); node; node = node->parentNode() ) {
+		if ( node->index() == index )
+			return true;
+	}
+
+	PropertyList props;
+	activeProperties( props );
+	return props.get( index ) != nullptr;
+}
+
 void Shape::updateShader()
 {
 	if ( bslsp ) {
@@ -680,22 +1095,25 @@ void Shape::drawSelection_begin( DrawSelectionMode newMode ) const
 	if ( newMode == drawSelectionMode )
 		return;
 
-	auto getUseViewTrans = [this]( DrawSelectionMode drawMode ) -> bool {
+	// The selection is drawn in the space of the shape, or in world space for the skinned vertices
+	enum class SelectionSpace { NONE, WORLD, SHAPE };
+	auto getSpace = [this]( DrawSelectionMode drawMode ) -> SelectionSpace {
 		if ( drawMode == DrawSelectionMode::NO )
-			return false;
-		if ( drawMode == DrawSelectionMode::BOUND_SPHERE )
-			return true;
-		return transformRigid;
+			return SelectionSpace::NONE;
+		if ( drawMode == DrawSelectionMode::BOUND_SPHERE || transformRigid )
+			return SelectionSpace::SHAPE;
+		return SelectionSpace::WORLD;
 		};
 
-	bool oldUseViewTrans = getUseViewTrans( drawSelectionMode );
-	bool newUseViewTrans = getUseViewTrans( newMode );
-	if ( oldUseViewTrans != newUseViewTrans ) {
-		if ( newUseViewTrans ) {
-			glPushMatrix();
-			glMultMatrix( viewTrans() );
-		} else {
+	SelectionSpace oldSpace = getSpace( drawSelectionMode );
+	SelectionSpace newSpace = getSpace( newMode );
+	if ( oldSpace != newSpace ) {
+		if ( oldSpace != SelectionSpace::NONE )
 			glPopMatrix();
+
+		if ( newSpace != SelectionSpace::NONE ) {
+			glPushMatrix();
+			glMultMatrix( ( newSpace == SelectionSpace::SHAPE ) ? viewTrans() : scene->view );
 		}
 	}
 
@@ -249,6 +249,8 @@ public:
 	void drawShapes( NodeList * secondPass, bool presort ) override;
 	void drawSelection() const override;
 
+	void updateTreeBounds() override;
+
 	QModelIndex vertexAt( int vertexIndex ) const;
 
 	bool isEditorMarker() const;
@@ -335,11 +337,30 @@ protected:
 	QVector<Vector3> transNorms;
 	//! Transformed colors (alpha blended)
 	QVector<Color4> transColors;
+	//! Whether the data changed since transColors was built; the other inputs it was built from follow
+	bool transColorsDirty = true;
+	bool transColorsVCs = false;
+	bool transColorsOpaque = false;
+	float transColorsAlpha = 1.0f;
 	//! Transformed tangents
 	QVector<Vector3> transTangents;
 	//! Transformed bitangents
 	QVector<Vector3> transBitangents;
 
+	//! Buffer objects of the transformed vertex arrays
+	GLBuffer vertexBuffer, normalBuffer, colorBuffer, tangentBuffer, bitangentBuffer;
+	//! Buffer objects of the UV coordinate sets, created on first use
+	QVector<GLBuffer *> coordBuffers;
+	//! Buffer objects of the triangle lists
+	GLBuffer triangleBuffer{ GL_ELEMENT_ARRAY_BUFFER }, stripBuffer{ GL_ELEMENT_ARRAY_BUFFER }, sortedBuffer{ GL_ELEMENT_ARRAY_BUFFER };
+
+	GLBuffer * coordBuffer( int set );
+	//! Marks all buffer objects for a full upload, after the shape data has been rebuilt
+	void invalidateBuffers();
+	//! Draws a range of the triangles or strip triangles from their buffer object
+	void drawTriangles( const QVector<Triangle> & tris, int iStartOffset, int nTris );
+	void drawTriangles( const TriangleRange * range );
+
 	//! Toggle for skinning
 	bool isSkinned = false;
 
@@ -349,8 +370,40 @@ protected:
 
 	void initSkinBones( NifFieldConst nodeMapRoot, NifFieldConst nodeListRoot, NifFieldConst block );
 
+	//! Skin influences gathered per vertex in structure-of-arrays layout:
+	//! the influences of vertex i are [skinOffsets[i], skinOffsets[i + 1]) in skinBones and skinWeights
+	QVector<int> skinOffsets;
+	QVector<int> skinBones;
+	QVector<float> skinWeights;
+
+	void initSkinInfluences();
+
+	//! The four strongest bone influences of each vertex for skinning in the vertex shader, built on first use
+	QVector<Vector4> gpuSkinBones;
+	QVector<Vector4> gpuSkinWeights;
+	GLBuffer gpuSkinBoneBuffer, gpuSkinWeightBuffer;
+
+	void initGpuSkinInfluences();
+
+	//! Are the vertices blended by the vertex shader? The transformed arrays then hold the unskinned data.
+	bool gpuSkinning = false;
+	//! Bone matrices for the vertex shader
+	QVector<Matrix4> gpuSkinMatrices;
+	//! Transform of the last skinning, to skin on the CPU on demand
+	Transform lastSkinTransform;
+
+	//! Skins the vertices into world space, in the vertex shader when the shape's program supports it, otherwise on the CPU
+	void applySkinning( const Transform & skinTransform );
+	//! Did the shape, its bones or its morphs move in the last Scene::transform?
+	bool isSkinningAnimated() const;
+	//! Returns false, leaving the shape as it is, if the bones have no bounding spheres to bound the shape with
+	bool applyGpuSkinningTransforms( const Transform & skinTransform );
 	void applySkinningTransforms( const Transform & skinTransform );
+	//! Skins the vertices on the CPU if they were left to the vertex shader, for picking and selection
+	void applyCpuSkinning();
 	void applyRigidTransforms();
+	//! Whether one of the shape's blocks is selected in the scene
+	bool isDataSelected() const;
 
 	void applyColorTransforms( float alphaBlend = 1.0f );
 
@@ -358,6 +411,10 @@ protected:
 
 	//! Holds the name of the shader, or "" if no shader
 	QString shader = "";
+	//! Index of the first shader program that matched and bound in Renderer::setupProgram, -1 for fixed function
+	int shaderProgram = -1;
+	//! Renderer::programsRevision the shader program was selected for, 0 to select it again
+	int shaderRevision = 0;
 
 	//! Shader property
 	BSShaderProperty * bssp = nullptr;
@@ -386,9 +443,17 @@ protected:
 	bool translucent = false;
 
 	void updateShader();
+	//! Whether the shader program conditions may depend on the block
+	bool isShaderInput( const QModelIndex & index ) const;
 
 	mutable BoundSphere boundSphere;
 	mutable bool needUpdateBounds = false;
+	//! Are the bounds still to be computed from the skinned vertices?
+	mutable bool needUpdateSkinBounds = false;
+	//! World transform of the shape when its vertices were skinned
+	Transform skinWorldTrans;
+
+	void updateSkinBounds() const;
 
 	bool isLOD = false;
 	QVector<TriangleRange *> lodLevels;
@@ -47,13 +47,27 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QListView>
 #include <QOpenGLContext>
 #include <QOpenGLFunctions>
+#include <QRunnable>
 #include <QSettings>
+#include <QThreadPool>
+#include <QTimer>
+#include <QVector>
 
 #include <algorithm>
+#include <functional>
 
 
 //! @file gltex.cpp TexCache management
 
+//! Largest mip of archived textures loaded in the first pass, before the full resolution
+static const int TEXTURE_PREVIEW_SIZE = 256;
+//! Default memory budget of the texture files in MiB
+static const int TEXTURE_BUDGET_MB = 1024;
+//! Passed to find() as the preview size to read only the header of archived textures
+static const int TEXTURE_HEADER_ONLY = -1;
+//! Delay after the last change to a watched folder before the changed textures are reloaded
+static const int TEXTURE_RELOAD_DELAY_MS = 250;
+
 #ifdef WIN32
 PFNGLACTIVETEXTUREARBPROC glActiveTextureARB = nullptr;
 PFNGLCLIENTACTIVETEXTUREARBPROC glClientActiveTextureARB = nullptr;
@@ -62,6 +76,13 @@ PFNGLCLIENTACTIVETEXTUREARBPROC glClientActiveTextureARB = nullptr;
 //! Number of texture units
 GLint num_texture_units = 0;
 
+//! Whether the state below is tracked, only within one Scene::drawShapes() pass; the contexts share it
+static bool texture_units_tracked = false;
+//! The texture unit activated last, -1 if unknown
+static int active_texture_unit = -1;
+//! Bit mask of the texture units that may have been set up since they were last reset
+static quint32 used_texture_units = 0xFFFFFFFF;
+
 //! Maximum anisotropy
 float max_anisotropy = 1.0f;
 void set_max_anisotropy()
@@ -113,9 +134,13 @@ bool activateTextureUnit( int stage )
 		return ( stage == 0 );
 
 	if ( stage < num_texture_units ) {
+		if ( !texture_units_tracked || stage != active_texture_unit ) {
+			glActiveTextureARB( GL_TEXTURE0 + stage );
+			glClientActiveTextureARB( GL_TEXTURE0 + stage );
+			active_texture_unit = stage;
+		}
 
-		glActiveTextureARB( GL_TEXTURE0 + stage );
-		glClientActiveTextureARB( GL_TEXTURE0 + stage );
+		used_texture_units |= 1u << stage;
 		return true;
 	}
 
@@ -129,7 +154,16 @@ void resetTextureUnits( int numTex )
 		return;
 	}
 
+	// The first unit is also set up without activating it, so it is always reset
+	used_texture_units |= 1;
+
 	for ( int x = numTex - 1; x >= 0; x-- ) {
+		// Outside of a tracked pass every unit is reset
+		if ( texture_units_tracked && !( used_texture_units & ( 1u << x ) ) )
+			continue;
+
+		used_texture_units &= ~( 1u << x );
+
 		glActiveTextureARB( GL_TEXTURE0 + x );
 		glDisable( GL_TEXTURE_2D );
 		glMatrixMode( GL_TEXTURE );
@@ -138,6 +172,15 @@ void resetTextureUnits( int numTex )
 		glClientActiveTextureARB( GL_TEXTURE0 + x );
 		glDisableClientState( GL_TEXTURE_COORD_ARRAY );
 	}
+
+	active_texture_unit = 0;
+}
+
+void trackTextureUnits( bool track )
+{
+	texture_units_tracked = track;
+	active_texture_unit = -1;
+	used_texture_units = 0xFFFFFFFF;
 }
 
 
@@ -145,14 +188,49 @@ void resetTextureUnits( int numTex )
  *  TexCache
  */
 
+//! Runs TexCache::decode() on the decoder pool
+class TexDecodeTask final : public QRunnable
+{
+public:
+	TexDecodeTask( std::function<void()> f ) : func( std::move( f ) ) {}
+
+	void run() override final { func(); }
+
+private:
+	std::function<void()> func;
+};
+
 TexCache::TexCache( QObject * parent ) : QObject( parent )
 {
 	watcher = new QFileSystemWatcher( this );
-	connect( watcher, &QFileSystemWatcher::fileChanged, this, &TexCache::fileChanged );
+	connect( watcher, &QFileSystemWatcher::directoryChanged, this, &TexCache::directoryChanged );
+
+	reloadTimer = new QTimer( this );
+	reloadTimer->setSingleShot( true );
+	reloadTimer->setInterval( TEXTURE_RELOAD_DELAY_MS );
+	connect( reloadTimer, &QTimer::timeout, this, &TexCache::reloadChanged );
+
+	previewTimer = new QTimer( this );
+	previewTimer->setSingleShot( true );
+	previewTimer->setInterval( 0 );
+	connect( previewTimer, &QTimer::timeout, this, &TexCache::loadNextPreviewed );
+
+	decoders = new QThreadPool( this );
+
+	evictTimer = new QTimer( this );
+	evictTimer->setSingleShot( true );
+	evictTimer->setInterval( 0 );
+	connect( evictTimer, &QTimer::timeout, this, &TexCache::evict );
+
+	QSettings settings;
+	maxBytes = qint64( settings.value( "Settings/Render/General/Texture Budget", TEXTURE_BUDGET_MB ).toInt() ) * 1024 * 1024;
 }
 
 TexCache::~TexCache()
 {
+	// The workers refer to this object
+	decoders->clear();
+	decoders->waitForDone();
 	//flush();
 }
 
@@ -163,6 +241,23 @@ QString TexCache::find( const QString & file, const QString & nifdir, Game::Game
 
 QString TexCache::find( const QString & file, const QString & nifdir, QByteArray & data, Game::GameMode game )
 {
+	bool preview = false;
+	return find( file, nifdir, data, game, 0, preview );
+}
+
+void TexCache::prefetch( const QString & file, const QString & nifdir, Game::GameMode game )
+{
+	// Same request as the first bind() of the texture
+	QByteArray data;
+	bool preview = false;
+	find( file, nifdir, data, game, TEXTURE_PREVIEW_SIZE, preview );
+}
+
+QString TexCache::find( const QString & file, const QString & nifdir, QByteArray & data, Game::GameMode game,
+						int previewSize, bool & preview )
+{
+	preview = false;
+
 	if ( file.isEmpty() )
 		return QString();
 
@@ -231,12 +326,19 @@ QString TexCache::find( const QString & file, const QString & nifdir, QByteArray
 		}
 
 		// Search through archives last, and load any requested textures into memory.
-		for ( FSArchiveFile * archive : Game::GameManager::opened_archives(game) ) {
+		// The handles keep the archives open if the game manager is reset while a worker thread searches them.
+		for ( const auto & handle : Game::GameManager::opened_archive_handles(game) ) {
+			FSArchiveFile * archive = handle->getArchive();
 			if ( archive ) {
 				filename = QDir::fromNativeSeparators( filename.toLower() );
 				if ( archive->hasFile( filename ) ) {
 					QByteArray outData;
-					archive->fileContents( filename, outData );
+					if ( previewSize == TEXTURE_HEADER_ONLY && archive->fileHeader( filename, outData, DDS_PROBE_SIZE ) )
+						preview = true;
+					else if ( previewSize > 0 && archive->textureContents( filename, outData, previewSize ) )
+						preview = true;
+					else
+						archive->fileContents( filename, outData );
 
 					if ( !outData.isEmpty() ) {
 						data = outData;
@@ -261,7 +363,7 @@ QString TexCache::find( const QString & file, const QString & nifdir, QByteArray
 					filename.prepend( "textures\\" );
 			}
 
-			return find( filename, nifdir, data, game );
+			return find( filename, nifdir, data, game, previewSize, preview );
 		}
 
 		if ( !replaceExt )
@@ -273,7 +375,7 @@ QString TexCache::find( const QString & file, const QString & nifdir, QByteArray
 
 	bool searchFallback = settings.value("Settings/Resources/Other Games Fallback", true).toBool();
 	if ( searchFallback && game != Game::OTHER )
-		return find(file, nifdir, data, Game::OTHER);
+		return find(file, nifdir, data, Game::OTHER, previewSize, preview);
 
 	// Fix separators
 	filename = QDir::toNativeSeparators( filename );
@@ -284,6 +386,29 @@ QString TexCache::find( const QString & file, const QString & nifdir, QByteArray
 	return filename;
 }
 
+bool TexCache::probe( const QString & file, const QString & nifdir, QString & filepath, QString & format,
+					  GLuint & width, GLuint & height, GLuint & mipmaps, Game::GameMode game )
+{
+	QByteArray header;
+	bool partial = false;
+	filepath = find( file, nifdir, header, game, TEXTURE_HEADER_ONLY, partial );
+
+	if ( header.isEmpty() ) {
+		QFile f( filepath );
+		if ( !f.open( QIODevice::ReadOnly ) ) {
+			filepath.clear();
+			return false;
+		}
+
+		header = f.read( DDS_PROBE_SIZE );
+	}
+
+	if ( !filepath.endsWith( ".dds", Qt::CaseInsensitive ) )
+		return false;
+
+	return texProbeDDS( header, format, width, height, mipmaps );
+}
+
 /*!
  * Note: all original morrowind nifs use name.ext only for addressing the
  * textures, but most mods use something like textures/[subdir/]name.ext.
@@ -336,31 +461,107 @@ bool TexCache::isSupported( const QString & filePath )
 	return texIsSupported( filePath );
 }
 
-void TexCache::fileChanged( const QString & filepath )
+void TexCache::watch( Tex * tx )
 {
-	QMutableHashIterator<QString, Tex *> it( textures );
+	if ( watchedFiles.contains( tx->filepath, tx->filename ) )
+		return;
 
-	while ( it.hasNext() ) {
-		it.next();
+	QFileInfo file( tx->filepath );
+	if ( !file.exists() || !file.isWritable() )
+		return;
 
-		Tex * tx = it.value();
+	watchedFiles.insert( tx->filepath, tx->filename );
 
-		if ( tx && tx->filepath == filepath ) {
-			// Remove from watcher now to prevent multiple signals
-			watcher->removePath( tx->filepath );
-			if ( QFile::exists( tx->filepath ) ) {
-				tx->reload = true;
-				emit sigRefresh();
-			} else {
-				it.remove();
+	auto & files = watchedDirs[file.absolutePath()];
+	if ( files.isEmpty() )
+		watcher->addPath( file.absolutePath() );
+
+	if ( !files.contains( tx->filepath ) )
+		files.insert( tx->filepath, file.lastModified() );
+}
+
+void TexCache::unwatch( Tex * tx )
+{
+	if ( !watchedFiles.remove( tx->filepath, tx->filename ) || watchedFiles.contains( tx->filepath ) )
+		return;
+
+	QString dir = QFileInfo( tx->filepath ).absolutePath();
 
-				if ( tx->id )
-					glDeleteTextures( 1, &tx->id );
+	auto it = watchedDirs.find( dir );
+	if ( it != watchedDirs.end() ) {
+		it->remove( tx->filepath );
 
-				delete tx;
+		if ( it->isEmpty() ) {
+			watcher->removePath( dir );
+			watchedDirs.erase( it );
+		}
+	}
+}
+
+void TexCache::directoryChanged( const QString & dir )
+{
+	// Editors often write a file in several steps, so wait for the folder to settle
+	changedDirs.insert( dir );
+	reloadTimer->start();
+}
+
+void TexCache::reloadChanged()
+{
+	QStringList changed;
+
+	for ( const QString & dir : changedDirs ) {
+		auto it = watchedDirs.find( dir );
+		if ( it == watchedDirs.end() )
+			continue;
+
+		for ( auto file = it->begin(); file != it->end(); ++file ) {
+			QFileInfo info( file.key() );
+			QDateTime modified = info.exists() ? info.lastModified() : QDateTime();
+
+			if ( modified != file.value() ) {
+				file.value() = modified;
+				changed.append( file.key() );
 			}
 		}
 	}
+
+	changedDirs.clear();
+
+	for ( const QString & filepath : changed )
+		fileChanged( filepath );
+
+	if ( !changed.isEmpty() )
+		emit sigRefresh();
+}
+
+void TexCache::fileChanged( const QString & filepath )
+{
+	bool exists = QFile::exists( filepath );
+
+	for ( const QString & filename : watchedFiles.values( filepath ) ) {
+		Tex * tx = textures.value( filename );
+		if ( !tx )
+			continue;
+
+		if ( exists ) {
+			// Decoded in the background by the next bind(), the old version is shown until then
+			tx->reload = true;
+		} else {
+			unwatch( tx );
+			textures.remove( filename );
+			previewed.removeAll( filename );
+			destroy( tx );
+		}
+	}
+}
+
+GLuint TexCache::textureId( const QString & fname ) const
+{
+	Tex * tx = textures.value( fname );
+	if ( !tx || tx->id == 0xFFFFFFFF )
+		return 0;
+
+	return tx->id;
 }
 
 int TexCache::bind( const QString & fname, Game::GameMode game )
@@ -383,29 +584,379 @@ int TexCache::bind( const QString & fname, Game::GameMode game )
 	if ( tx->id == 0xFFFFFFFF )
 		return 0;
 
-	QByteArray outData;
+	// The first bind in a frame schedules the eviction pass for after the frame
+	if ( tx->lastBound != frame ) {
+		tx->lastBound = frame;
+		if ( !evictTimer->isActive() )
+			evictTimer->start();
+	}
+
+	// Reloads are always decoded in the background so that editing a texture doesn't stall the view
+	if ( ( backgroundLoading || ( tx->reload && tx->id ) ) && ( !tx->id || tx->reload ) ) {
+		// Keep the previous version of the texture, if any, until the new one is decoded
+		if ( !uploadDecoded( tx, game ) ) {
+			if ( !tx->id )
+				return 0;
+
+			if ( !tx->target )
+				tx->target = GL_TEXTURE_2D;
+
+			glBindTexture( tx->target, tx->id );
+			return tx->mipmaps;
+		}
+	} else {
+		QByteArray outData;
+
+		if ( tx->filepath.isEmpty() || tx->reload ) {
+			// Archived textures are first loaded as a preview, the full resolution follows later
+			int previewSize = ( !tx->id && !tx->reload ) ? TEXTURE_PREVIEW_SIZE : 0;
+			QString filepath = find( tx->filename, nifFolder, outData, game, previewSize, tx->preview );
+
+			if ( filepath != tx->filepath )
+				unwatch( tx );
 
-	if ( tx->filepath.isEmpty() || tx->reload )
-		tx->filepath = find( tx->filename, nifFolder, outData, game );
+			tx->filepath = filepath;
+
+			if ( tx->preview )
+				previewed.append( tx->filename );
+		}
+
+		if ( !outData.isEmpty() || tx->reload ) {
+			tx->data = outData;
+		}
+
+		if ( !tx->id || tx->reload ) {
+			watch( tx );
+
+			// Identical files under other paths share one GL texture
+			QByteArray contents = tx->data;
+			if ( contents.isEmpty() ) {
+				QFile f( tx->filepath );
+				if ( f.open( QIODevice::ReadOnly ) )
+					contents = f.readAll();
+			}
 
-	if ( !outData.isEmpty() || tx->reload ) {
-		tx->data = outData;
+			quint64 hash = texContentHash( contents );
+			release( tx );
+
+			if ( !adopt( tx, hash ) ) {
+				tx->data = contents;
+				tx->load();
+				account( tx );
+				share( tx, hash );
+			}
+		} else {
+			if ( !tx->target )
+				tx->target = GL_TEXTURE_2D;
+
+			glBindTexture( tx->target, tx->id );
+		}
 	}
 
-	if ( !tx->id || tx->reload ) {
-		if ( QFile::exists( tx->filepath ) && QFileInfo( tx->filepath ).isWritable()
-			 && ( !watcher->files().contains( tx->filepath ) ) )
-			watcher->addPath( tx->filepath );
+	// Upgrade at most one preview between two refreshes
+	if ( !previewed.isEmpty() && !previewTimer->isActive() )
+		previewTimer->start();
+
+	return tx->mipmaps;
+}
 
+bool TexCache::uploadDecoded( Tex * tx, Game::GameMode game )
+{
+	Decoded result;
+	{
+		QMutexLocker lock( &decodedMutex );
+
+		auto it = decoded.find( tx->filename );
+		if ( it == decoded.end() ) {
+			if ( !tx->pending ) {
+				tx->pending = true;
+
+				// Archived textures are first loaded as a preview, the full resolution follows later
+				int previewSize = ( !tx->id && !tx->reload ) ? TEXTURE_PREVIEW_SIZE : 0;
+				QString filename = tx->filename;
+				QString folder = nifFolder;
+				int generation = decodeGeneration;
+
+				decoders->start( new TexDecodeTask( [this, filename, folder, game, previewSize, generation]() {
+					decode( filename, folder, game, previewSize, generation );
+				} ) );
+			}
+
+			return false;
+		}
+
+		result = it.value();
+		decoded.erase( it );
+	}
+
+	tx->pending = false;
+
+	if ( result.filepath != tx->filepath )
+		unwatch( tx );
+
+	tx->filepath = result.filepath;
+	tx->format = result.format;
+	tx->preview = result.preview;
+
+	if ( tx->preview )
+		previewed.append( tx->filename );
+
+	watch( tx );
+	release( tx );
+
+	if ( result.hash && adopt( tx, result.hash ) )
+		return true;
+
+	// A duplicate whose original was deleted since is loaded from the file contents instead
+	if ( result.image ) {
+		tx->load( *result.image );
+	} else if ( !result.data.isEmpty() ) {
+		tx->data = result.data;
 		tx->load();
 	} else {
-		if ( !tx->target )
-			tx->target = GL_TEXTURE_2D;
+		// Keep a name so that the failed texture isn't queued again
+		if ( !tx->id )
+			glGenTextures( 1, &tx->id );
+
+		tx->width = tx->height = tx->mipmaps = 0;
+		tx->reload = false;
+		tx->status = result.status;
+	}
+
+	account( tx );
+	share( tx, result.hash );
+	return true;
+}
+
+//! Estimate the memory used by the bound texture from the size of its first level
+static qint64 textureBytes( GLenum target, GLuint width, GLuint height, GLuint mipmaps )
+{
+	if ( !mipmaps )
+		return 0;
+
+	GLenum face = ( target == GL_TEXTURE_CUBE_MAP ) ? GL_TEXTURE_CUBE_MAP_POSITIVE_X : target;
+
+	qint64 bytes;
+	GLint compressed = 0;
+	glGetTexLevelParameteriv( face, 0, GL_TEXTURE_COMPRESSED, &compressed );
+
+	if ( compressed ) {
+		GLint size = 0;
+		glGetTexLevelParameteriv( face, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, &size );
+		bytes = size;
+	} else {
+		GLint bits = 0;
+		for ( GLenum channel : { GL_TEXTURE_RED_SIZE, GL_TEXTURE_GREEN_SIZE, GL_TEXTURE_BLUE_SIZE, GL_TEXTURE_ALPHA_SIZE } ) {
+			GLint size = 0;
+			glGetTexLevelParameteriv( face, 0, channel, &size );
+			bits += size;
+		}
+
+		bytes = qint64( width ) * height * std::max( bits, 8 ) / 8;
+	}
 
+	// The rest of a full mip chain adds a third
+	if ( mipmaps > 1 )
+		bytes += bytes / 3;
+
+	if ( target == GL_TEXTURE_CUBE_MAP )
+		bytes *= 6;
+
+	return bytes;
+}
+
+void TexCache::account( Tex * tx )
+{
+	totalBytes -= tx->bytes;
+	tx->bytes = 0;
+
+	if ( tx->id && tx->mipmaps ) {
 		glBindTexture( tx->target, tx->id );
+		tx->bytes = textureBytes( tx->target, tx->width, tx->height, tx->mipmaps );
 	}
 
-	return tx->mipmaps;
+	totalBytes += tx->bytes;
+
+	if ( totalBytes > maxBytes && !evictTimer->isActive() )
+		evictTimer->start();
+}
+
+void TexCache::evict()
+{
+	if ( totalBytes > maxBytes ) {
+		// Textures bound for the last frame are on screen and are kept even if over the budget
+		QVector<Tex *> candidates;
+		for ( Tex * tx : textures ) {
+			if ( tx->id && tx->mipmaps && tx->lastBound != frame && !tx->pending )
+				candidates.append( tx );
+		}
+
+		std::sort( candidates.begin(), candidates.end(), []( const Tex * a, const Tex * b ) {
+			return a->lastBound < b->lastBound;
+		} );
+
+		for ( Tex * tx : candidates ) {
+			if ( totalBytes <= maxBytes )
+				break;
+
+			textures.remove( tx->filename );
+			previewed.removeAll( tx->filename );
+
+			unwatch( tx );
+
+			// Shared GL textures are only freed with their last user
+			destroy( tx );
+		}
+	}
+
+	frame++;
+}
+
+void TexCache::setMaxBytes( qint64 bytes )
+{
+	maxBytes = bytes;
+
+	if ( totalBytes > maxBytes && !evictTimer->isActive() )
+		evictTimer->start();
+}
+
+bool TexCache::adopt( Tex * tx, quint64 hash )
+{
+	auto it = shared.find( hash );
+	if ( !hash || it == shared.end() )
+		return false;
+
+	if ( tx->id )
+		glDeleteTextures( 1, &tx->id );
+
+	totalBytes -= tx->bytes;
+	tx->bytes = 0;
+
+	tx->id = it->id;
+	tx->target = it->target;
+	tx->width = it->width;
+	tx->height = it->height;
+	tx->mipmaps = it->mipmaps;
+	tx->format = it->format;
+	tx->status = QString();
+	tx->reload = false;
+	tx->hash = hash;
+	it->refs++;
+
+	glBindTexture( tx->target, tx->id );
+	return true;
+}
+
+void TexCache::share( Tex * tx, quint64 hash )
+{
+	// Failed loads are not shared, so that each texture reports its own error
+	if ( !hash || !tx->id || !tx->mipmaps || shared.contains( hash ) )
+		return;
+
+	Shared s;
+	s.id = tx->id;
+	s.target = tx->target;
+	s.width = tx->width;
+	s.height = tx->height;
+	s.mipmaps = tx->mipmaps;
+	s.format = tx->format;
+	s.bytes = tx->bytes;
+	s.refs = 1;
+	shared.insert( hash, s );
+
+	tx->bytes = 0;
+	tx->hash = hash;
+
+	QMutexLocker lock( &decodedMutex );
+	sharedHashes.insert( hash );
+}
+
+void TexCache::release( Tex * tx )
+{
+	if ( !tx->hash )
+		return;
+
+	auto it = shared.find( tx->hash );
+	if ( it != shared.end() ) {
+		if ( --it->refs > 0 ) {
+			tx->id = 0;
+		} else {
+			tx->bytes = it->bytes;
+			shared.erase( it );
+
+			QMutexLocker lock( &decodedMutex );
+			sharedHashes.remove( tx->hash );
+		}
+	}
+
+	tx->hash = 0;
+}
+
+void TexCache::destroy( Tex * tx )
+{
+	release( tx );
+
+	if ( tx->id && tx->id != 0xFFFFFFFF )
+		glDeleteTextures( 1, &tx->id );
+
+	totalBytes -= tx->bytes;
+	delete tx;
+}
+
+void TexCache::decode( const QString & filename, const QString & folder, Game::GameMode game, int previewSize, int generation )
+{
+	Decoded result;
+
+	try
+	{
+		result.filepath = find( filename, folder, result.data, game, previewSize, result.preview );
+
+		if ( result.data.isEmpty() ) {
+			QFile f( result.filepath );
+			if ( !f.open( QIODevice::ReadOnly ) )
+				throw QString( "could not open file" );
+
+			result.data = f.readAll();
+		}
+
+		result.hash = texContentHash( result.data );
+		{
+			QMutexLocker lock( &decodedMutex );
+			result.duplicate = sharedHashes.contains( result.hash );
+		}
+
+		if ( !result.data.isEmpty() && !result.duplicate ) {
+			auto image = std::make_shared<gli::texture>();
+			if ( texDecode( result.filepath, result.data, result.format, *image ) ) {
+				result.image = image;
+				result.data.clear();
+			}
+		}
+	}
+	catch ( QString & e )
+	{
+		result.data.clear();
+		result.status = e;
+	}
+
+	QMutexLocker lock( &decodedMutex );
+	if ( generation == decodeGeneration ) {
+		decoded.insert( filename, result );
+		QMetaObject::invokeMethod( this, "sigRefresh", Qt::QueuedConnection );
+	}
+}
+
+void TexCache::loadNextPreviewed()
+{
+	// One texture per refresh keeps the view responsive while the full textures stream in
+	while ( !previewed.isEmpty() ) {
+		Tex * tx = textures.value( previewed.takeFirst() );
+		if ( tx && tx->preview ) {
+			tx->reload = true;
+			emit sigRefresh();
+			break;
+		}
+	}
 }
 
 int TexCache::bind( const QModelIndex & iSource, Game::GameMode game )
@@ -422,15 +973,23 @@ int TexCache::bind( const QModelIndex & iSource, Game::GameMode game )
 					tx = new Tex();
 					tx->id = 0;
 					tx->reload = false;
-					try
-					{
-						glGenTextures( 1, &tx->id );
-						glBindTexture( GL_TEXTURE_2D, tx->id );
-						embedTextures.insert( iData, tx );
-						texLoad( iData, tx->format, tx->target, tx->width, tx->height, tx->mipmaps, tx->id );
-					}
-					catch ( QString & e ) {
-						tx->status = e;
+					embedTextures.insert( iData, tx );
+
+					// Identical pixel data in other blocks shares one GL texture
+					quint64 hash = texContentHash( iData );
+
+					if ( !adopt( tx, hash ) ) {
+						try
+						{
+							glGenTextures( 1, &tx->id );
+							glBindTexture( GL_TEXTURE_2D, tx->id );
+							texLoad( iData, tx->format, tx->target, tx->width, tx->height, tx->mipmaps, tx->id );
+						}
+						catch ( QString & e ) {
+							tx->status = e;
+						}
+
+						share( tx, hash );
 					}
 				} else {
 					glBindTexture( GL_TEXTURE_2D, tx->id );
@@ -448,23 +1007,47 @@ int TexCache::bind( const QModelIndex & iSource, Game::GameMode game )
 
 void TexCache::flush()
 {
+	// Shared GL textures are deleted once, below
 	for ( Tex * tx : textures ) {
-		if ( tx->id )
+		if ( tx->id && !tx->hash && tx->id != 0xFFFFFFFF )
 			glDeleteTextures( 1, &tx->id );
 	}
 	qDeleteAll( textures );
 	textures.clear();
+	previewed.clear();
+	totalBytes = 0;
+
+	{
+		QMutexLocker lock( &decodedMutex );
+		decoders->clear();
+		decoded.clear();
+		decodeGeneration++;
+	}
 
 	for ( Tex * tx : embedTextures ) {
-		if ( tx->id )
+		if ( tx->id && !tx->hash )
 			glDeleteTextures( 1, &tx->id );
 	}
 	qDeleteAll( embedTextures );
 	embedTextures.clear();
 
-	if ( !watcher->files().empty() ) {
-		watcher->removePaths( watcher->files() );
+	for ( const Shared & s : shared )
+		glDeleteTextures( 1, &s.id );
+	shared.clear();
+
+	{
+		QMutexLocker lock( &decodedMutex );
+		sharedHashes.clear();
 	}
+
+	if ( !watcher->directories().empty() ) {
+		watcher->removePaths( watcher->directories() );
+	}
+
+	watchedFiles.clear();
+	watchedDirs.clear();
+	changedDirs.clear();
+	reloadTimer->stop();
 }
 
 void TexCache::setNifFolder( const QString & folder )
@@ -496,14 +1079,44 @@ QString TexCache::info( const QModelIndex & iSource )
 		} else {
 			QString filename = nif->get<QString>( iSource, "File Name" );
 			Tex * tx = textures.value( filename );
-			temp = QString( "External texture file: %1\nTexture path: %2\nFormat: %3\nWidth: %4\nHeight: %5\nMipmaps: %6" )
-			       .arg( tx->filename )
-			       .arg( tx->filepath )
-			       .arg( tx->format )
-			       .arg( tx->width )
-			       .arg( tx->height )
-			       .arg( tx->mipmaps );
+
+			if ( !tx || !tx->mipmaps ) {
+				// Not loaded (yet), the header is enough
+				QString filepath, format;
+				GLuint width = 0, height = 0, mipmaps = 0;
+				auto game = Game::GameManager::get_game( nif->getVersionNumber(), nif->getUserVersion(), nif->getBSVersion() );
+
+				if ( probe( filename, nifFolder, filepath, format, width, height, mipmaps, game ) ) {
+					temp = QString( "External texture file: %1\nTexture path: %2\nFormat: %3\nWidth: %4\nHeight: %5\nMipmaps: %6\nNot loaded" )
+					       .arg( filename )
+					       .arg( filepath )
+					       .arg( format )
+					       .arg( width )
+					       .arg( height )
+					       .arg( mipmaps );
+				} else if ( filepath.isEmpty() ) {
+					temp = QString( "External texture file: %1\nNot found" ).arg( filename );
+				} else {
+					temp = QString( "External texture file: %1\nTexture path: %2\nNot a valid DDS texture" )
+					       .arg( filename )
+					       .arg( filepath );
+				}
+			} else {
+				temp = QString( "External texture file: %1\nTexture path: %2\nFormat: %3\nWidth: %4\nHeight: %5\nMipmaps: %6\nMemory: %7 KiB" )
+				       .arg( tx->filename )
+				       .arg( tx->filepath )
+				       .arg( tx->format )
+				       .arg( tx->width )
+				       .arg( tx->height )
+				       .arg( tx->mipmaps )
+				       .arg( ( ( tx->hash ? shared.value( tx->hash ).bytes : tx->bytes ) + 1023 ) / 1024 );
+			}
 		}
+
+		temp += QString( "\nTexture memory: %1 of %2 MiB (%3 textures)" )
+		        .arg( ( totalBytes + 1024 * 1024 - 1 ) / ( 1024 * 1024 ) )
+		        .arg( maxBytes / ( 1024 * 1024 ) )
+		        .arg( textures.count() );
 	}
 
 	return temp;
@@ -563,9 +1176,32 @@ void TexCache::Tex::load()
 	}
 }
 
+void TexCache::Tex::load( gli::texture & image )
+{
+	// Keep a name even if the upload fails, so that the texture isn't queued again
+	if ( !id )
+		glGenTextures( 1, &id );
+
+	width  = height = mipmaps = 0;
+	reload = false;
+	status = QString();
+
+	try
+	{
+		if ( !texUpload( image, filepath, target, width, height, mipmaps, id ) )
+			throw QString( "unknown texture format" );
+	}
+	catch ( QString & e )
+	{
+		status = e;
+	}
+}
+
 bool TexCache::Tex::saveAsFile( const QModelIndex & index, QString & savepath )
 {
-	texLoad( index, format, target, width, height, mipmaps, id );
+	// Only the dimensions are needed, so there is no need to decode or upload the texture
+	if ( !texProbePixelData( index, width, height, mipmaps ) )
+		return false;
 
 	if ( savepath.toLower().endsWith( ".tga" ) ) {
 		return texSaveTGA( index, savepath, width, height );
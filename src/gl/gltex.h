@@ -37,9 +37,15 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <QObject> // Inherited
 #include <QByteArray>
+#include <QDateTime>
 #include <QHash>
+#include <QMutex>
 #include <QPersistentModelIndex>
+#include <QSet>
 #include <QString>
+#include <QStringList>
+
+#include <memory>
 
 
 //! @file gltex.h TexCache etc. header
@@ -47,6 +53,12 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 class NifModel;
 class QFileSystemWatcher;
 class QOpenGLContext;
+class QThreadPool;
+class QTimer;
+
+namespace gli {
+class texture;
+}
 
 typedef unsigned int GLuint;
 typedef unsigned int GLenum;
@@ -80,6 +92,16 @@ class TexCache final : public QObject
 		GLuint mipmaps = 0;
 		//! Determine whether the texture needs reloading
 		bool reload = false;
+		//! Whether only a low resolution preview from an archive is loaded
+		bool preview = false;
+		//! Whether the texture is being decoded in the background
+		bool pending = false;
+		//! Estimated size of the texture in video memory, in bytes
+		qint64 bytes = 0;
+		//! Value of TexCache::frame when the texture was last bound
+		int lastBound = 0;
+		//! Content hash if the GL texture is in TexCache::shared, 0 otherwise
+		quint64 hash = 0;
 		//! Format of the texture
 		QString format;
 		//! Status messages
@@ -87,6 +109,8 @@ class TexCache final : public QObject
 
 		//! Load the texture
 		void load();
+		//! Upload a texture decoded in the background
+		void load( gli::texture & image );
 
 		//! Save the texture as a file
 		bool saveAsFile( const QModelIndex & index, QString & savepath );
@@ -94,14 +118,51 @@ class TexCache final : public QObject
 		bool savePixelData( NifModel * nif, const QModelIndex & iSource, QModelIndex & iData );
 	};
 
+	//! A texture decoded in the background, waiting to be uploaded
+	struct Decoded
+	{
+		QString filepath;
+		//! File contents, if the format can't be decoded off the GL thread
+		QByteArray data;
+		std::shared_ptr<gli::texture> image;
+		QString format;
+		bool preview = false;
+		QString status;
+		//! Hash of the file contents
+		quint64 hash = 0;
+		//! A texture with the same contents was already uploaded, so decoding was skipped
+		bool duplicate = false;
+	};
+
+	//! A GL texture used by all textures with identical contents
+	struct Shared
+	{
+		GLuint id = 0;
+		GLenum target = 0;
+		GLuint width = 0;
+		GLuint height = 0;
+		GLuint mipmaps = 0;
+		QString format;
+		//! Estimated size in video memory, counted once for all users
+		qint64 bytes = 0;
+		//! Number of textures using it
+		int refs = 0;
+	};
+
 public:
 	TexCache( QObject * parent = nullptr );
 	~TexCache();
 
-	//! Bind a texture from filename
+	/*! Bind a texture from filename
+	 *
+	 * With background loading enabled, 0 is returned until the texture has been decoded
+	 * and the caller is expected to use a placeholder. sigRefresh() is emitted once it is ready.
+	 */
 	int bind( const QString & fname, Game::GameMode game = Game::OTHER );
 	//! Bind a texture from pixel data
 	int bind( const QModelIndex & iSource, Game::GameMode game = Game::OTHER );
+	//! The GL texture a file is uploaded to, or 0 if it isn't loaded; never loads the file
+	GLuint textureId( const QString & fname ) const;
 
 	//! Debug function for getting info about a texture
 	QString info( const QModelIndex & iSource );
@@ -114,6 +175,16 @@ public:
 	//! Find a texture based on its filename
 	static QString find( const QString & file, const QString & nifFolder, Game::GameMode game = Game::OTHER );
 	static QString find( const QString & file, const QString & nifFolder, QByteArray & data, Game::GameMode game = Game::OTHER );
+	//! Read a texture ahead of bind() so that it is served from the archive cache; safe to call from any thread
+	static void prefetch( const QString & file, const QString & nifFolder, Game::GameMode game = Game::OTHER );
+	/*! Read the format, dimensions and mipmap count of a DDS texture from its header
+	 *
+	 * Only the header is read from the file or archive, nothing is decoded or uploaded.
+	 * Returns false if the texture cannot be found, in which case filepath is empty,
+	 * or if it is not a valid DDS texture.
+	 */
+	static bool probe( const QString & file, const QString & nifFolder, QString & filepath, QString & format,
+					   GLuint & width, GLuint & height, GLuint & mipmaps, Game::GameMode game = Game::OTHER );
 	//! Remove the path from a filename
 	static QString stripPath( const QString & file, const QString & nifFolder );
 	//! Checks whether the given file can be loaded
@@ -121,6 +192,18 @@ public:
 	//! Checks whether the extension is supported
 	static bool isSupported( const QString & file );
 
+	//! Decode textures on worker threads instead of in bind()
+	void setBackgroundLoading( bool enabled ) { backgroundLoading = enabled; }
+
+	/*! Set the memory budget of the texture files
+	 *
+	 * Least recently bound textures are deleted once the estimated size of all
+	 * textures exceeds the budget. Textures bound for the last frame are always kept.
+	 */
+	void setMaxBytes( qint64 bytes );
+	//! Estimated memory used by the texture files, in bytes
+	qint64 usedBytes() const { return totalBytes; }
+
 signals:
 	void sigRefresh();
 
@@ -135,12 +218,83 @@ public slots:
 	void setNifFolder( const QString & );
 
 protected slots:
-	void fileChanged( const QString & filepath );
+	//! Schedule a check of the watched files in a folder
+	void directoryChanged( const QString & dir );
+	//! Reload the textures whose files changed since the last check, in one batch
+	void reloadChanged();
+	//! Replace the next previewed texture with its full resolution version
+	void loadNextPreviewed();
+	//! Delete least recently bound textures until the memory used is within the budget
+	void evict();
 
 protected:
+	//! Find a texture, fetching only a low resolution preview from archives if previewSize is set, or only the header if it is negative
+	static QString find( const QString & file, const QString & nifFolder, QByteArray & data, Game::GameMode game,
+						 int previewSize, bool & preview );
+
+	//! Find and decode a texture; runs on the worker threads
+	void decode( const QString & filename, const QString & folder, Game::GameMode game, int previewSize, int generation );
+	//! Upload the texture if decoding has finished, otherwise make sure it is queued
+	bool uploadDecoded( Tex * tx, Game::GameMode game );
+	//! Update the memory used after (re)loading a texture
+	void account( Tex * tx );
+
+	//! Use the shared GL texture with the given content hash, if there is one
+	bool adopt( Tex * tx, quint64 hash );
+	//! Make the freshly loaded GL texture of tx available to other textures with the same contents
+	void share( Tex * tx, quint64 hash );
+	//! Stop using a shared GL texture; the last user takes over its GL name
+	void release( Tex * tx );
+	//! Delete a texture and its GL texture, unless other textures still use it
+	void destroy( Tex * tx );
+
+	//! Watch the file of a texture for changes
+	void watch( Tex * tx );
+	//! Stop watching the file of a texture, and its folder once no other file in it is watched
+	void unwatch( Tex * tx );
+	//! Reload or remove the textures of a changed file
+	void fileChanged( const QString & filepath );
+
 	QHash<QString, Tex *> textures;
+	//! Filenames of textures still loaded as previews, in bind order
+	QStringList previewed;
+	//! Schedules loadNextPreviewed() after the current refresh
+	QTimer * previewTimer;
 	QHash<QModelIndex, Tex *> embedTextures;
+
+	//! Watches the folders of the texture files; watching every file runs into OS limits
 	QFileSystemWatcher * watcher;
+	//! Filenames of the watched textures, by file path
+	QMultiHash<QString, QString> watchedFiles;
+	//! Last modification time of the watched files, by folder and file path
+	QHash<QString, QHash<QString, QDateTime>> watchedDirs;
+	//! Watched folders which changed since the last reloadChanged()
+	QSet<QString> changedDirs;
+	//! Delays reloadChanged() until the changes settle
+	QTimer * reloadTimer;
+
+	bool backgroundLoading = false;
+	QThreadPool * decoders;
+	//! Protects decoded, decodeGeneration and sharedHashes
+	QMutex decodedMutex;
+	//! Textures decoded by the workers, by filename
+	QHash<QString, Decoded> decoded;
+	//! Incremented by flush() so that results of stale decodes are dropped
+	int decodeGeneration = 0;
+
+	//! GL textures by content hash, so that identical textures are uploaded once
+	QHash<quint64, Shared> shared;
+	//! Keys of shared, for the workers to skip decoding duplicates
+	QSet<quint64> sharedHashes;
+
+	//! Memory budget of the texture files in bytes
+	qint64 maxBytes;
+	//! Estimated memory used by the texture files in bytes
+	qint64 totalBytes = 0;
+	//! Incremented by every eviction pass, which runs after each frame that binds textures
+	int frame = 1;
+	//! Schedules evict() after the current frame
+	QTimer * evictTimer;
 
 	QString nifFolder;
 };
@@ -151,6 +305,12 @@ bool activateTextureUnit( int x );
 // TODO: The default of 8 is arbitrary because >8 causes GL paint errors
 //	This is a problem only if a mesh uses all 9 texture slots
 void resetTextureUnits( int numTex = 8 );
+/*! Start or stop tracking the texture unit state, which lets resetTextureUnits() skip unused units.
+ *
+ * The state is shared by all GL contexts, so it is only tracked over one pass of drawing
+ * shapes in one context; the state on entry is treated as unknown.
+ */
+void trackTextureUnits( bool track );
 
 float get_max_anisotropy();
 
@@ -32,21 +32,31 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "gltexloaders.h"
 
+#include "bcdecoder.h"
+#include "mipgen.h"
+#include "pixelconvert.h"
 #include "message.h"
 #include "model/nifmodel.h"
 
 #include "dds.h"
+#include "xxhash.h"
 
 #include <QBuffer>
 #include <QByteArray>
 #include <QDebug>
+#include <QDir>
 #include <QFile>
 #include <QFileInfo>
 #include <QModelIndex>
 #include <QOpenGLContext>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <QString>
 #include <QtEndian>
 
+#include <algorithm>
+#include <vector>
+
 #ifdef __APPLE__
 #include <gl3.h>
 #include <gl3ext.h>
@@ -90,10 +100,6 @@ PFNGLCOMPRESSEDTEXIMAGE2DPROC glCompressedTexImage2D = nullptr;
 #define FOURCC_DXT3 MAKEFOURCC( 'D', 'X', 'T', '3' )
 #define FOURCC_DXT5 MAKEFOURCC( 'D', 'X', 'T', '5' )
 
-//! Shift amounts for RGBA conversion
-static const int rgbashift[4] = {
-	0, 8, 16, 24
-};
 //! Mask for TGA greyscale
 static const quint32 TGA_L_MASK[4] = {
 	0xff, 0xff, 0xff, 0x00
@@ -128,75 +134,105 @@ static const quint8 unk8bytes32[] = {
 	129, 8, 130, 32, 0, 65, 12, 0
 };
 
-//! Check whether a number is a power of two.
-bool isPowerOfTwo( unsigned int x )
+//! Decoded textures are cached on disk when their source data is at least this large
+static const int TEXCACHE_MIN_SIZE = 64 * 1024;
+//! The disk cache is trimmed to this size at startup
+static const qint64 TEXCACHE_MAX_BYTES = 512 * 1024 * 1024;
+//! Change whenever the decoded output changes, to invalidate old cache entries
+static const quint64 TEXCACHE_VERSION = 2;
+
+//! Folder of the decoded texture cache, trimmed to TEXCACHE_MAX_BYTES on first use
+static const QString & texCacheFolder()
 {
-	while ( !( x == 0 || x & 1 ) )
-		x = x >> 1;
+	static const QString folder = []() {
+		QString path = QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) + QStringLiteral( "/textures" );
+		QDir dir;
+		if ( !dir.mkpath( path ) )
+			return QString();
+
+		dir.setPath( path );
+		QFileInfoList files = dir.entryInfoList( QDir::Files, QDir::Time );
+
+		qint64 total = 0;
+		for ( const QFileInfo & f : files ) {
+			total += f.size();
+			// Newest first, so everything past the budget is the least recently written
+			if ( total > TEXCACHE_MAX_BYTES )
+				QFile::remove( f.absoluteFilePath() );
+		}
 
-	return ( x == 1 );
+		return path;
+	}();
+
+	return folder;
 }
 
-/*! Completes mipmap sequence of the current active OpenGL texture.
+/*! Decode a texture through the disk cache.
  *
- * @param m Number of mipmaps that are already in the texture.
- * @return	Total number of mipmaps.
+ * Cache files hold the decoded texture as DDS, followed by the format string and its length.
+ *
+ * @param data		The source data
+ * @param params	Anything besides the source data that the decoded texture depends on
+ * @param format	Contains the format on successful decode
+ * @param decode	Decodes the texture on a cache miss
  */
-int generateMipMaps( int m )
+template <typename Decoder>
+static gli::texture texDecodeCached( const QByteArray & data, const QByteArray & params, QString & format, Decoder decode )
 {
-	GLint w = 0, h = 0;
-
-	// load the (m-1)'th mipmap as a basis
-	glGetTexLevelParameteriv( GL_TEXTURE_2D, m - 1, GL_TEXTURE_WIDTH, &w );
-	glGetTexLevelParameteriv( GL_TEXTURE_2D, m - 1, GL_TEXTURE_HEIGHT, &h );
-
-	//qDebug() << m-1 << w << h;
-
-	quint8 * data = (quint8 *)malloc( w * h * 4 );
-	glGetTexImage( GL_TEXTURE_2D, m - 1, GL_RGBA, GL_UNSIGNED_BYTE, data );
-
-	// now generate the mipmaps until width is one or height is one.
-	while ( w > 1 || h > 1 ) {
-		// Shut up Code Analysis C6011
-		if ( !data )
-			break;
-		// the buffer overwrites itself to save memory
-		const quint8 * src = data;
-		quint8 * dst = data;
-
-		quint32 xo = ( w > 1 ? 1 * 4 : 0 );
-		quint32 yo = ( h > 1 ? w * 4 : 0 );
-
-		w /= 2;
-		h /= 2;
-
-		if ( w == 0 )
-			w = 1;
-
-		if ( h == 0 )
-			h = 1;
-
-		//qDebug() << m << w << h;
-
-		for ( int y = 0; y < h; y++ ) {
-			for ( int x = 0; x < w; x++ ) {
-				for ( int b = 0; b < 4; b++ ) {
-					*dst++ = ( *(src + xo) + *(src + yo) + *(src + xo + yo) + *src) / 4;
-					src++;
+	if ( data.size() < TEXCACHE_MIN_SIZE || texCacheFolder().isEmpty() )
+		return decode();
+
+	XXH64_state_t state;
+	XXH64_reset( &state, TEXCACHE_VERSION );
+	XXH64_update( &state, params.constData(), params.size() );
+	XXH64_update( &state, data.constData(), data.size() );
+
+	QString cachePath = texCacheFolder() + QStringLiteral( "/" )
+		+ QString::number( XXH64_digest( &state ), 16 ).rightJustified( 16, '0' ) + QStringLiteral( ".dds" );
+
+	QFile cached( cachePath );
+	if ( cached.open( QIODevice::ReadOnly ) ) {
+		QByteArray contents = cached.readAll();
+		if ( contents.size() > int( sizeof( quint32 ) ) ) {
+			quint32 formatSize = qFromLittleEndian<quint32>( (const uchar *)contents.constData() + contents.size() - sizeof( quint32 ) );
+			int ddsSize = contents.size() - int( sizeof( quint32 ) ) - int( formatSize );
+			if ( ddsSize > 0 ) {
+				gli::texture texture = load_if_valid( contents.constData(), ddsSize );
+				if ( !texture.empty() ) {
+					format = QString::fromUtf8( contents.constData() + ddsSize, formatSize );
+					return texture;
 				}
-
-				src += xo;
 			}
-
-			src += yo;
 		}
+	}
+
+	gli::texture texture = decode();
 
-		glTexImage2D( GL_TEXTURE_2D, m++, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data );
+	std::vector<char> dds;
+	if ( !texture.empty() && gli::save_dds( texture, dds ) ) {
+		QByteArray formatData = format.toUtf8();
+		uchar formatSize[sizeof( quint32 )];
+		qToLittleEndian<quint32>( formatData.size(), formatSize );
+
+		QSaveFile file( cachePath );
+		if ( file.open( QIODevice::WriteOnly ) ) {
+			file.write( dds.data(), qint64( dds.size() ) );
+			file.write( formatData );
+			file.write( (const char *)formatSize, sizeof( formatSize ) );
+			file.commit();
+		}
 	}
 
-	free( data );
+	return texture;
+}
+
+//! Check whether a number is a power of two.
+bool isPowerOfTwo( unsigned int x )
+{
+	while ( !( x == 0 || x & 1 ) )
+		x = x >> 1;
 
-	return m;
+	return ( x == 1 );
 }
 
 /*! Converts RLE-encoded data into pixel data.
@@ -243,162 +279,65 @@ bool uncompressRLE( QIODevice & f, int w, int h, int bytespp, quint8 * pixel )
 	return true;
 }
 
-/*! Convert pixels to RGBA
- *
- * @param data		Pixels to convert
- * @param w			Width of the image
- * @param h			Height of the image
- * @param bytespp	Number of bytes per pixel
- * @param mask		Bitmask for pixel data
- * @param flipV		Whether to flip the data vertically
- * @param flipH		Whether to flip the data horizontally
- * @param pixl		Pixels to output
- */
-void convertToRGBA( const quint8 * data, int w, int h, int bytespp, const quint32 mask[], bool flipV, bool flipH, quint8 * pixl )
-{
-	memset( pixl, 0, w * h * 4 );
-
-	for ( int a = 0; a < 4; a++ ) {
-		if ( mask[a] ) {
-			quint32 msk = mask[ a ];
-			int rshift  = 0;
-
-			while ( msk != 0 && ( msk & 0xffffff00 ) ) {
-				msk = msk >> 1; rshift++;
-			}
-
-			int lshift = rgbashift[ a ];
-
-			while ( msk != 0 && ( ( msk & 0x80 ) == 0 ) ) {
-				msk = msk << 1; lshift++;
-			}
-
-			msk = mask[ a ];
-
-			const quint8 * src = data;
-			const quint32 inc  = ( flipH ? -1 : 1 );
-
-			for ( int y = 0; y < h; y++ ) {
-				quint32 * dst = (quint32 *)( pixl + 4 * ( w * ( flipV ? h - y - 1 : y ) + ( flipH ? w - 1 : 0 ) ) );
-
-				if ( rshift == lshift ) {
-					for ( int x = 0; x < w; x++ ) {
-						*dst |= *( (const quint32 *)src ) & msk;
-						dst  += inc;
-						src  += bytespp;
-					}
-				} else {
-					for ( int x = 0; x < w; x++ ) {
-						*dst |= ( *( (const quint32 *)src ) & msk ) >> rshift << lshift;
-						dst  += inc;
-						src  += bytespp;
-					}
-				}
-			}
-		} else if ( a == 3 ) {
-			quint32 * dst = (quint32 *)pixl;
-			quint32 x = 0xff << rgbashift[ a ];
-
-			for ( int c = w * h; c > 0; c-- )
-				*dst++ |= x;
-		}
-	}
-}
-
-//! Load raw pixel data
-int texLoadRaw( QIODevice & f, int width, int height, int num_mipmaps, int bpp, int bytespp, const quint32 mask[], bool flipV = false, bool flipH = false, bool rle = false )
+//! Decode raw pixel data to RGBA, completing the mipmap sequence
+static gli::texture2d texDecodeRaw( QIODevice & f, int width, int height, int num_mipmaps, int bpp, int bytespp, const quint32 mask[], bool flipV = false, bool flipH = false, bool rle = false )
 {
 	if ( bytespp * 8 != bpp || bpp > 32 || bpp < 8 )
 		throw QString( "unsupported image depth %1 / %2" ).arg( bpp ).arg( bytespp );
 
-	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
-	glPixelStorei( GL_UNPACK_SWAP_BYTES, GL_FALSE );
+	gli::texture2d texture( gli::FORMAT_RGBA8_UNORM_PACK8, gli::texture2d::extent_type( width, height ) );
 
-	quint8 * data1 = (quint8 *)malloc( width * height * 4 );
-	quint8 * data2 = (quint8 *)malloc( width * height * 4 );
+	// Padded to 4 bytes per pixel as convertToRGBA reads whole words
+	std::vector<quint8> data( width * height * 4 );
 
-	int w = width;
-	int h = height;
+	int levels = std::min( num_mipmaps, int( texture.levels() ) );
 	int m = 0;
 
-	while ( m < num_mipmaps ) {
-		w = width >> m;
-		h = height >> m;
-
-		if ( w == 0 )
-			w = 1;
-
-		if ( h == 0 )
-			h = 1;
+	for ( ; m < levels; m++ ) {
+		int w = texture.extent( m ).x;
+		int h = texture.extent( m ).y;
 
 		if ( rle ) {
-			if ( !uncompressRLE( f, w, h, bytespp, data1 ) ) {
-				free( data2 );
-				free( data1 );
+			if ( !uncompressRLE( f, w, h, bytespp, data.data() ) )
 				throw QString( "unexpected EOF" );
-			}
-		} else if ( f.read( (char *)data1, w * h * bytespp ) != w * h * bytespp ) {
-			free( data2 );
-			free( data1 );
+		} else if ( f.read( (char *)data.data(), w * h * bytespp ) != w * h * bytespp ) {
 			throw QString( "unexpected EOF" );
 		}
 
-		convertToRGBA( data1, w, h, bytespp, mask, flipV, flipH, data2 );
-
-		glTexImage2D( GL_TEXTURE_2D, m++, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data2 );
-
-		if ( w == 1 && h == 1 )
-			break;
+		convertToRGBA( data.data(), w, h, bytespp, mask, flipV, flipH, (quint8 *)texture.data( 0, 0, m ) );
 	}
 
-	free( data2 );
-	free( data1 );
-
-	if ( w > 1 || h > 1 )
-		m = generateMipMaps( m );
+	mipGenerate( texture, m );
 
-	return m;
+	return texture;
 }
 
-//! Load a palettised texture
-int texLoadPal( QIODevice & f, int width, int height, int num_mipmaps, int bpp, int bytespp, const quint32 colormap[], bool flipV, bool flipH, bool rle )
+//! Decode a palettised texture to RGBA, completing the mipmap sequence
+static gli::texture2d texDecodePal( QIODevice & f, int width, int height, int num_mipmaps, int bpp, int bytespp, const quint32 colormap[], bool flipV, bool flipH, bool rle )
 {
 	if ( bpp != 8 || bytespp != 1 )
 		throw QString( "unsupported image depth %1 / %2" ).arg( bpp ).arg( bytespp );
 
-	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
-	glPixelStorei( GL_UNPACK_SWAP_BYTES, GL_FALSE );
+	gli::texture2d texture( gli::FORMAT_RGBA8_UNORM_PACK8, gli::texture2d::extent_type( width, height ) );
 
-	quint8 * data = (quint8 *)malloc( width * height * 1 );
-	quint8 * pixl = (quint8 *)malloc( width * height * 4 );
+	std::vector<quint8> data( width * height * 1 );
 
-	int w = width;
-	int h = height;
+	int levels = std::min( num_mipmaps, int( texture.levels() ) );
 	int m = 0;
 
-	while ( m < num_mipmaps ) {
-		w = width >> m;
-		h = height >> m;
-
-		if ( w == 0 )
-			w = 1;
-
-		if ( h == 0 )
-			h = 1;
+	for ( ; m < levels; m++ ) {
+		int w = texture.extent( m ).x;
+		int h = texture.extent( m ).y;
 
 		if ( rle ) {
-			if ( !uncompressRLE( f, w, h, bytespp, data ) ) {
-				free( pixl );
-				free( data );
+			if ( !uncompressRLE( f, w, h, bytespp, data.data() ) )
 				throw QString( "unexpected EOF" );
-			}
-		} else if ( f.read( (char *)data, w * h * bytespp ) != w * h * bytespp ) {
-			free( pixl );
-			free( data );
+		} else if ( f.read( (char *)data.data(), w * h * bytespp ) != w * h * bytespp ) {
 			throw QString( "unexpected EOF" );
 		}
 
-		quint8 * src = data;
+		const quint8 * src = data.data();
+		quint8 * pixl = (quint8 *)texture.data( 0, 0, m );
 
 		for ( int y = 0; y < h; y++ ) {
 			quint32 * dst = (quint32 *)( pixl + 4 * ( w * ( flipV ? h - y - 1 : y ) + ( flipH ? w - 1 : 0 ) ) );
@@ -407,20 +346,11 @@ int texLoadPal( QIODevice & f, int width, int height, int num_mipmaps, int bpp,
 				*dst++ = colormap[*src++];
 			}
 		}
-
-		glTexImage2D( GL_TEXTURE_2D, m++, 4, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixl );
-
-		if ( w == 1 && h == 1 )
-			break;
 	}
 
-	free( pixl );
-	free( data );
-
-	if ( w > 1 || h > 1 )
-		m = generateMipMaps( m );
+	mipGenerate( texture, m );
 
-	return m;
+	return texture;
 }
 
 
@@ -435,14 +365,11 @@ int texLoadPal( QIODevice & f, int width, int height, int num_mipmaps, int bpp,
 #define TGA_COLOR_RLE    10
 #define TGA_GREY_RLE     11
 
-//! Load a TGA texture.
-GLuint texLoadTGA( QIODevice & f, QString & texformat, GLenum & target, GLuint & width, GLuint & height, GLuint & id )
+//! Decode a TGA texture.
+static gli::texture2d texDecodeTGA( QIODevice & f, QString & texformat )
 {
 	// see http://en.wikipedia.org/wiki/Truevision_TGA for a lot of this
 	texformat = "TGA";
-	target = GL_TEXTURE_2D;
-
-	glBindTexture( target, id );
 
 	// read in tga header
 	quint8 hdr[18];
@@ -459,8 +386,8 @@ GLuint texLoadTGA( QIODevice & f, QString & texformat, GLenum & target, GLuint &
 	//quint8 alphaDepth  = hdr[17] & 15;
 	bool flipV = !( hdr[17] & 32 );
 	bool flipH = hdr[17] & 16;
-	width  = hdr[12] + 256 * hdr[13];
-	height = hdr[14] + 256 * hdr[15];
+	int width  = hdr[12] + 256 * hdr[13];
+	int height = hdr[14] + 256 * hdr[15];
 
 	if ( !( isPowerOfTwo( width ) && isPowerOfTwo( height ) ) )
 		throw QString( "image dimensions must be power of two" );
@@ -503,7 +430,7 @@ GLuint texLoadTGA( QIODevice & f, QString & texformat, GLenum & target, GLuint &
 		}
 	}
 
-	// check format and call texLoadPal / texLoadRaw
+	// check format and call texDecodePal / texDecodeRaw
 	switch ( hdr[2] ) {
 	case TGA_COLORMAP:
 	case TGA_COLORMAP_RLE:
@@ -514,7 +441,7 @@ GLuint texLoadTGA( QIODevice & f, QString & texformat, GLenum & target, GLuint &
 			if ( hdr[2] == TGA_COLORMAP_RLE )
 				texformat += " (RLE)";
 
-			return texLoadPal( f, width, height, 1, depth, depth / 8, colormap, flipV, flipH, hdr[2] == TGA_COLORMAP_RLE );
+			return texDecodePal( f, width, height, 1, depth, depth / 8, colormap, flipV, flipH, hdr[2] == TGA_COLORMAP_RLE );
 		}
 
 		break;
@@ -527,14 +454,14 @@ GLuint texLoadTGA( QIODevice & f, QString & texformat, GLenum & target, GLuint &
 			if ( hdr[2] == TGA_GREY_RLE )
 				texformat += " (RLE)";
 
-			return texLoadRaw( f, width, height, 1, 8, 1, TGA_L_MASK, flipV, flipH, hdr[2] == TGA_GREY_RLE );
+			return texDecodeRaw( f, width, height, 1, 8, 1, TGA_L_MASK, flipV, flipH, hdr[2] == TGA_GREY_RLE );
 		} else if ( depth == 16 ) {
 			texformat += " (greyscale) (alpha)";
 
 			if ( hdr[2] == TGA_GREY_RLE )
 				texformat += " (RLE)";
 
-			return texLoadRaw( f, width, height, 1, 16, 2, TGA_LA_MASK, flipV, flipH, hdr[2] == TGA_GREY_RLE );
+			return texDecodeRaw( f, width, height, 1, 16, 2, TGA_LA_MASK, flipV, flipH, hdr[2] == TGA_GREY_RLE );
 		}
 
 		break;
@@ -547,21 +474,20 @@ GLuint texLoadTGA( QIODevice & f, QString & texformat, GLenum & target, GLuint &
 			if ( hdr[2] == TGA_GREY_RLE )
 				texformat += " (RLE)";
 
-			return texLoadRaw( f, width, height, 1, 32, 4, TGA_RGBA_MASK, flipV, flipH, hdr[2] == TGA_COLOR_RLE );
+			return texDecodeRaw( f, width, height, 1, 32, 4, TGA_RGBA_MASK, flipV, flipH, hdr[2] == TGA_COLOR_RLE );
 		} else if ( depth == 24 ) {
 			texformat += " (truecolor)";
 
 			if ( hdr[2] == TGA_COLOR_RLE )
 				texformat += " (RLE)";
 
-			return texLoadRaw( f, width, height, 1, 24, 3, TGA_RGB_MASK, flipV, flipH, hdr[2] == TGA_COLOR_RLE );
+			return texDecodeRaw( f, width, height, 1, 24, 3, TGA_RGB_MASK, flipV, flipH, hdr[2] == TGA_COLOR_RLE );
 		}
 
 		break;
 	}
 
 	throw QString( "image sub format not supported" );
-	return 0;
 }
 
 //! Return value as a 32-bit value; possibly replace with QtEndian functions?
@@ -576,8 +502,8 @@ quint16 get16( quint8 * x )
 	return *( (quint16 *)x );
 }
 
-//! Load a BMP texture.
-GLuint texLoadBMP( QIODevice & f, QString & texformat, GLenum & target, GLuint & width, GLuint & height, GLuint & id )
+//! Decode a BMP texture.
+static gli::texture2d texDecodeBMP( QIODevice & f, QString & texformat )
 {
 	// read in bmp header
 	quint8 hdr[54];
@@ -587,12 +513,9 @@ GLuint texLoadBMP( QIODevice & f, QString & texformat, GLenum & target, GLuint &
 		throw QString( "not a BMP file" );
 
 	texformat = "BMP";
-	target = GL_TEXTURE_2D;
 
-	glBindTexture( target, id );
-
-	width  = get32( &hdr[18] );
-	height = get32( &hdr[22] );
+	unsigned int width  = get32( &hdr[18] );
+	unsigned int height = get32( &hdr[22] );
 	unsigned int bpp = get16( &hdr[28] );
 	unsigned int compression = get32( &hdr[30] );
 	unsigned int offset = get32( &hdr[10] );
@@ -606,7 +529,7 @@ GLuint texLoadBMP( QIODevice & f, QString & texformat, GLenum & target, GLuint &
 	case 0:
 
 		if ( bpp == 24 ) {
-			return texLoadRaw( f, width, height, 1, bpp, 3, BMP_RGBA_MASK, true );
+			return texDecodeRaw( f, width, height, 1, bpp, 3, BMP_RGBA_MASK, true );
 		}
 
 		break;
@@ -620,115 +543,142 @@ GLuint texLoadBMP( QIODevice & f, QString & texformat, GLenum & target, GLuint &
 	qDebug( "cmpr %08x", compression );
 	qDebug( "ofs  %i", offset );
 	*/
-	return 0;
 }
 
-GLuint texLoadDDS( const QString & filepath, QString & format, GLenum & target, GLuint & width, GLuint & height, GLuint & mipmaps, QByteArray & data, GLuint & id )
+//! Everything needed to decode the pixel data of a NiPixelData block
+struct PixelDataLayout
 {
-	GLuint result = 0;
-	gli::texture texture;
-	if ( extStorageSupported ) {
-		texture = load_if_valid( data.constData(), data.size() );
-		if ( !texture.empty() )
-			result = GLI_create_texture( texture, target, id );
-	} else if ( glCompressedTexImage2D ) {
-		texture = load_if_valid( data.constData(), data.size() );
-		if ( !texture.empty() )
-			result = GLI_create_texture_fallback( texture, target, id );
+	GLuint width = 0;
+	GLuint height = 0;
+	GLuint mipmaps = 0;
+	int bpp = 0;
+	int bytespp = 0;
+	uint format = 0;
+	quint32 mask[4] = { 0x00000000, 0x00000000, 0x00000000, 0x00000000 };
+	//! Whether a PAL8 texture links to an NiPalette
+	bool hasPalette = false;
+	QVector<quint32> palette;
+	//! The pixels of all mipmaps, owned by the model
+	const QByteArray * pixels = nullptr;
+
+	//! Everything besides the pixels that the decoded texture depends on
+	QByteArray params() const
+	{
+		const quint32 layout[] = { width, height, mipmaps, quint32( bpp ), quint32( bytespp ), mask[0], mask[1], mask[2], mask[3] };
+		QByteArray p( (const char *)layout, sizeof( layout ) );
+		p.append( (const char *)palette.constData(), palette.size() * int( sizeof( quint32 ) ) );
+		return p;
 	}
+};
 
-	if ( result ) {
-		id = result;
-		mipmaps = (GLuint)texture.levels();
-	} else {
-		mipmaps = 0;
-		QString file = filepath;
-		file.replace( '/', "\\" );
-		Message::append( "One or more textures failed to load.",
-						 QString( "'%1' is corrupt or unsupported." ).arg( file )
-		);
+//! Read the layout of a NiPixelData block; returns false if it has no pixels
+static bool readPixelData( const NifModel * nif, const QModelIndex & iData, PixelDataLayout & layout )
+{
+	layout.mipmaps = nif->get<uint>( iData, "Num Mipmaps" );
+	QModelIndex iMipmaps = nif->getIndex( iData, "Mipmaps" );
+
+	if ( layout.mipmaps > 0 && iMipmaps.isValid() ) {
+		QModelIndex iMipmap = iMipmaps.child( 0, 0 );
+		layout.width  = nif->get<uint>( iMipmap, "Width" );
+		layout.height = nif->get<uint>( iMipmap, "Height" );
 	}
 
-	if ( !texture.empty() )
-		texture.clear();
+	layout.bpp = nif->get<uint>( iData, "Bits Per Pixel" );
+	layout.bytespp = nif->get<uint>( iData, "Bytes Per Pixel" );
+	layout.format = nif->get<uint>( iData, "Pixel Format" );
 
-	return mipmaps;
-}
+	QModelIndex iPixelData = nif->getIndex( iData, "Pixel Data" );
 
-// (public function, documented in gltexloaders.h)
-bool texLoad( const QModelIndex & iData, QString & texformat, GLenum & target, GLuint & width, GLuint & height, GLuint & mipmaps, GLuint & id )
-{
-	bool ok = false;
-	
-	auto nif = NifModel::fromValidIndex(iData);
-	if ( nif ) {
-		mipmaps = nif->get<uint>( iData, "Num Mipmaps" );
-		QModelIndex iMipmaps = nif->getIndex( iData, "Mipmaps" );
-
-		if ( mipmaps > 0 && iMipmaps.isValid() ) {
-			QModelIndex iMipmap = iMipmaps.child( 0, 0 );
-			width  = nif->get<uint>( iMipmap, "Width" );
-			height = nif->get<uint>( iMipmap, "Height" );
-		}
+	if ( iPixelData.isValid() )
+		layout.pixels = nif->get<QByteArray *>( iPixelData.child( 0, 0 ) );
 
-		int bpp = nif->get<uint>( iData, "Bits Per Pixel" );
-		int bytespp = nif->get<uint>( iData, "Bytes Per Pixel" );
-		uint format = nif->get<uint>( iData, "Pixel Format" );
-		bool flipV  = false;
-		bool flipH  = false;
-		bool rle = false;
+	if ( !layout.pixels || layout.pixels->isEmpty() )
+		return false;
 
-		QBuffer buf;
+	quint32 * mask = layout.mask;
 
-		QModelIndex iPixelData = nif->getIndex( iData, "Pixel Data" );
+	if ( nif->getVersionNumber() < 0x14000004 ) {
+		mask[0] = nif->get<uint>( iData, "Red Mask" );
+		mask[1] = nif->get<uint>( iData, "Green Mask" );
+		mask[2] = nif->get<uint>( iData, "Blue Mask" );
+		mask[3] = nif->get<uint>( iData, "Alpha Mask" );
+	} else {
+		QModelIndex iChannels = nif->getIndex( iData, "Channels" );
+
+		if ( iChannels.isValid() ) {
+			for ( int i = 0; i < 4; i++ ) {
+				QModelIndex iChannel = iChannels.child( i, 0 );
+				uint type = nif->get<uint>( iChannel, "Type" );
+				uint bpc  = nif->get<uint>( iChannel, "Bits Per Channel" );
+				int m = (1 << bpc) - 1;
 
-		if ( iPixelData.isValid() ) {
-			if ( QByteArray * pdata = nif->get<QByteArray *>( iPixelData.child(0, 0) ) ) {
-				buf.setData( *pdata );
-				buf.open( QIODevice::ReadOnly );
-				buf.seek( 0 );
+				switch ( type ) {
+				case 0:
+					mask[i] = m << (bpc * 0);
+					break;     // Green
+				case 1:
+					mask[i] = m << (bpc * 1);
+					break;     // Blue
+				case 2:
+					mask[i] = m << (bpc * 2);
+					break;     // Red
+				case 3:
+					mask[i] = m << (bpc * 3);
+					break;     // Red
+				}
 			}
 		}
+	}
 
-		if ( buf.size() == 0 )
-			return false;
-
-		quint32 mask[4] = {
-			0x00000000, 0x00000000, 0x00000000, 0x00000000
-		};
-
-		if ( nif->getVersionNumber() < 0x14000004 ) {
-			mask[0] = nif->get<uint>( iData, "Red Mask" );
-			mask[1] = nif->get<uint>( iData, "Green Mask" );
-			mask[2] = nif->get<uint>( iData, "Blue Mask" );
-			mask[3] = nif->get<uint>( iData, "Alpha Mask" );
-		} else {
-			QModelIndex iChannels = nif->getIndex( iData, "Channels" );
-
-			if ( iChannels.isValid() ) {
-				for ( int i = 0; i < 4; i++ ) {
-					QModelIndex iChannel = iChannels.child( i, 0 );
-					uint type = nif->get<uint>( iChannel, "Type" );
-					uint bpc  = nif->get<uint>( iChannel, "Bits Per Channel" );
-					int m = (1 << bpc) - 1;
-
-					switch ( type ) {
-					case 0:
-						mask[i] = m << (bpc * 0);
-						break;     // Green
-					case 1:
-						mask[i] = m << (bpc * 1);
-						break;     // Blue
-					case 2:
-						mask[i] = m << (bpc * 2);
-						break;     // Red
-					case 3:
-						mask[i] = m << (bpc * 3);
-						break;     // Red
-					}
+	if ( layout.format == 2 ) {
+		// Read the NiPalette entries; change this if we change NiPalette in nif.xml
+		QModelIndex iPalette = nif->getBlockIndex( nif->getLink( iData, "Palette" ) );
+
+		if ( iPalette.isValid() ) {
+			layout.hasPalette = true;
+
+			QVector<quint32> & map = layout.palette;
+			uint nmap = nif->get<uint>( iPalette, "Num Entries" );
+			map.resize( nmap );
+			QModelIndex iPaletteArray = nif->getIndex( iPalette, "Palette" );
+
+			if ( nmap > 0 && iPaletteArray.isValid() ) {
+				for ( uint i = 0; i < nmap; ++i ) {
+					auto color = nif->get<ByteColor4>( iPaletteArray.child( i, 0 ) ).toQColor();
+					quint8 r = color.red();
+					quint8 g = color.green();
+					quint8 b = color.blue();
+					quint8 a = color.alpha();
+					map[i] = ( (quint32)( ( r | ( (quint16)g << 8 ) ) | ( ( (quint32)b ) << 16 ) | ( ( (quint32)a ) << 24 ) ) );
 				}
 			}
 		}
+	}
+
+	return true;
+}
+
+// (public function, documented in gltexloaders.h)
+bool texDecode( const QModelIndex & iData, QString & texformat, gli::texture & texture )
+{
+	auto nif = NifModel::fromValidIndex(iData);
+	PixelDataLayout layout;
+
+	if ( nif && readPixelData( nif, iData, layout ) ) {
+		GLuint width = layout.width;
+		GLuint height = layout.height;
+		GLuint mipmaps = layout.mipmaps;
+		int bpp = layout.bpp;
+		int bytespp = layout.bytespp;
+		const quint32 * mask = layout.mask;
+		bool flipV  = false;
+		bool flipH  = false;
+		bool rle = false;
+
+		QBuffer buf;
+		buf.setData( *layout.pixels );
+		buf.open( QIODevice::ReadOnly );
+		buf.seek( 0 );
 
 		DDS_HEADER hdr = {};
 		hdr.dwSize = sizeof( hdr );
@@ -746,40 +696,30 @@ bool texLoad( const QModelIndex & iData, QString & texformat, GLenum & target, G
 
 		texformat = "NIF";
 
-		switch ( format ) {
+		// Uncompressed formats are decoded to RGBA
+		QByteArray params = layout.params();
+		QString cachedFormat;
+
+		switch ( layout.format ) {
 		case 0: // PX_FMT_RGB8
 			texformat += " (RGB8)";
-			ok = ( 0 != texLoadRaw( buf, width, height, mipmaps, bpp, bytespp, mask, flipV, flipH, rle ) );
+			texture = texDecodeCached( buf.buffer(), params, cachedFormat, [&]() {
+				return texDecodeRaw( buf, width, height, mipmaps, bpp, bytespp, mask, flipV, flipH, rle );
+			} );
 			break;
 		case 1: // PX_FMT_RGBA8
 			texformat += " (RGBA8)";
-			ok = ( 0 != texLoadRaw( buf, width, height, mipmaps, bpp, bytespp, mask, flipV, flipH, rle ) );
+			texture = texDecodeCached( buf.buffer(), params, cachedFormat, [&]() {
+				return texDecodeRaw( buf, width, height, mipmaps, bpp, bytespp, mask, flipV, flipH, rle );
+			} );
 			break;
 		case 2: // PX_FMT_PAL8
-			{
-				texformat += " (PAL8)";
-				// Read the NiPalette entries; change this if we change NiPalette in nif.xml
-				QModelIndex iPalette = nif->getBlockIndex( nif->getLink( iData, "Palette" ) );
-
-				if ( iPalette.isValid() ) {
-					QVector<quint32> map;
-					uint nmap = nif->get<uint>( iPalette, "Num Entries" );
-					map.resize( nmap );
-					QModelIndex iPaletteArray = nif->getIndex( iPalette, "Palette" );
-
-					if ( nmap > 0 && iPaletteArray.isValid() ) {
-						for ( uint i = 0; i < nmap; ++i ) {
-							auto color = nif->get<ByteColor4>( iPaletteArray.child( i, 0 ) ).toQColor();
-							quint8 r = color.red();
-							quint8 g = color.green();
-							quint8 b = color.blue();
-							quint8 a = color.alpha();
-							map[i] = ( (quint32)( ( r | ( (quint16)g << 8 ) ) | ( ( (quint32)b ) << 16 ) | ( ( (quint32)a ) << 24 ) ) );
-						}
-					}
+			texformat += " (PAL8)";
 
-					ok = ( 0 != texLoadPal( buf, width, height, mipmaps, bpp, bytespp, map.data(), flipV, flipH, rle ) );
-				}
+			if ( layout.hasPalette ) {
+				texture = texDecodeCached( buf.buffer(), params, cachedFormat, [&]() {
+					return texDecodePal( buf, width, height, mipmaps, bpp, bytespp, layout.palette.constData(), flipV, flipH, rle );
+				} );
 			}
 			break;
 		case 4: //PX_FMT_DXT1
@@ -799,7 +739,7 @@ bool texLoad( const QModelIndex & iData, QString & texformat, GLenum & target, G
 			break;
 		}
 
-		if ( format >= 4 && format <= 6 ) {
+		if ( texture.empty() && layout.format >= 4 && layout.format <= 6 ) {
 			// Create and prepend DDS header
 			char dds[sizeof(hdr)];
 			memcpy( dds, &hdr, sizeof(hdr) );
@@ -807,14 +747,51 @@ bool texLoad( const QModelIndex & iData, QString & texformat, GLenum & target, G
 			buf.buffer().prepend( QByteArray::fromRawData( dds, sizeof( hdr ) ) );
 			buf.buffer().prepend( QByteArray::fromStdString( "DDS " ) );
 
-			mipmaps = texLoadDDS( QString( "[%1] NiPixelData" ).arg( nif->getBlockNumber( iData ) ), 
-								  texformat, target, width, height, mipmaps, buf.buffer(), id );
-
-			ok = (mipmaps > 0);
+			texture = load_if_valid( buf.buffer().constData(), buf.buffer().size() );
 		}
 	}
 
-	return ok;
+	return !texture.empty();
+}
+
+// (public function, documented in gltexloaders.h)
+quint64 texContentHash( const QByteArray & data )
+{
+	if ( data.isEmpty() )
+		return 0;
+
+	return XXH64( data.constData(), size_t( data.size() ), 0 );
+}
+
+// (public function, documented in gltexloaders.h)
+quint64 texContentHash( const QModelIndex & iData )
+{
+	auto nif = NifModel::fromValidIndex( iData );
+	PixelDataLayout layout;
+
+	if ( !nif || !readPixelData( nif, iData, layout ) )
+		return 0;
+
+	QByteArray params = layout.params();
+	params.append( (const char *)&layout.format, sizeof( layout.format ) );
+
+	XXH64_state_t state;
+	XXH64_reset( &state, 0 );
+	XXH64_update( &state, params.constData(), params.size() );
+	XXH64_update( &state, layout.pixels->constData(), layout.pixels->size() );
+	return XXH64_digest( &state );
+}
+
+// (public function, documented in gltexloaders.h)
+bool texLoad( const QModelIndex & iData, QString & texformat, GLenum & target, GLuint & width, GLuint & height, GLuint & mipmaps, GLuint & id )
+{
+	gli::texture texture;
+	if ( !texDecode( iData, texformat, texture ) )
+		return false;
+
+	auto nif = NifModel::fromValidIndex( iData );
+	return texUpload( texture, QString( "[%1] NiPixelData" ).arg( nif->getBlockNumber( iData ) ),
+					  target, width, height, mipmaps, id );
 }
 
 //! Load NiPixelData or NiPersistentSrcTextureRendererData from a NifModel
@@ -1136,23 +1113,21 @@ bool texLoad( const QString & filepath, QString & format, GLenum & target, GLuin
 			return false;
 	}
 
-	QBuffer f( &data );
-	if ( !f.open( QIODevice::ReadWrite ) )
-		throw QString( "could not open buffer" );
-
 	bool isSupported = true;
-	if ( filepath.endsWith( ".dds", Qt::CaseInsensitive ) )
-		mipmaps = texLoadDDS( filepath, format, target, width, height, mipmaps, data, id );
-	else if ( filepath.endsWith( ".tga", Qt::CaseInsensitive ) )
-		mipmaps = texLoadTGA( f, format, target, width, height, id );
-	else if ( filepath.endsWith( ".bmp", Qt::CaseInsensitive ) )
-		mipmaps = texLoadBMP( f, format, target, width, height, id );
-	else if ( filepath.endsWith( ".nif", Qt::CaseInsensitive ) || filepath.endsWith( ".texcache", Qt::CaseInsensitive ) )
+	gli::texture texture;
+	if ( texDecode( filepath, data, format, texture ) ) {
+		texUpload( texture, filepath, target, width, height, mipmaps, id );
+	} else if ( filepath.endsWith( ".nif", Qt::CaseInsensitive ) || filepath.endsWith( ".texcache", Qt::CaseInsensitive ) ) {
+		QBuffer f( &data );
+		if ( !f.open( QIODevice::ReadWrite ) )
+			throw QString( "could not open buffer" );
+
 		mipmaps = texLoadNIF( f, format, target, width, height, id );
-	else
+		f.close();
+	} else {
 		isSupported = false;
-	
-	f.close();
+	}
+
 	data.clear();
 
 	if ( mipmaps == 0 )
@@ -1161,27 +1136,104 @@ bool texLoad( const QString & filepath, QString & format, GLenum & target, GLuin
 	if ( !target )
 		target = GL_TEXTURE_2D;
 
-	if ( isSupported ) {
-		GLenum t = target;
-		if ( target == GL_TEXTURE_CUBE_MAP )
-			t = GL_TEXTURE_CUBE_MAP_POSITIVE_X;
-
-		glGetTexLevelParameteriv( t, 0, GL_TEXTURE_WIDTH, (GLint *)&width );
-		glGetTexLevelParameteriv( t, 0, GL_TEXTURE_HEIGHT, (GLint *)&height );
-	} else {
+	if ( !isSupported )
 		throw QString( "unknown texture format" );
+
+	return isSupported;
+}
+
+//! Generate the mipmaps of an uncompressed 2D texture which has only one level
+static gli::texture completeMipMaps( const gli::texture & texture )
+{
+	if ( texture.empty() || texture.levels() > 1 || texture.target() != gli::TARGET_2D || gli::is_compressed( texture.format() ) )
+		return texture;
+
+	auto extent = texture.extent( 0 );
+	if ( extent.x <= 1 && extent.y <= 1 )
+		return texture;
+
+	gli::texture2d image = bcDecompress( texture );
+	if ( image.empty() )
+		return texture;
+
+	gli::texture2d result( image.format(), image.extent( 0 ) );
+	memcpy( result.data( 0, 0, 0 ), image.data( 0, 0, 0 ), image.size( 0 ) );
+	mipGenerate( result, 1 );
+
+	return result;
+}
+
+// (public function, documented in gltexloaders.h)
+bool texDecode( const QString & filepath, QByteArray & data, QString & format, gli::texture & texture )
+{
+	if ( filepath.endsWith( ".dds", Qt::CaseInsensitive ) ) {
+		texture = completeMipMaps( load_if_valid( data.constData(), data.size() ) );
+		return true;
+	}
+
+	QBuffer f( &data );
+	if ( !f.open( QIODevice::ReadOnly ) )
+		throw QString( "could not open buffer" );
+
+	if ( filepath.endsWith( ".tga", Qt::CaseInsensitive ) ) {
+		texture = texDecodeCached( data, QByteArrayLiteral( "TGA" ), format, [&f, &format]() {
+			return texDecodeTGA( f, format );
+		} );
+		return true;
+	} else if ( filepath.endsWith( ".bmp", Qt::CaseInsensitive ) ) {
+		texture = texDecodeCached( data, QByteArrayLiteral( "BMP" ), format, [&f, &format]() {
+			return texDecodeBMP( f, format );
+		} );
+		return true;
+	}
+
+	return false;
+}
+
+// (public function, documented in gltexloaders.h)
+bool texUpload( gli::texture & texture, const QString & filepath, GLenum & target, GLuint & width, GLuint & height, GLuint & mipmaps, GLuint & id )
+{
+	width = height = mipmaps = 0;
+
+	if ( !texture.empty() ) {
+		// Storage allocated with glTexStorage2D is immutable, so a reload needs a new texture
+		if ( id ) {
+			glDeleteTextures( 1, &id );
+			id = 0;
+		}
+
+		GLuint result = 0;
+		if ( extStorageSupported )
+			result = GLI_create_texture( texture, target, id );
+		else if ( glCompressedTexImage2D )
+			result = GLI_create_texture_fallback( texture, target, id );
+
+		if ( result ) {
+			id = result;
+			mipmaps = GLuint( texture.levels() );
+			width = GLuint( texture.extent().x );
+			height = GLuint( texture.extent().y );
+		}
+	}
+
+	QString file = filepath;
+	file.replace( '/', "\\" );
+
+	if ( mipmaps == 0 ) {
+		Message::append( "One or more textures failed to load.",
+						 QString( "'%1' is corrupt or unsupported." ).arg( file )
+		);
+		return false;
 	}
 
 	// Power of Two check
 	if ( (width & (width - 1)) || (height & (height - 1)) ) {
-		QString file = filepath;
-		file.replace( '/', "\\" );
 		Message::append( "One or more texture dimensions are not a power of two.",
 						 QString( "'%1' is %2 x %3." ).arg( file ).arg( width ).arg( height )
 		);
 	}
 
-	return isSupported;
+	return true;
 }
 
 bool texIsSupported( const QString & filepath )
@@ -1200,16 +1252,191 @@ bool texCanLoad( const QString & filepath )
 	return i.exists() && i.isReadable() && texIsSupported( filepath );
 }
 
+//! Name of a DXGI format found in DX10 headers, for the formats the games use
+static QString dxgiFormatName( quint32 dxgi )
+{
+	switch ( dxgi ) {
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+		return "RGBA8";
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		return "RGBA8 sRGB";
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+		return "BGRA8";
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		return "BGRA8 sRGB";
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+		return "BGRX8";
+	case DXGI_FORMAT_R8G8_UNORM:
+		return "RG8";
+	case DXGI_FORMAT_R8_UNORM:
+		return "R8";
+	case DXGI_FORMAT_BC1_UNORM:
+		return "BC1";
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+		return "BC1 sRGB";
+	case DXGI_FORMAT_BC2_UNORM:
+		return "BC2";
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+		return "BC2 sRGB";
+	case DXGI_FORMAT_BC3_UNORM:
+		return "BC3";
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+		return "BC3 sRGB";
+	case DXGI_FORMAT_BC4_UNORM:
+		return "BC4";
+	case DXGI_FORMAT_BC4_SNORM:
+		return "BC4 SNORM";
+	case DXGI_FORMAT_BC5_UNORM:
+		return "BC5";
+	case DXGI_FORMAT_BC5_SNORM:
+		return "BC5 SNORM";
+	case DXGI_FORMAT_BC6H_UF16:
+		return "BC6H";
+	case DXGI_FORMAT_BC6H_SF16:
+		return "BC6H SF16";
+	case DXGI_FORMAT_BC7_UNORM:
+		return "BC7";
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return "BC7 sRGB";
+	default:
+		return QString( "DXGI %1" ).arg( dxgi );
+	}
+}
+
+// (public function, documented in gltexloaders.h)
+bool texProbeDDS( const QByteArray & header, QString & format, GLuint & width, GLuint & height, GLuint & mipmaps )
+{
+	// The fields are read at fixed offsets, as DWORD is not 32-bit on every platform
+	const int ddsSize = 4 + 124;
+	const int dx10Size = ddsSize + 20;
+
+	if ( header.size() < ddsSize || !header.startsWith( "DDS " ) )
+		return false;
+
+	auto field = [&header]( int offset ) {
+		return qFromLittleEndian<quint32>( (const uchar *)header.constData() + offset );
+	};
+
+	if ( field( 4 ) != 124 || field( 76 ) != 32 )
+		return false;
+
+	quint32 flags = field( 8 );
+	height = field( 12 );
+	width = field( 16 );
+	mipmaps = ( flags & DDS_HEADER_FLAGS_MIPMAP ) ? std::max<quint32>( field( 28 ), 1 ) : 1;
+
+	if ( !width || !height )
+		return false;
+
+	quint32 pfFlags = field( 80 );
+	quint32 fourCC = field( 84 );
+	quint32 bitCount = field( 88 );
+
+	QString name;
+
+	if ( pfFlags & DDS_FOURCC ) {
+		switch ( fourCC ) {
+		case FOURCC_DXT1:
+			name = "DXT1";
+			break;
+		case FOURCC_DXT3:
+			name = "DXT3";
+			break;
+		case FOURCC_DXT5:
+			name = "DXT5";
+			break;
+		case MAKEFOURCC( 'A', 'T', 'I', '1' ):
+		case MAKEFOURCC( 'B', 'C', '4', 'U' ):
+			name = "BC4";
+			break;
+		case MAKEFOURCC( 'A', 'T', 'I', '2' ):
+		case MAKEFOURCC( 'B', 'C', '5', 'U' ):
+			name = "BC5";
+			break;
+		case MAKEFOURCC( 'D', 'X', '1', '0' ):
+			if ( header.size() < dx10Size )
+				return false;
+
+			name = dxgiFormatName( field( ddsSize ) );
+			break;
+		default:
+			return false;
+		}
+	} else if ( pfFlags & ( DDS_RGB | DDS_LUMINANCE | DDS_ALPHA ) ) {
+		switch ( bitCount ) {
+		case 8:
+		case 16:
+		case 24:
+		case 32:
+			break;
+		default:
+			return false;
+		}
+
+		name = ( ( pfFlags & DDS_RGBA ) == DDS_RGBA ) ? QString( "RGBA%1" ).arg( bitCount ) : QString( "RGB%1" ).arg( bitCount );
+	} else {
+		return false;
+	}
+
+	format = QString( "DDS (%1)" ).arg( name );
+	return true;
+}
+
+// (public function, documented in gltexloaders.h)
+bool texProbePixelData( const QModelIndex & iData, GLuint & width, GLuint & height, GLuint & mipmaps )
+{
+	auto nif = NifModel::fromIndex( iData );
+	if ( !nif )
+		return false;
+
+	mipmaps = nif->get<uint>( iData, "Num Mipmaps" );
+	QModelIndex iMipmaps = nif->getIndex( iData, "Mipmaps" );
+	if ( mipmaps == 0 || !iMipmaps.isValid() )
+		return false;
+
+	QModelIndex iMipmap = iMipmaps.child( 0, 0 );
+	width  = nif->get<uint>( iMipmap, "Width" );
+	height = nif->get<uint>( iMipmap, "Height" );
+
+	return width > 0 && height > 0;
+}
+
 
 bool texSaveDDS( const QModelIndex & index, const QString & filepath, const GLuint & width, const GLuint & height, const GLuint & mipmaps )
 {
 	auto nif = NifModel::fromIndex( index );
 	quint32 format = nif->get<quint32>( index, "Pixel Format" );
 
-	// can't dump palettised textures yet
-	if ( format == 2 ) {
-		qCCritical( nsIo ) << QObject::tr( "Texture format not supported" );
-		return false;
+	GLuint fullChain = 1;
+	while ( ( std::max( width, height ) >> fullChain ) > 0 )
+		fullChain++;
+
+	// Palettised data, and uncompressed data without all mipmaps, is decoded to RGBA with a complete mip chain
+	GLuint stored = nif->get<quint32>( index, "Num Mipmaps" );
+
+	if ( format == 2 || ( ( format == 0 || format == 1 ) && stored < fullChain ) ) {
+		QString texformat;
+		gli::texture texture;
+		std::vector<char> dds;
+
+		if ( !texDecode( index, texformat, texture ) || !gli::save_dds( texture, dds ) ) {
+			qCCritical( nsIo ) << QObject::tr( "Texture format not supported" );
+			return false;
+		}
+
+		QString filename = filepath;
+
+		if ( !filename.toLower().endsWith( ".dds" ) )
+			filename.append( ".dds" );
+
+		QSaveFile f( filename );
+
+		if ( !f.open( QIODevice::WriteOnly ) || f.write( dds.data(), qint64( dds.size() ) ) != qint64( dds.size() ) || !f.commit() ) {
+			qCCritical( nsIo ) << QObject::tr( "texSaveDDS: could not open %1" ).arg( filename );
+			return false;
+		}
+
+		return true;
 	}
 
 	// copy directly from mipmaps into texture
@@ -1468,49 +1695,27 @@ bool texSaveDDS( const QModelIndex & index, const QString & filepath, const GLui
 
 bool texSaveTGA( const QModelIndex & index, const QString & filepath, const GLuint & width, const GLuint & height )
 {
-	Q_UNUSED( index );
-	// auto nif = NifModel::fromIndex(index);
 	QString filename = filepath;
 
 	if ( !filename.toLower().endsWith( ".tga" ) )
 		filename.append( ".tga" );
 
-	//quint32 bytespp = nif->get<quint32>( index, "Bytes Per Pixel" );
-	//quint32 bpp = nif->get<quint8>( index, "Bits Per Pixel" );
-
-	quint32 s = width * height * 4; //bytespp;
-
-	quint8 * pixl = (quint8 *)malloc( s );
-	quint8 * data = (quint8 *)malloc( s );
-
-	glPixelStorei( GL_PACK_ALIGNMENT, 1 );
-	glPixelStorei( GL_PACK_SWAP_BYTES, GL_FALSE );
+	// Decode the pixel data on the CPU rather than reading back the bound GL texture
+	QString format;
+	gli::texture texture;
+	texDecode( index, format, texture );
 
-	// This is very dodgy and is mainly to avoid having to run through convertToRGBA
-	// It also won't work with DXT compressed or palletised textures
-	/*
-	if( nif->get<quint32>( index, "Pixel Format" ) == 0 ) {
-	    glGetTexImage( GL_TEXTURE_2D, 0, GL_BGR, GL_UNSIGNED_BYTE, data );
+	gli::texture2d image = bcDecompress( texture );
+	if ( image.empty() || GLuint( image.extent().x ) != width || GLuint( image.extent().y ) != height ) {
+		qCCritical( nsIo ) << QObject::tr( "texSaveTGA: could not decode pixel data for %1" ).arg( filename );
+		return false;
 	}
-	else if( nif->get<quint32>( index, "Pixel Format") == 1 ) {
-	    glGetTexImage( GL_TEXTURE_2D, 0, GL_BGRA, GL_UNSIGNED_BYTE, data );
-	}*/
 
-	glGetTexImage( GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixl );
-
-	//quint32 mask[4] = { 0x00000000, 0x00000000, 0x00000000, 0x00000000 };
-	/*
-	if ( nif->getVersionNumber() < 0x14000004 ) {
-	    mask[0] = nif->get<uint>(index, "Blue Mask");
-	    mask[1] = nif->get<uint>(index, "Green Mask");
-	    mask[2] = nif->get<uint>(index, "Red Mask");
-	    mask[3] = nif->get<uint>(index, "Alpha Mask");
-	}
-	*/
+	quint32 s = width * height * 4;
 
-	convertToRGBA( pixl, width, height, 4, TGA_RGBA_MASK, true, false, data );
+	quint8 * data = (quint8 *)malloc( s );
 
-	free( pixl );
+	convertToRGBA( static_cast<const quint8 *>( image.data( 0, 0, 0 ) ), width, height, 4, TGA_RGBA_MASK, true, false, data );
 
 	QFile f( filename );
 
@@ -1690,20 +1895,31 @@ bool texSaveNIF( NifModel * nif, const QString & filepath, QModelIndex & iData )
 		//nif->set<>( iData, "", pix.get<>( iPixData, "" ) );
 		//nif->set<>( iData, "", pix.get<>( iPixData, "" ) );
 	} else if ( filepath.endsWith( ".bmp", Qt::CaseInsensitive ) || filepath.endsWith( ".tga", Qt::CaseInsensitive ) ) {
-		//qDebug() << "Copying from GL buffer";
-
-		GLuint width, height, mipmaps, id;
-		GLuint target = GL_TEXTURE_2D;
+		// Decode on the CPU; the decoders also generate the mipmaps
+		QByteArray fileData = f.readAll();
 		QString format;
+		gli::texture texture;
+		gli::texture2d image;
 
-		// fastest way to get parameters and ensure texture is active
-		if ( texLoad( filepath, format, target, width, height, mipmaps, id ) ) {
-			//qDebug() << "Width" << width << "height" << height << "mipmaps" << mipmaps << "format" << format;
-		} else {
+		try
+		{
+			if ( texDecode( filepath, fileData, format, texture ) )
+				image = bcDecompress( texture );
+		}
+		catch ( QString & e )
+		{
+			qCCritical( nsIo ) << e;
+		}
+
+		if ( image.empty() ) {
 			qCCritical( nsIo ) << QObject::tr( "Error importing %1" ).arg( filepath );
 			return false;
 		}
 
+		GLuint width = GLuint( image.extent().x );
+		GLuint height = GLuint( image.extent().y );
+		GLuint mipmaps = GLuint( image.levels() );
+
 		// set texture as RGBA
 		nif->set<quint32>( iData, "Pixel Format", 1 );
 		nif->set<quint32>( iData, "Bits Per Pixel", 32 );
@@ -1753,13 +1969,7 @@ bool texSaveNIF( NifModel * nif, const QString & filepath, QModelIndex & iData )
 
 			quint32 mipmapSize = mipmapWidth * mipmapHeight * 4;
 
-			QByteArray mipmapData;
-			mipmapData.resize( mipmapSize );
-
-			glGetTexImage( GL_TEXTURE_2D, i, GL_RGBA, GL_UNSIGNED_BYTE, mipmapData.data() );
-			//qDebug() << "Copying mipmap" << i << "," << mipmapSize << "bytes";
-
-			pixelData.append( mipmapData );
+			pixelData.append( static_cast<const char *>( image.data( 0, 0, i ) ), int( mipmapSize ) );
 
 			//qDebug() << "Now have" << pixelData.size() << "bytes of pixel data";
 
@@ -79,6 +79,28 @@ extern gli::texture load_if_valid( const char * data, unsigned int size );
 extern bool texLoad( const QString & filepath, QString & format, GLenum & target, GLuint & width, GLuint & height, GLuint & mipmaps, GLuint & id );
 extern bool texLoad( const QString & filepath, QString & format, GLenum & target, GLuint & width, GLuint & height, GLuint & mipmaps, QByteArray & data, GLuint & id );
 
+/*! Decodes a texture file on the CPU, without making any GL calls.
+ *
+ * This is safe to call from worker threads; the result is uploaded with texUpload().
+ * Throws a QString on errors.
+ *
+ * @param filepath	The path of the texture, used to determine its format.
+ * @param data		The contents of the file.
+ * @param format	Contains the format on successful decode, for formats which report one.
+ * @param texture	Contains the decoded texture, empty if it is corrupt or unsupported.
+ * @return			False if the format can only be loaded with texLoad(), e.g. NIF pixel data.
+ */
+extern bool texDecode( const QString & filepath, QByteArray & data, QString & format, gli::texture & texture );
+
+/*! Uploads a decoded texture to a new GL texture.
+ *
+ * Any texture already named by id is deleted first.
+ *
+ * @param filepath	The path of the texture, used in messages.
+ * @return			True if the upload was successful.
+ */
+extern bool texUpload( gli::texture & texture, const QString & filepath, GLenum & target, GLuint & width, GLuint & height, GLuint & mipmaps, GLuint & id );
+
 /*! A function for loading textures.
  *
  * Loads a texture pointed to by model index.
@@ -95,6 +117,57 @@ extern bool texLoad( const QString & filepath, QString & format, GLenum & target
  */
 extern bool texLoad( const QModelIndex & iData, QString & format, GLenum & target, GLuint & width, GLuint & height, GLuint & mipmaps, GLuint & id );
 
+/*! Decodes the pixel data of a NiPixelData block on the CPU, without making any GL calls.
+ *
+ * Uncompressed formats are decoded to RGBA; DXT formats are kept compressed.
+ *
+ * @param iData		Reference to pixel data block
+ * @param format	Contains the format, for instance "NIF (DXT1)".
+ * @param texture	Contains the decoded texture.
+ * @return			True if the decode was successful, false otherwise.
+ */
+extern bool texDecode( const QModelIndex & iData, QString & format, gli::texture & texture );
+
+/*! Hashes the contents of a texture so that identical textures can share one GL texture.
+ *
+ * @param data		The contents of a texture file.
+ * @return			A 64-bit hash, or 0 if there is no data.
+ */
+extern quint64 texContentHash( const QByteArray & data );
+
+/*! Hashes the pixel data, format and palette of a NiPixelData block.
+ *
+ * @param iData		The NiPixelData or ATextureRenderData block.
+ * @return			A 64-bit hash, or 0 if the block has no pixel data.
+ */
+extern quint64 texContentHash( const QModelIndex & iData );
+
+//! Size of the DDS magic, header and DX10 header; texProbeDDS() needs no more than this
+const int DDS_PROBE_SIZE = 4 + 124 + 20;
+
+/*! Reads the dimensions, format and mipmap count of a DDS texture from its header only.
+ *
+ * Nothing is decoded or uploaded, so this is cheap enough to validate many textures.
+ *
+ * @param header	The first DDS_PROBE_SIZE bytes of the file, or the whole file if it is smaller.
+ * @param format	Contains the format, for instance "DDS (DXT5)", if the header is valid.
+ * @param width		Contains the width of the first mipmap.
+ * @param height	Contains the height of the first mipmap.
+ * @param mipmaps	Contains the number of mipmaps.
+ * @return			False if the header is truncated, invalid or of an unsupported format.
+ */
+extern bool texProbeDDS( const QByteArray & header, QString & format, GLuint & width, GLuint & height, GLuint & mipmaps );
+
+/*! Reads the dimensions and mipmap count of a NiPixelData block from its mipmap list, without decoding it.
+ *
+ * @param iData		The NiPixelData or ATextureRenderData block.
+ * @param width		Contains the width of the first mipmap.
+ * @param height	Contains the height of the first mipmap.
+ * @param mipmaps	Contains the number of mipmaps.
+ * @return			False if the block has no mipmaps.
+ */
+extern bool texProbePixelData( const QModelIndex & iData, GLuint & width, GLuint & height, GLuint & mipmaps );
+
 /*! A function which checks whether the given file can be loaded.
  *
  * The function checks whether the file exists, is readable, and whether its extension
@@ -36,17 +36,144 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "lib/Miniball.hpp"
 
 #include <QMap>
+#include <QOpenGLFunctions>
 #include <QStack>
 #include <QVector>
 
 #include <stack>
 #include <map>
 #include <algorithm>
+#include <climits>
 #include <functional>
 
 
 //! \file gltools.cpp GL helper functions
 
+/*
+ *  Buffer objects
+ */
+
+void GLBuffer::invalidate( int first, int count )
+{
+	int last = ( count < 0 ) ? INT_MAX : ( first + count - 1 );
+	if ( dirtyFirst > dirtyLast ) {
+		dirtyFirst = first;
+		dirtyLast = last;
+	} else {
+		dirtyFirst = std::min( dirtyFirst, first );
+		dirtyLast = std::max( dirtyLast, last );
+	}
+}
+
+bool GLBuffer::upload( QOpenGLFunctions * fn, const void * data, int count, int elemSize )
+{
+	if ( !fn || count <= 0 || !fn->hasOpenGLFeature( QOpenGLFunctions::Buffers ) )
+		return false;
+
+	if ( !buffer.isCreated() && !buffer.create() )
+		return false;
+
+	fn->glBindBuffer( target, buffer.bufferId() );
+
+	int bytes = count * elemSize;
+	if ( bytes != size || elemSize != elementSize ) {
+		fn->glBufferData( target, bytes, data, ( target == GL_ELEMENT_ARRAY_BUFFER ) ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW );
+		size = bytes;
+		elementSize = elemSize;
+	} else {
+		// A different array of the same size replaces all of the contents
+		if ( data != source ) {
+			dirtyFirst = 0;
+			dirtyLast = count - 1;
+		}
+
+		int last = std::min( dirtyLast, count - 1 );
+		if ( dirtyFirst <= last ) {
+			int offset = dirtyFirst * elemSize;
+			fn->glBufferSubData( target, offset, ( last - dirtyFirst + 1 ) * elemSize, static_cast<const char *>( data ) + offset );
+		}
+	}
+
+	source = data;
+	dirtyFirst = 0;
+	dirtyLast = -1;
+	return true;
+}
+
+void GLBuffer::vertexPointer( QOpenGLFunctions * fn, const QVector<Vector3> & data )
+{
+	if ( upload( fn, data.constData(), data.count(), sizeof(Vector3) ) ) {
+		glVertexPointer( 3, GL_FLOAT, 0, nullptr );
+		fn->glBindBuffer( target, 0 );
+	} else {
+		glVertexPointer( 3, GL_FLOAT, 0, data.constData() );
+	}
+}
+
+void GLBuffer::normalPointer( QOpenGLFunctions * fn, const QVector<Vector3> & data )
+{
+	if ( upload( fn, data.constData(), data.count(), sizeof(Vector3) ) ) {
+		glNormalPointer( GL_FLOAT, 0, nullptr );
+		fn->glBindBuffer( target, 0 );
+	} else {
+		glNormalPointer( GL_FLOAT, 0, data.constData() );
+	}
+}
+
+void GLBuffer::colorPointer( QOpenGLFunctions * fn, const QVector<Color4> & data )
+{
+	if ( upload( fn, data.constData(), data.count(), sizeof(Color4) ) ) {
+		glColorPointer( 4, GL_FLOAT, 0, nullptr );
+		fn->glBindBuffer( target, 0 );
+	} else {
+		glColorPointer( 4, GL_FLOAT, 0, data.constData() );
+	}
+}
+
+void GLBuffer::texCoordPointer( QOpenGLFunctions * fn, const QVector<Vector2> & data )
+{
+	if ( upload( fn, data.constData(), data.count(), sizeof(Vector2) ) ) {
+		glTexCoordPointer( 2, GL_FLOAT, 0, nullptr );
+		fn->glBindBuffer( target, 0 );
+	} else {
+		glTexCoordPointer( 2, GL_FLOAT, 0, data.constData() );
+	}
+}
+
+void GLBuffer::texCoordPointer( QOpenGLFunctions * fn, const QVector<Vector3> & data )
+{
+	if ( upload( fn, data.constData(), data.count(), sizeof(Vector3) ) ) {
+		glTexCoordPointer( 3, GL_FLOAT, 0, nullptr );
+		fn->glBindBuffer( target, 0 );
+	} else {
+		glTexCoordPointer( 3, GL_FLOAT, 0, data.constData() );
+	}
+}
+
+void GLBuffer::texCoordPointer( QOpenGLFunctions * fn, const QVector<Vector4> & data )
+{
+	if ( upload( fn, data.constData(), data.count(), sizeof(Vector4) ) ) {
+		glTexCoordPointer( 4, GL_FLOAT, 0, nullptr );
+		fn->glBindBuffer( target, 0 );
+	} else {
+		glTexCoordPointer( 4, GL_FLOAT, 0, data.constData() );
+	}
+}
+
+void GLBuffer::drawTriangles( QOpenGLFunctions * fn, const QVector<Triangle> & tris, int iStartOffset, int nTris )
+{
+	if ( nTris <= 0 )
+		return;
+
+	if ( upload( fn, tris.constData(), tris.count(), sizeof(Triangle) ) ) {
+		glDrawElements( GL_TRIANGLES, nTris * 3, GL_UNSIGNED_SHORT, reinterpret_cast<const GLvoid *>( qintptr( iStartOffset ) * sizeof(Triangle) ) );
+		fn->glBindBuffer( target, 0 );
+	} else {
+		glDrawTriangles( tris, iStartOffset, nTris );
+	}
+}
+
+
 /*
  *  Bound Sphere
  */
@@ -192,6 +319,46 @@ BoundSphere operator*( const Transform & t, const BoundSphere & sphere )
 }
 
 
+/*
+ *  Frustum
+ */
+
+void Frustum::update()
+{
+	GLfloat m[16];
+	glGetFloatv( GL_PROJECTION_MATRIX, m );
+
+	// Rows of the column-major matrix; each plane keeps -w <= x, y, z <= w
+	auto row = [&m]( int i ) { return Vector4( m[i], m[4 + i], m[8 + i], m[12 + i] ); };
+
+	Vector4 w = row( 3 );
+	for ( int i = 0; i < 3; i++ ) {
+		planes[2 * i] = w + row( i );
+		planes[2 * i + 1] = w - row( i );
+	}
+
+	for ( Vector4 & p : planes ) {
+		float l = Vector3( p ).length();
+		if ( l > 0 )
+			p /= l;
+	}
+}
+
+bool Frustum::isOutside( const BoundSphere & sphere ) const
+{
+	// An empty sphere says nothing about where the geometry is
+	if ( sphere.radius < 0 )
+		return false;
+
+	for ( const Vector4 & p : planes ) {
+		if ( Vector3::dotproduct( Vector3( p ), sphere.center ) + p[3] < -sphere.radius )
+			return true;
+	}
+
+	return false;
+}
+
+
 /*
  * draw primitives
  */
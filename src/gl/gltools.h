@@ -36,11 +36,14 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "data/niftypes.h"
 #include "model/nifmodel.h"
 
+#include <QOpenGLBuffer>
 #include <QOpenGLContext>
 #include <QPair>
 
 
-//! @file gltools.h BoundSphere, VertexWeight, BoneWeights, SkinPartition
+//! @file gltools.h BoundSphere, VertexWeight, BoneWeights, SkinPartition, GLBuffer
+
+class QOpenGLFunctions;
 
 //! A bounding sphere for an object, typically a Mesh
 class BoundSphere final
@@ -71,6 +74,20 @@ public:
 	friend BoundSphere operator*( const Transform & t, const BoundSphere & s );
 };
 
+//! The clipping planes of a projection, to cull bounding spheres in eye space
+class Frustum final
+{
+public:
+	//! Take the planes from the current GL projection matrix
+	void update();
+
+	//! Is the sphere, in eye space, entirely outside of one of the planes?
+	bool isOutside( const BoundSphere & sphere ) const;
+
+private:
+	Vector4 planes[6];
+};
+
 //! A vertex, weight pair
 class VertexWeight final
 {
@@ -84,6 +101,49 @@ public:
 	float weight;
 };
 
+//! A GL buffer object mirroring a client-side array
+/*!
+ * The array is uploaded when it is first used and after that only the elements marked
+ * with invalidate() are uploaded again, unless the array is resized or replaced.
+ * Without buffer object support the client-side array is used directly.
+ * The buffer object is released through QOpenGLBuffer, in the context it was created in.
+ */
+class GLBuffer final
+{
+public:
+	GLBuffer( GLenum target = GL_ARRAY_BUFFER )
+		: target( target ), buffer( ( target == GL_ELEMENT_ARRAY_BUFFER ) ? QOpenGLBuffer::IndexBuffer : QOpenGLBuffer::VertexBuffer ) {}
+	GLBuffer( const GLBuffer & ) = delete;
+	GLBuffer & operator=( const GLBuffer & ) = delete;
+
+	//! Marks the elements [first, first + count) as changed, all elements if count is negative
+	void invalidate( int first = 0, int count = -1 );
+
+	void vertexPointer( QOpenGLFunctions * fn, const QVector<Vector3> & data );
+	void normalPointer( QOpenGLFunctions * fn, const QVector<Vector3> & data );
+	void colorPointer( QOpenGLFunctions * fn, const QVector<Color4> & data );
+	void texCoordPointer( QOpenGLFunctions * fn, const QVector<Vector2> & data );
+	void texCoordPointer( QOpenGLFunctions * fn, const QVector<Vector3> & data );
+	void texCoordPointer( QOpenGLFunctions * fn, const QVector<Vector4> & data );
+
+	//! Draws nTris triangles starting at iStartOffset with the buffer as the element array
+	void drawTriangles( QOpenGLFunctions * fn, const QVector<Triangle> & tris, int iStartOffset, int nTris );
+
+private:
+	//! Uploads what changed and leaves the buffer bound; returns false if the client-side array has to be used
+	bool upload( QOpenGLFunctions * fn, const void * data, int count, int elementSize );
+
+	GLenum target;
+	//! Deletes the buffer object in its own context, or once that context is current again
+	QOpenGLBuffer buffer;
+
+	const void * source = nullptr;
+	int size = -1;
+	int elementSize = 0;
+	int dirtyFirst = 0;
+	int dirtyLast = -1;
+};
+
 float bhkScale( const NifModel * nif );
 float bhkInvScale( const NifModel * nif );
 float bhkScaleMult( const NifModel * nif );
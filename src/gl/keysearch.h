@@ -0,0 +1,95 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+#ifndef KEYSEARCH_H
+#define KEYSEARCH_H
+
+#include <algorithm>
+
+//! @file keysearch.h Keyframe lookup shared by the interpolators and the benchmarks
+
+//! How far from the last key findKeys() walks before it falls back to a binary search
+static const int KEY_WALK_LIMIT = 8;
+
+/*! Finds the pair of keys around a time in a track sorted by time.
+ *
+ * Walks from the key at @p iKey when the time is within KEY_WALK_LIMIT keys of it,
+ * which is the usual case during playback, and otherwise searches the rest of the
+ * track. Both give the same keys, also when several keys share the time: moving
+ * forward this is the first of them, moving backward the last.
+ *
+ * @param keyData	The keys, any type with a float time member.
+ * @param lastKey	The index of the last key.
+ * @param iKey		The index of the key found for the previous time.
+ * @param inTime	The time, strictly between the times of the first and last key.
+ * @param pKey1		Set to the key at or before the time.
+ * @param pKey2		Set to the key at or after the time.
+ */
+template <typename K>
+void findKeys( const K * keyData, int lastKey, int iKey, float inTime, const K *& pKey1, const K *& pKey2 )
+{
+	// Playback moves on by a key or so per frame, but scrubbing and changing sequences may jump anywhere
+	int iLow = std::max( iKey - KEY_WALK_LIMIT, 0 );
+	int iHigh = std::min( iKey + KEY_WALK_LIMIT, lastKey );
+	const K * pKey = keyData + iKey;
+
+	if ( inTime > keyData[iHigh].time ) {
+		// The first key at or after the time, as the forward walk finds it
+		pKey = std::lower_bound( keyData + iHigh + 1, keyData + lastKey, inTime,
+			[]( const K & key, float t ) { return key.time < t; } );
+	} else if ( inTime < keyData[iLow].time ) {
+		// The last key at or before the time, as the backward walk finds it
+		pKey = std::upper_bound( keyData + 1, keyData + iLow, inTime,
+			[]( float t, const K & key ) { return t < key.time; } ) - 1;
+	} else if ( pKey->time < inTime ) {
+		do {
+			pKey++;
+		} while( pKey->time < inTime );
+	} else if ( pKey->time > inTime ) {
+		do {
+			pKey--;
+		} while( pKey->time > inTime );
+	}
+
+	if ( pKey->time == inTime ) {
+		pKey1 = pKey2 = pKey;
+	} else if ( pKey->time > inTime ) {
+		pKey1 = pKey - 1;
+		pKey2 = pKey;
+	} else {
+		pKey1 = pKey;
+		pKey2 = pKey + 1;
+	}
+}
+
+#endif
@@ -0,0 +1,347 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+#include "mipgen.h"
+
+#include <QThread>
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <vector>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define MIPGEN_SSE2
+#include <emmintrin.h>
+#endif
+
+
+/*! @file mipgen.cpp
+ * @brief Software mipmap generation with box and Kaiser filters.
+ *
+ * Each level is resampled from the previous one in two passes, first along the
+ * rows and then along the columns. The taps of each destination texel are
+ * computed once per axis and level, which also covers odd sizes where the
+ * ratio between levels is not exactly two. The passes accumulate in the same
+ * order with or without SSE2. The weights come from libm and the compiler may
+ * contract the scalar loops into FMA, so the output can differ in the last bit
+ * between compilers and targets.
+ */
+
+//! Minimum number of destination texels in a level before it is filtered on several threads
+static const int MIP_PARALLEL_MIN_TEXELS = 128 * 128;
+//! Radius of the Kaiser filter, in texels of the destination level
+static const double KAISER_RADIUS = 3.0;
+//! Shape of the Kaiser window; higher values trade sharpness for less ringing
+static const double KAISER_ALPHA = 4.0;
+//! Entries in the table converting linear values to sRGB
+static const int SRGB_TABLE_SIZE = 4096;
+
+//! Weights of the source texels of every destination texel along one axis
+struct AxisFilter
+{
+	std::vector<int> first;
+	std::vector<int> count;
+	std::vector<int> offset;
+	std::vector<float> weights;
+};
+
+//! Zeroth order modified Bessel function of the first kind
+static double bessel0( double x )
+{
+	double sum = 1.0;
+	double term = 1.0;
+
+	for ( int k = 1; k < 32; k++ ) {
+		double t = x / ( 2.0 * k );
+		term *= t * t;
+		sum += term;
+
+		if ( term < sum * 1e-12 )
+			break;
+	}
+
+	return sum;
+}
+
+static double kaiser( double x )
+{
+	if ( std::abs( x ) >= 1.0 )
+		return 0.0;
+
+	return bessel0( KAISER_ALPHA * std::sqrt( 1.0 - x * x ) ) / bessel0( KAISER_ALPHA );
+}
+
+static double sinc( double x )
+{
+	if ( std::abs( x ) < 1e-9 )
+		return 1.0;
+
+	x *= M_PI;
+	return std::sin( x ) / x;
+}
+
+//! Compute the taps from srcSize texels down to dstSize, clamping at the edges
+static AxisFilter axisFilter( int srcSize, int dstSize, MipmapFilter filter )
+{
+	AxisFilter f;
+	double scale = double( srcSize ) / dstSize;
+
+	for ( int x = 0; x < dstSize; x++ ) {
+		double center = ( x + 0.5 ) * scale;
+		int begin, end;
+
+		if ( filter == MIPMAP_BOX ) {
+			begin = int( std::floor( x * scale ) );
+			end = int( std::ceil( ( x + 1 ) * scale ) );
+		} else {
+			begin = int( std::floor( center - KAISER_RADIUS * scale ) );
+			end = int( std::ceil( center + KAISER_RADIUS * scale ) );
+		}
+
+		int first = std::max( begin, 0 );
+		int last = std::min( end, srcSize ) - 1;
+		std::vector<double> w( last - first + 1, 0.0 );
+
+		for ( int i = begin; i < end; i++ ) {
+			double weight;
+
+			if ( filter == MIPMAP_BOX ) {
+				weight = std::min( ( x + 1 ) * scale, i + 1.0 ) - std::max( x * scale, double( i ) );
+			} else {
+				double d = ( i + 0.5 - center ) / scale;
+				weight = sinc( d ) * kaiser( d / KAISER_RADIUS );
+			}
+
+			w[std::min( std::max( i, first ), last ) - first] += weight;
+		}
+
+		double sum = 0.0;
+		for ( double weight : w )
+			sum += weight;
+
+		f.first.push_back( first );
+		f.count.push_back( int( w.size() ) );
+		f.offset.push_back( int( f.weights.size() ) );
+
+		for ( double weight : w )
+			f.weights.push_back( float( weight / sum ) );
+	}
+
+	return f;
+}
+
+//! Resample rows [firstRow, lastRow) of an RGBA float image along x
+static void filterRows( const float * src, int srcWidth, const AxisFilter & f, int dstWidth, float * dst, int firstRow, int lastRow )
+{
+	for ( int y = firstRow; y < lastRow; y++ ) {
+		const float * row = src + size_t( y ) * srcWidth * 4;
+		float * out = dst + size_t( y ) * dstWidth * 4;
+
+		for ( int x = 0; x < dstWidth; x++ ) {
+			const float * in = row + f.first[x] * 4;
+			const float * w = f.weights.data() + f.offset[x];
+			int count = f.count[x];
+
+#ifdef MIPGEN_SSE2
+			__m128 acc = _mm_setzero_ps();
+			for ( int k = 0; k < count; k++ )
+				acc = _mm_add_ps( acc, _mm_mul_ps( _mm_set1_ps( w[k] ), _mm_loadu_ps( in + 4 * k ) ) );
+
+			_mm_storeu_ps( out + 4 * x, acc );
+#else
+			float acc[4] = {};
+			for ( int k = 0; k < count; k++ ) {
+				for ( int c = 0; c < 4; c++ )
+					acc[c] += w[k] * in[4 * k + c];
+			}
+
+			for ( int c = 0; c < 4; c++ )
+				out[4 * x + c] = acc[c];
+#endif
+		}
+	}
+}
+
+//! Resample rows [firstRow, lastRow) of the destination along y from an RGBA float image
+static void filterColumns( const float * src, int width, const AxisFilter & f, float * dst, int firstRow, int lastRow )
+{
+	const int floats = width * 4;
+
+	for ( int y = firstRow; y < lastRow; y++ ) {
+		float * out = dst + size_t( y ) * floats;
+		std::fill( out, out + floats, 0.0f );
+
+		for ( int k = 0; k < f.count[y]; k++ ) {
+			const float * in = src + size_t( f.first[y] + k ) * floats;
+			float w = f.weights[f.offset[y] + k];
+			int i = 0;
+
+#ifdef MIPGEN_SSE2
+			__m128 wv = _mm_set1_ps( w );
+			for ( ; i + 4 <= floats; i += 4 )
+				_mm_storeu_ps( out + i, _mm_add_ps( _mm_loadu_ps( out + i ), _mm_mul_ps( wv, _mm_loadu_ps( in + i ) ) ) );
+#endif
+			for ( ; i < floats; i++ )
+				out[i] += w * in[i];
+		}
+	}
+}
+
+//! Run func( first, last ) over bands of rows, in parallel if there is enough work
+template <typename F>
+static void forRows( int rows, int texels, F func )
+{
+	int threads = 1;
+	if ( texels >= MIP_PARALLEL_MIN_TEXELS )
+		threads = std::min( QThread::idealThreadCount(), rows );
+
+	if ( threads <= 1 ) {
+		func( 0, rows );
+		return;
+	}
+
+	std::vector<std::future<void>> jobs;
+	for ( int t = 0; t < threads; t++ )
+		jobs.push_back( std::async( std::launch::async, func, rows * t / threads, rows * ( t + 1 ) / threads ) );
+
+	for ( auto & job : jobs )
+		job.get();
+}
+
+//! sRGB to linear conversion of 8-bit values
+static const float * srgbToLinearTable()
+{
+	static const std::vector<float> table = []() {
+		std::vector<float> t( 256 );
+		for ( int i = 0; i < 256; i++ ) {
+			double v = i / 255.0;
+			t[i] = float( v <= 0.04045 ? v / 12.92 : std::pow( ( v + 0.055 ) / 1.055, 2.4 ) );
+		}
+		return t;
+	}();
+
+	return table.data();
+}
+
+//! Linear to sRGB conversion, indexed by the linear value scaled to SRGB_TABLE_SIZE - 1
+static const quint8 * linearToSrgbTable()
+{
+	static const std::vector<quint8> table = []() {
+		std::vector<quint8> t( SRGB_TABLE_SIZE );
+		for ( int i = 0; i < SRGB_TABLE_SIZE; i++ ) {
+			double v = double( i ) / ( SRGB_TABLE_SIZE - 1 );
+			v = ( v <= 0.0031308 ) ? v * 12.92 : 1.055 * std::pow( v, 1.0 / 2.4 ) - 0.055;
+			t[i] = quint8( std::lround( std::min( std::max( v, 0.0 ), 1.0 ) * 255.0 ) );
+		}
+		return t;
+	}();
+
+	return table.data();
+}
+
+static inline quint8 toUnorm8( float v )
+{
+	return quint8( std::min( std::max( v, 0.0f ), 1.0f ) * 255.0f + 0.5f );
+}
+
+// (public function, documented in mipgen.h)
+bool mipGenerate( gli::texture2d & texture, int first, MipmapFilter filter )
+{
+	bool srgb = ( texture.format() == gli::FORMAT_RGBA8_SRGB_PACK8 );
+	if ( !srgb && texture.format() != gli::FORMAT_RGBA8_UNORM_PACK8 )
+		return false;
+
+	int levels = int( texture.levels() );
+	if ( first < 1 || first >= levels )
+		return true;
+
+	const float * toLinear = srgbToLinearTable();
+	const quint8 * toSrgb = linearToSrgbTable();
+
+	// The chain is filtered in floating point to avoid compounding the rounding of every level
+	int width = texture.extent( first - 1 ).x;
+	int height = texture.extent( first - 1 ).y;
+
+	std::vector<float> current( size_t( width ) * height * 4 );
+	{
+		auto src = static_cast<const quint8 *>( texture.data( 0, 0, first - 1 ) );
+
+		for ( size_t i = 0; i < current.size(); i++ )
+			current[i] = ( srgb && ( i & 3 ) != 3 ) ? toLinear[src[i]] : src[i] / 255.0f;
+	}
+
+	std::vector<float> rows;
+	std::vector<float> next;
+
+	for ( int m = first; m < levels; m++ ) {
+		int w = texture.extent( m ).x;
+		int h = texture.extent( m ).y;
+
+		AxisFilter fx = axisFilter( width, w, filter );
+		AxisFilter fy = axisFilter( height, h, filter );
+
+		rows.resize( size_t( w ) * height * 4 );
+		next.resize( size_t( w ) * h * 4 );
+
+		const float * src = current.data();
+		float * tmp = rows.data();
+		float * dst = next.data();
+
+		forRows( height, w * height, [&]( int firstRow, int lastRow ) {
+			filterRows( src, width, fx, w, tmp, firstRow, lastRow );
+		} );
+
+		forRows( h, w * h, [&]( int firstRow, int lastRow ) {
+			filterColumns( tmp, w, fy, dst, firstRow, lastRow );
+		} );
+
+		auto out = static_cast<quint8 *>( texture.data( 0, 0, m ) );
+
+		for ( size_t i = 0; i < next.size(); i++ ) {
+			if ( srgb && ( i & 3 ) != 3 ) {
+				float v = std::min( std::max( next[i], 0.0f ), 1.0f );
+				out[i] = toSrgb[int( v * ( SRGB_TABLE_SIZE - 1 ) + 0.5f )];
+			} else {
+				out[i] = toUnorm8( next[i] );
+			}
+		}
+
+		current.swap( next );
+		width = w;
+		height = h;
+	}
+
+	return true;
+}
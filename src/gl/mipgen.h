@@ -0,0 +1,71 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+#ifndef MIPGEN_H
+#define MIPGEN_H
+
+#ifdef _MSC_VER
+#pragma warning(push, 0)
+#endif
+
+#include <gli.hpp>
+
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+//! @file mipgen.h Software mipmap generation
+
+//! Filters for mipGenerate()
+enum MipmapFilter
+{
+	MIPMAP_BOX,     //!< Average of the texels covered by each texel of the next level
+	MIPMAP_KAISER   //!< Kaiser windowed sinc, sharper than the box filter
+};
+
+/*! Completes the mipmap chain of an RGBA8 texture on the CPU.
+ *
+ * Every level is filtered from the one above it, separably and in floating point,
+ * so the result does not depend on the GL implementation. Levels of odd size are
+ * filtered exactly rather than dropping the last row or column. sRGB textures are
+ * filtered in linear space; alpha is always filtered linearly. Large levels are
+ * split into bands of rows which are filtered in parallel.
+ *
+ * @param texture	A texture in FORMAT_RGBA8_UNORM_PACK8 or FORMAT_RGBA8_SRGB_PACK8.
+ * @param first		The number of levels that are already in the texture, at least 1.
+ * @param filter	The downsampling filter.
+ * @return			False if the format is not supported.
+ */
+bool mipGenerate( gli::texture2d & texture, int first, MipmapFilter filter = MIPMAP_KAISER );
+
+#endif
@@ -0,0 +1,198 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+#include "pixelconvert.h"
+
+#include <cstring>
+
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#define PIXELCONVERT_SSE2
+#include <emmintrin.h>
+#endif
+
+
+//! @file pixelconvert.cpp Conversion of masked pixels to RGBA8, with SSE2 kernels
+
+//! Shift amounts for RGBA conversion
+static const int rgbashift[4] = {
+	0, 8, 16, 24
+};
+
+//! Masks and shifts moving each channel of a pixel into its RGBA byte
+struct ChannelShifts
+{
+	quint32 mask[4];
+	int rshift[4];
+	int lshift[4];
+	//! Set for channels without a mask, i.e. opaque alpha
+	quint32 fill;
+};
+
+//! Compute the shifts for a set of channel masks
+static ChannelShifts channelShifts( const quint32 mask[] )
+{
+	ChannelShifts cs = {};
+
+	for ( int a = 0; a < 4; a++ ) {
+		cs.mask[a] = mask[a];
+
+		if ( mask[a] ) {
+			quint32 msk = mask[ a ];
+			int rshift  = 0;
+
+			while ( msk != 0 && ( msk & 0xffffff00 ) ) {
+				msk = msk >> 1; rshift++;
+			}
+
+			int lshift = rgbashift[ a ];
+
+			while ( msk != 0 && ( ( msk & 0x80 ) == 0 ) ) {
+				msk = msk << 1; lshift++;
+			}
+
+			// Masks already in place are copied as they are
+			if ( rshift != lshift ) {
+				cs.rshift[a] = rshift;
+				cs.lshift[a] = lshift;
+			}
+		} else if ( a == 3 ) {
+			cs.fill = 0xffu << rgbashift[ a ];
+		}
+	}
+
+	return cs;
+}
+
+//! Convert a single pixel, read as a 32-bit word
+static inline quint32 convertPixel( quint32 x, const ChannelShifts & cs )
+{
+	return cs.fill
+		| ( ( x & cs.mask[0] ) >> cs.rshift[0] << cs.lshift[0] )
+		| ( ( x & cs.mask[1] ) >> cs.rshift[1] << cs.lshift[1] )
+		| ( ( x & cs.mask[2] ) >> cs.rshift[2] << cs.lshift[2] )
+		| ( ( x & cs.mask[3] ) >> cs.rshift[3] << cs.lshift[3] );
+}
+
+#ifdef PIXELCONVERT_SSE2
+//! Convert four 32-bit pixels at once
+static inline __m128i convertPixels( __m128i v, const __m128i mask[], const __m128i rshift[], const __m128i lshift[], __m128i fill )
+{
+	__m128i p = fill;
+	for ( int a = 0; a < 4; a++ )
+		p = _mm_or_si128( p, _mm_sll_epi32( _mm_srl_epi32( _mm_and_si128( v, mask[a] ), rshift[a] ), lshift[a] ) );
+
+	return p;
+}
+
+/*! Convert a row of 2 or 4 byte pixels with SSE2
+ *
+ * @return	The number of pixels converted, the remainder is left to the scalar loop
+ */
+static int convertRowSSE2( const quint8 * src, quint32 * dst, int w, int bytespp, const ChannelShifts & cs )
+{
+	__m128i mask[4], rshift[4], lshift[4];
+	for ( int a = 0; a < 4; a++ ) {
+		mask[a] = _mm_set1_epi32( int( cs.mask[a] ) );
+		rshift[a] = _mm_cvtsi32_si128( cs.rshift[a] );
+		lshift[a] = _mm_cvtsi32_si128( cs.lshift[a] );
+	}
+	const __m128i fill = _mm_set1_epi32( int( cs.fill ) );
+
+	int x = 0;
+	if ( bytespp == 4 ) {
+		for ( ; x + 4 <= w; x += 4 ) {
+			__m128i v = _mm_loadu_si128( (const __m128i *)( src + x * 4 ) );
+			_mm_storeu_si128( (__m128i *)( dst + x ), convertPixels( v, mask, rshift, lshift, fill ) );
+		}
+	} else if ( bytespp == 2 ) {
+		const __m128i zero = _mm_setzero_si128();
+		for ( ; x + 8 <= w; x += 8 ) {
+			__m128i v = _mm_loadu_si128( (const __m128i *)( src + x * 2 ) );
+			_mm_storeu_si128( (__m128i *)( dst + x ), convertPixels( _mm_unpacklo_epi16( v, zero ), mask, rshift, lshift, fill ) );
+			_mm_storeu_si128( (__m128i *)( dst + x + 4 ), convertPixels( _mm_unpackhi_epi16( v, zero ), mask, rshift, lshift, fill ) );
+		}
+	}
+
+	return x;
+}
+#endif
+
+// (public function, documented in pixelconvert.h)
+void convertToRGBA( const quint8 * data, int w, int h, int bytespp, const quint32 mask[], bool flipV, bool flipH, quint8 * pixl )
+{
+	const ChannelShifts cs = channelShifts( mask );
+
+	// 2 byte pixels are widened to 32 bits, which only works if the masks do not reach into the next pixel
+	bool simd = ( bytespp == 4 ) || ( bytespp == 2 && ( ( mask[0] | mask[1] | mask[2] | mask[3] ) & 0xffff0000 ) == 0 );
+	bool bgr8 = ( bytespp == 3 && mask[0] == 0x00ff0000 && mask[1] == 0x0000ff00 && mask[2] == 0x000000ff && mask[3] == 0 );
+
+	for ( int y = 0; y < h; y++ ) {
+		const quint8 * src = data + y * w * bytespp;
+		quint32 * dst = (quint32 *)( pixl + 4 * ( w * ( flipV ? h - y - 1 : y ) ) );
+
+		if ( flipH ) {
+			dst += w - 1;
+			for ( int x = 0; x < w; x++ ) {
+				quint32 px;
+				memcpy( &px, src, sizeof( px ) );
+				*dst-- = convertPixel( px, cs );
+				src += bytespp;
+			}
+			continue;
+		}
+
+		int x = 0;
+		if ( bgr8 ) {
+			for ( ; x < w; x++ ) {
+				dst[x] = quint32( src[2] ) | ( quint32( src[1] ) << 8 ) | ( quint32( src[0] ) << 16 ) | 0xff000000;
+				src += 3;
+			}
+		}
+#ifdef PIXELCONVERT_SSE2
+		else if ( simd ) {
+			x = convertRowSSE2( src, dst, w, bytespp, cs );
+			src += x * bytespp;
+		}
+#else
+		Q_UNUSED( simd );
+#endif
+
+		for ( ; x < w; x++ ) {
+			// Like the source buffers, reads a whole word; bits outside the masks are ignored
+			quint32 px;
+			memcpy( &px, src, sizeof( px ) );
+			dst[x] = convertPixel( px, cs );
+			src += bytespp;
+		}
+	}
+}
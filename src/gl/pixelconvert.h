@@ -0,0 +1,59 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+#ifndef PIXELCONVERT_H
+#define PIXELCONVERT_H
+
+#include <QtGlobal>
+
+//! @file pixelconvert.h Conversion of uncompressed pixel layouts to RGBA8
+
+/*! Convert pixels to RGBA
+ *
+ * Each pixel is converted in a single pass. Rows of 4 byte pixels (e.g. BGRA8) and of 2 byte
+ * pixels (e.g. RGB565, ARGB4444) use SSE2 where available, 3 byte BGR8 has its own loop.
+ * Flipping only changes where rows and pixels are written. Every pixel is read as a
+ * 32-bit word, so @p data must stay readable for 4 - @p bytespp bytes past its end.
+ *
+ * @param data		Pixels to convert
+ * @param w			Width of the image
+ * @param h			Height of the image
+ * @param bytespp	Number of bytes per pixel
+ * @param mask		Bitmask for pixel data
+ * @param flipV		Whether to flip the data vertically
+ * @param flipH		Whether to flip the data horizontally
+ * @param pixl		Pixels to output
+ */
+void convertToRGBA( const quint8 * data, int w, int h, int bytespp, const quint32 mask[], bool flipV, bool flipH, quint8 * pixl );
+
+#endif
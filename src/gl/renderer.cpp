@@ -51,12 +51,17 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QSettings>
 #include <QTextStream>
 
+#include <algorithm>
+
 
 //! @file renderer.cpp Renderer and child classes implementation
 
 bool shader_initialized = false;
 bool shader_ready = true;
 
+//! Size of the boneTransforms array of the vertex shaders
+static const int GPU_SKIN_MAX_BONES = 100;
+
 bool Renderer::initialize()
 {
 	if ( !shader_initialized ) {
@@ -105,6 +110,7 @@ Renderer::ConditionSingle::ConditionSingle( const QString & line, bool neg ) : i
 			break;
 	}
 
+	QString left;
 	if ( pos > 0 ) {
 		left  = line.left( pos ).trimmed();
 		right = line.right( line.length() - pos - i.value().length() ).trimmed();
@@ -117,81 +123,88 @@ Renderer::ConditionSingle::ConditionSingle( const QString & line, bool neg ) : i
 		left = line;
 		comp = NONE;
 	}
+
+	// Resolve the left side once here instead of on every evaluation
+	if ( left.startsWith( "HEADER/" ) ) {
+		header = true;
+		fieldPath = left.mid( 7 ).split( "/" );
+	} else {
+		pos = left.indexOf( "/" );
+		if ( pos > 0 ) {
+			blockType = left.left( pos );
+			fieldPath = left.mid( pos + 1 ).split( "/" );
+		} else {
+			blockType = left;
+		}
+	}
+
+	rightCount = right.toULongLong( nullptr, 0 );
+	rightFloat = (float)right.toDouble();
+	rightUInt = right.toUInt( nullptr, 0 );
 }
 
-QModelIndex Renderer::ConditionSingle::getIndex( const NifModel * nif, const QVector<QModelIndex> & iBlocks, QString blkid ) const
+const NifItem * Renderer::ConditionSingle::getItem( const NifModel * nif, const QVector<const NifItem *> & blocks ) const
 {
-	QString childid;
+	const NifItem * item = nullptr;
 
-	if ( blkid.startsWith( "HEADER/" ) ) {
-		auto blk = blkid.remove( "HEADER/" );
-		if ( blk.contains("/") ) {
-			auto blks = blk.split( "/" );
-			return nif->getIndex( nif->getIndex( nif->getHeaderIndex(), blks.at(0) ), blks.at(1) );
+	if ( header ) {
+		item = nif->getHeaderItem();
+	} else {
+		for ( const NifItem * block : blocks ) {
+			if ( nif->blockInherits( block, blockType ) ) {
+				item = block;
+				break;
+			}
 		}
-		return nif->getIndex( nif->getHeaderIndex(), blk );
 	}
 
-	int pos = blkid.indexOf( "/" );
-
-	if ( pos > 0 ) {
-		childid = blkid.right( blkid.length() - pos - 1 );
-		blkid = blkid.left( pos );
+	for ( const QString & name : fieldPath ) {
+		if ( !item )
+			break;
+		item = nif->getItem( item, name );
 	}
 
-	for ( QModelIndex iBlock : iBlocks ) {
-		if ( nif->blockInherits( iBlock, blkid ) ) {
-			if ( childid.isEmpty() )
-				return iBlock;
-
-			return nif->getIndex( iBlock, childid );
-		}
-	}
-	return QModelIndex();
+	return item;
 }
 
-bool Renderer::ConditionSingle::eval( const NifModel * nif, const QVector<QModelIndex> & iBlocks ) const
+bool Renderer::ConditionSingle::eval( const NifModel * nif, const QVector<const NifItem *> & blocks ) const
 {
-	QModelIndex iLeft = getIndex( nif, iBlocks, left );
+	const NifItem * item = getItem( nif, blocks );
 
-	if ( !iLeft.isValid() )
+	if ( !item )
 		return invert;
 
 	if ( comp == NONE )
 		return !invert;
 
-	const NifItem * item = nif->getItem( iLeft );
-	if ( !item )
-		return false;
-
 	if ( item->isString() )
 		return compare( item->getValueAsString(), right ) ^ invert;
 	else if ( item->isCount() )
-		return compare( item->getCountValue(), right.toULongLong( nullptr, 0 ) ) ^ invert;
+		return compare( item->getCountValue(), rightCount ) ^ invert;
 	else if ( item->isFloat() )
-		return compare( item->getFloatValue(), (float)right.toDouble() ) ^ invert;
+		return compare( item->getFloatValue(), rightFloat ) ^ invert;
 	else if ( item->isFileVersion() )
-		return compare( item->getFileVersionValue(), right.toUInt( nullptr, 0 ) ) ^ invert;
+		return compare( item->getFileVersionValue(), rightUInt ) ^ invert;
 	else if ( item->valueType() == NifValue::tBSVertexDesc )
-		return compare( (uint) item->get<BSVertexDesc>().GetFlags(), right.toUInt( nullptr, 0 ) ) ^ invert;
+		return compare( (uint) item->get<BSVertexDesc>().GetFlags(), rightUInt ) ^ invert;
 
 	return false;
 }
 
-bool Renderer::ConditionGroup::eval( const NifModel * nif, const QVector<QModelIndex> & iBlocks ) const
+bool Renderer::ConditionGroup::eval( const NifModel * nif, const QVector<const NifItem *> & blocks ) const
 {
 	if ( conditions.isEmpty() )
 		return true;
 
 	if ( isOrGroup() ) {
 		for ( Condition * cond : conditions ) {
-			if ( cond->eval( nif, iBlocks ) )
+			if ( cond->eval( nif, blocks ) )
 				return true;
 		}
 		return false;
 	} else {
 		for ( Condition * cond : conditions ) {
-			if ( !cond->eval( nif, iBlocks ) )
+			if ( !cond->eval( nif, blocks ) )
 				return false;
 		}
 		return true;
@@ -391,6 +404,10 @@ void Renderer::Program::setUniformLocations()
 {
 	for ( int i = 0; i < NUM_UNIFORM_TYPES; i++ )
 		uniformLocations[i] = f->glGetUniformLocation( id, uniforms[i].c_str() );
+
+	const QList<CoordType> coordTypes = texcoords.values();
+	skinning = uniformLocations[GPU_SKINNED] >= 0 && uniformLocations[GPU_BONES] >= 0
+		&& coordTypes.contains( CT_BONE ) && coordTypes.contains( CT_WEIGHT );
 }
 
 Renderer::Renderer( QOpenGLContext * c, QOpenGLFunctions * f )
@@ -412,6 +429,7 @@ void Renderer::updateSettings()
 	QSettings settings;
 
 	cfg.useShaders = settings.value( "Settings/Render/General/Use Shaders", true ).toBool();
+	cfg.gpuSkinning = settings.value( "Settings/Render/General/Gpu Skinning", true ).toBool();
 
 	bool prevStatus = shader_ready;
 
@@ -458,70 +476,178 @@ void Renderer::updateShaders()
 		Program * program = new Program( name, fn );
 		program->load( dir.filePath( name ), this );
 		program->setUniformLocations();
-		programs.insert( name, program );
+		programs.append( program );
 	}
+
+	// Evaluated in the order of their names, whatever order the directory lists them in
+	std::sort( programs.begin(), programs.end(), []( const Program * a, const Program * b ) {
+		return a->name < b->name;
+	} );
+
+	programsRevision++;
 }
 
 void Renderer::releaseShaders()
 {
+	programsRevision++;
+
 	if ( !shader_ready )
 		return;
 
+	useProgram( 0 );
+
 	qDeleteAll( programs );
 	programs.clear();
 	qDeleteAll( shaders );
 	shaders.clear();
 }
 
-QString Renderer::setupProgram( Shape * mesh, const QString & hint )
+QString Renderer::setupProgram( Shape * mesh )
 {
 	PropertyList props;
 	mesh->activeProperties( props );
 
 	auto nif = NifModel::fromValidIndex(mesh->index());
 	if ( !shader_ready 
-		 || hint.isNull()
 		 || mesh->scene->hasOption(Scene::DisableShaders)
 		 || mesh->scene->hasVisMode(Scene::VisSilhouette)
 		 || !nif
 		 || (nif->getBSVersion() == 0)
 	) {
+		// The previous shape of a batch may have left its program bound
+		useProgram( 0 );
 		setupFixedFunction( mesh, props );
 		return {};
 	}
 
-	QVector<QModelIndex> iBlocks;
-	iBlocks << mesh->index();
-	iBlocks << mesh->iData;
-	for ( Property * p : props.hash() ) {
-		iBlocks.append( p->index() );
+	// The conditions are only evaluated again after the shape's blocks have changed (see Shape::updateImpl)
+	int first = 0;
+	if ( mesh->shaderRevision == programsRevision ) {
+		if ( mesh->shaderProgram < 0 || mesh->shaderProgram >= programs.count() )
+			first = programs.count();
+		else if ( setupProgram( programs.at( mesh->shaderProgram ), mesh, props ) )
+			return programs.at( mesh->shaderProgram )->name;
+		else
+			first = mesh->shaderProgram + 1;
 	}
 
-	if ( !hint.isEmpty() ) {
-		Program * program = programs.value( hint );
-		if ( program && program->status && setupProgram( program, mesh, props, iBlocks, false ) )
-			return program->name;
-	}
+	// Programs whose conditions match can still fail to bind, e.g. without tangents; then the next one is tried
+	mesh->shaderProgram = -1;
+	mesh->shaderRevision = programsRevision;
 
-	for ( Program * program : programs ) {
-		if ( program->status && setupProgram( program, mesh, props, iBlocks ) )
-			return program->name;
+	for ( int i = selectProgram( nif, mesh, props, first ); i >= 0; i = selectProgram( nif, mesh, props, i + 1 ) ) {
+		if ( setupProgram( programs.at( i ), mesh, props ) ) {
+			mesh->shaderProgram = i;
+			return programs.at( i )->name;
+		}
 	}
 
 	stopProgram();
+
+	// The fixed function pipeline cannot blend the bones, so the arrays bound by the shape are replaced by the skinned ones
+	if ( mesh->gpuSkinning ) {
+		mesh->applyCpuSkinning();
+		mesh->vertexBuffer.vertexPointer( fn, mesh->transVerts );
+		mesh->normalBuffer.normalPointer( fn, mesh->transNorms );
+	}
+
 	setupFixedFunction( mesh, props );
 	return {};
 }
 
+bool Renderer::canSkin( const Shape * mesh ) const
+{
+	if ( !shader_ready || !cfg.gpuSkinning
+		 || mesh->scene->hasOption(Scene::DisableShaders)
+		 || mesh->scene->hasVisMode(Scene::VisSilhouette)
+		 || mesh->bones.count() > GPU_SKIN_MAX_BONES
+	)
+		return false;
+
+	// The program is only known once the shape has been drawn, until then it is skinned on the CPU
+	if ( mesh->shaderRevision != programsRevision || mesh->shaderProgram < 0 || mesh->shaderProgram >= programs.count() )
+		return false;
+
+	return programs.at( mesh->shaderProgram )->skinning;
+}
+
+int Renderer::selectProgram( const NifModel * nif, Shape * mesh, const PropertyList & props, int first ) const
+{
+	if ( first >= programs.count() )
+		return -1;
+
+	QVector<const NifItem *> blocks;
+	blocks << nif->getItem( mesh->index(), false ) << nif->getItem( mesh->iData, false );
+	for ( Property * p : props.hash() )
+		blocks << nif->getItem( p->index(), false );
+	blocks.removeAll( nullptr );
+
+	for ( int i = first; i < programs.count(); i++ ) {
+		const Program * program = programs.at( i );
+		if ( program->status && program->conditions.eval( nif, blocks ) )
+			return i;
+	}
+
+	return -1;
+}
+
 void Renderer::stopProgram()
 {
 	if ( shader_ready ) {
-		fn->glUseProgram( 0 );
+		useProgram( 0 );
 	}
 
 	resetTextureUnits();
 }
 
+void Renderer::releaseProgram()
+{
+	if ( batching ) {
+		resetTextureUnits();
+		return;
+	}
+
+	stopProgram();
+}
+
+void Renderer::useProgram( GLuint id )
+{
+	if ( id != currentProgram ) {
+		fn->glUseProgram( id );
+		currentProgram = id;
+	}
+}
+
+void Renderer::beginBatch()
+{
+	batching = true;
+}
+
+void Renderer::endBatch()
+{
+	batching = false;
+	stopProgram();
+}
+
+Renderer::StateKey Renderer::stateKey( Shape * mesh ) const
+{
+	StateKey key;
+
+	if ( mesh->shaderRevision == programsRevision )
+		key.program = mesh->shaderProgram;
+
+	if ( mesh->bssp ) {
+		key.texture = mesh->scene->textures->textureId( mesh->bssp->fileName( 0 ) );
+		key.material = quintptr( mesh->bssp->getMaterial() );
+	} else {
+		// Older shapes are grouped by the properties holding their textures and material
+		key.textures = quintptr( mesh->findProperty<TexturingProperty>() );
+		key.material = quintptr( mesh->findProperty<MaterialProperty>() );
+	}
+
+	return key;
+}
+
 void Renderer::Program::uni1f( UniformType var, float x )
 {
 	f->glUniform1f( uniformLocations[var], x );
@@ -559,6 +685,12 @@ void Renderer::Program::uni4m( UniformType var, const Matrix4 & val )
 		f->glUniformMatrix4fv( uniformLocations[var], 1, 0, val.data() );
 }
 
+void Renderer::Program::uni4mv( UniformType var, const QVector<Matrix4> & val )
+{
+	if ( uniformLocations[var] >= 0 && val.count() )
+		f->glUniformMatrix4fv( uniformLocations[var], val.count(), 0, val.constFirst().data() );
+}
+
 void Renderer::Program::uniSampler( BSShaderProperty * bsprop, UniformType var,
 									int textureSlot, int & texunit, const QString & alternate,
 									TextureClampMode clamp, const QString & forced )
@@ -601,17 +733,13 @@ static QString default_n = "shaders/default_n.dds";
 static QString default_ns = "shaders/default_ns.dds";
 static QString cube = "shaders/cubemap.dds";
 
-bool Renderer::setupProgram( Program * prog, Shape * mesh, const PropertyList & props,
-							 const QVector<QModelIndex> & iBlocks, bool eval )
+bool Renderer::setupProgram( Program * prog, Shape * mesh, const PropertyList & props )
 {
 	auto nif = NifModel::fromValidIndex( mesh->index() );
 	if ( !nif )
 		return false;
 
-	if ( eval && !prog->conditions.eval( nif, iBlocks ) )
-		return false;
-
-	fn->glUseProgram( prog->id );
+	useProgram( prog->id );
 
 	auto nifVersion = nif->getBSVersion();
 	auto scene = mesh->scene;
@@ -931,6 +1059,12 @@ bool Renderer::setupProgram( Program * prog, Shape * mesh, const PropertyList &
 		prog->uni2f( UV_OFFSET, 0.0, 0.0 );
 	}
 
+	// Bone palette for skinning in the vertex shader
+	prog->uni1i( SKINNED, mesh->gpuSkinning );
+	prog->uni1i( GPU_SKINNED, mesh->gpuSkinning );
+	if ( mesh->gpuSkinning )
+		prog->uni4mv( GPU_BONES, mesh->gpuSkinMatrices );
+
 	QMapIterator<int, Program::CoordType> itx( prog->texcoords );
 
 	while ( itx.hasNext() ) {
@@ -943,21 +1077,30 @@ bool Renderer::setupProgram( Program * prog, Shape * mesh, const PropertyList &
 		if ( it == Program::CT_TANGENT ) {
 			if ( mesh->transTangents.count() ) {
 				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-				glTexCoordPointer( 3, GL_FLOAT, 0, mesh->transTangents.constData() );
+				mesh->tangentBuffer.texCoordPointer( fn, mesh->transTangents );
 			} else if ( mesh->tangents.count() ) {
 				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-				glTexCoordPointer( 3, GL_FLOAT, 0, mesh->tangents.constData() );
+				mesh->tangentBuffer.texCoordPointer( fn, mesh->tangents );
 			} else {
 				return false;
 			}
 
+		} else if ( it == Program::CT_BONE || it == Program::CT_WEIGHT ) {
+			// Only read by the vertex shader when it blends the bones
+			if ( mesh->gpuSkinning ) {
+				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+				if ( it == Program::CT_BONE )
+					mesh->gpuSkinBoneBuffer.texCoordPointer( fn, mesh->gpuSkinBones );
+				else
+					mesh->gpuSkinWeightBuffer.texCoordPointer( fn, mesh->gpuSkinWeights );
+			}
 		} else if ( it == Program::CT_BITANGENT ) {
 			if ( mesh->transBitangents.count() ) {
 				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-				glTexCoordPointer( 3, GL_FLOAT, 0, mesh->transBitangents.constData() );
+				mesh->bitangentBuffer.texCoordPointer( fn, mesh->transBitangents );
 			} else if ( mesh->bitangents.count() ) {
 				glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-				glTexCoordPointer( 3, GL_FLOAT, 0, mesh->bitangents.constData() );
+				mesh->bitangentBuffer.texCoordPointer( fn, mesh->bitangents );
 			} else {
 				return false;
 			}
@@ -972,7 +1115,7 @@ bool Renderer::setupProgram( Program * prog, Shape * mesh, const PropertyList &
 				return false;
 
 			glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-			glTexCoordPointer( 2, GL_FLOAT, 0, mesh->coords[set].constData() );
+			mesh->coordBuffer( set )->texCoordPointer( fn, mesh->coords[set] );
 		} else if ( bsprop ) {
 			int txid = it;
 			if ( txid < 0 )
@@ -984,7 +1127,7 @@ bool Renderer::setupProgram( Program * prog, Shape * mesh, const PropertyList &
 				return false;
 
 			glEnableClientState( GL_TEXTURE_COORD_ARRAY );
-			glTexCoordPointer( 2, GL_FLOAT, 0, mesh->coords[set].constData() );
+			mesh->coordBuffer( set )->texCoordPointer( fn, mesh->coords[set] );
 		}
 	}
 
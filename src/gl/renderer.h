@@ -44,6 +44,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <array>
 #include <string>
+#include <tuple>
 
 
 //! @file renderer.h Renderer, Renderer::ConditionSingle, Renderer::ConditionGroup, Renderer::Shader, Renderer::Program
@@ -82,10 +83,37 @@ public:
 	//! Context Functions
 	QOpenGLFunctions * fn;
 
-	//! Set up shader program
-	QString setupProgram( Shape *, const QString & hint = {} );
+	//! Set up shader program, reusing the program selected for the shape until its blocks change
+	QString setupProgram( Shape * );
 	//! Stop shader program
 	void stopProgram();
+	//! Stop shader program after drawing a shape; in a batch the program is kept for the next shape
+	void releaseProgram();
+	//! Bind a shader program, unless it is bound already
+	void useProgram( GLuint id );
+	//! Start drawing shapes sorted by their state, see releaseProgram()
+	void beginBatch();
+	//! Stop drawing a batch of shapes, unbinding the program
+	void endBatch();
+	//! Whether the program selected for the shape can blend its bones in the vertex shader
+	bool canSkin( const Shape * ) const;
+
+	//! The state a shape is drawn with, to group shapes sharing programs, textures and materials
+	struct StateKey
+	{
+		int program = -1;
+		GLuint texture = 0;
+		quintptr textures = 0;
+		quintptr material = 0;
+
+		bool operator<( const StateKey & other ) const
+		{
+			return std::tie( program, texture, textures, material )
+				< std::tie( other.program, other.texture, other.textures, other.material );
+		}
+	};
+
+	StateKey stateKey( Shape * ) const;
 
 	typedef enum
 	{
@@ -174,7 +202,7 @@ public:
 		Condition() {}
 		virtual ~Condition() {}
 
-		virtual bool eval( const NifModel * nif, const QVector<QModelIndex> & iBlocks ) const = 0;
+		virtual bool eval( const NifModel * nif, const QVector<const NifItem *> & blocks ) const = 0;
 	};
 
 	//! Condition class for single conditions
@@ -183,10 +211,22 @@ public:
 public:
 		ConditionSingle( const QString & line, bool neg = false );
 
-		bool eval( const NifModel * nif, const QVector<QModelIndex> & iBlocks ) const override final;
+		bool eval( const NifModel * nif, const QVector<const NifItem *> & blocks ) const override final;
 
 protected:
-		QString left, right;
+		//! Whether the left side refers to the file header instead of a block
+		bool header = false;
+		//! Block type the left side refers to
+		QString blockType;
+		//! Field path of the left side, split once when the program is loaded
+		QStringList fieldPath;
+
+		QString right;
+		//! Right side converted for the numeric comparisons
+		quint64 rightCount = 0;
+		float rightFloat = 0;
+		uint rightUInt = 0;
+
 		enum Type
 		{
 			NONE, EQ, NE, LE, GE, LT, GT, AND, NAND
@@ -196,7 +236,7 @@ protected:
 
 		bool invert;
 
-		QModelIndex getIndex( const NifModel * nif, const QVector<QModelIndex> & iBlock, QString name ) const;
+		const NifItem * getItem( const NifModel * nif, const QVector<const NifItem *> & blocks ) const;
 		template <typename T> bool compare( T a, T b ) const;
 	};
 
@@ -207,7 +247,7 @@ public:
 		ConditionGroup( bool o = false ) { _or = o; }
 		~ConditionGroup() { qDeleteAll( conditions ); }
 
-		bool eval( const NifModel * nif, const QVector<QModelIndex> & iBlocks ) const override final;
+		bool eval( const NifModel * nif, const QVector<const NifItem *> & blocks ) const override final;
 
 		void addCondition( Condition * c );
 
@@ -271,6 +311,8 @@ public:
 
 		ConditionGroup conditions;
 		QMap<int, CoordType> texcoords;
+		//! Whether the vertex shader blends the bones of skinned shapes, see setUniformLocations
+		bool skinning = false;
 
 		std::array<std::string, NUM_UNIFORM_TYPES> uniforms = { {
 			"BaseMap",
@@ -354,20 +396,32 @@ public:
 		void uni1i( UniformType var, int val );
 		void uni3m( UniformType var, const Matrix & val );
 		void uni4m( UniformType var, const Matrix4 & val );
+		void uni4mv( UniformType var, const QVector<Matrix4> & val );
 		void uniSampler( BSShaderProperty * bsprop, UniformType var, int textureSlot,
 						 int & texunit, const QString & alternate, TextureClampMode clamp, const QString & forced = {} );
 		void uniSamplerBlank( UniformType var, int & texunit );
 	};
 
 	QMap<QString, Shader *> shaders;
-	QMap<QString, Program *> programs;
-
-	bool setupProgram( Program *, Shape *, const PropertyList &, const QVector<QModelIndex> & iBlocks, bool eval = true );
+	//! Programs in the order their conditions are evaluated, sorted by name
+	QVector<Program *> programs;
+	//! Bumped whenever the programs are reloaded, invalidating the selections cached in the shapes
+	int programsRevision = 1;
+
+	//! The program bound by useProgram()
+	GLuint currentProgram = 0;
+	//! Is a batch of shapes being drawn?
+	bool batching = false;
+
+	//! The first program from index first on whose conditions match the shape, or -1
+	int selectProgram( const NifModel * nif, Shape *, const PropertyList &, int first = 0 ) const;
+	bool setupProgram( Program *, Shape *, const PropertyList & );
 	void setupFixedFunction( Shape *, const PropertyList & );
 
 	struct Settings
 	{
 		bool useShaders = true;
+		bool gpuSkinning = true;
 	} cfg;
 };
 
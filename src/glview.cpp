@@ -177,6 +177,7 @@ GLView::GLView( const QGLFormat & format, QWidget * p, const QGLWidget * shareWi
 
 	doCenter  = false;
 	doCompile = false;
+	doRelink  = false;
 
 	model = nullptr;
 
@@ -184,6 +185,7 @@ GLView::GLView( const QGLFormat & format, QWidget * p, const QGLWidget * shareWi
 	lastTime = QTime::currentTime();
 
 	textures = new TexCache( this );
+	textures->setBackgroundLoading( true );
 
 	updateSettings();
 
@@ -433,6 +435,14 @@ void GLView::paintGL()
 		emit sceneTimeChanged( time, tMin, tMax );
 		doCompile = false;
 		doLoadReset = false;
+		doRelink = false;
+
+	} else if ( doRelink ) {
+		// Only the nodes of removed blocks are deleted and only those of new blocks created, the textures are kept
+		scene->update( model, QModelIndex() );
+		// The controllers of new blocks join the current sequence
+		scene->setSequence( scene->animGroup );
+		doRelink = false;
 	}
 
 	// Center the model
@@ -1089,8 +1099,10 @@ GLView::ViewState GLView::getDefaultViewMode()
 		default:    modeAxes = modeAxesZ; break;
 		}
 
-		for ( auto shape : scene->shapes )
-			shape->fillViewModeWeights( modeWeights, hasSkinnedShapes, modeAxes );
+		for ( auto shape : scene->shapes ) {
+			if ( shape )
+				shape->fillViewModeWeights( modeWeights, hasSkinnedShapes, modeAxes );
+		}
 
 		if ( !hasSkinnedShapes ) {
 			modeWeights[defaultMode] *= 16.0; // Inflate the weight of the default mode
@@ -1189,9 +1201,28 @@ void GLView::dataChanged( const QModelIndex & idx, const QModelIndex & xdi )
 	if ( ix.isValid() ) {
 		scene->update( model, idx );
 		update();
-	} else {
-		modelChanged();
+		return;
+	}
+
+	if ( !idx.isValid() && !xdi.isValid() ) {
+		// Batch edits (e.g. from spells) do not say what they changed
+		modelLinked();
+		return;
+	}
+
+	QModelIndex iFirst = model->getBlockIndex( idx );
+	QModelIndex iLast = model->getBlockIndex( xdi );
+	if ( iFirst.isValid() && iLast.isValid() ) {
+		// The range spans several blocks, update just those
+		int last = model->getBlockNumber( iLast );
+		for ( int b = model->getBlockNumber( iFirst ); b <= last; b++ )
+			scene->update( model, model->getBlockIndex( b ) );
+		update();
+		return;
 	}
+
+	// Changes to the header may change the version or the game, so the scene is made again
+	modelChanged();
 }
 
 void GLView::modelChanged()
@@ -1210,7 +1241,7 @@ void GLView::modelLinked()
 	if ( doCompile )
 		return;
 
-	doCompile = true; //scene->update( model, QModelIndex() );
+	doRelink = true;
 	update();
 }
 
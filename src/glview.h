@@ -270,6 +270,8 @@ private:
 	bool doCompile;
 	bool doLoadReset;
 	bool doCenter;
+	//! Patch the scene after link changes, instead of compiling it again
+	bool doRelink;
 
 	QTimer * lightVisTimer;
 	int lightVisTimeout;
@@ -0,0 +1,152 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+#include "nifloader.h"
+
+#include "gl/gltex.h"
+#include "model/nifmodel.h"
+
+#include <QBuffer>
+#include <QFileInfo>
+#include <QReadLocker>
+
+#include <algorithm>
+
+
+//! @file nifloader.cpp NifLoader
+
+//! Texture fields read ahead by NifLoader, by block type
+static const QList<QPair<QString, QString>> prefetchFields = {
+	{ "BSShaderTextureSet", "Textures" },
+	{ "BSShaderNoLightingProperty", "File Name" },
+	{ "BSEffectShaderProperty", "Source Texture" },
+	{ "BSEffectShaderProperty", "Greyscale Texture" },
+	{ "BSEffectShaderProperty", "Env Map Texture" },
+	{ "BSEffectShaderProperty", "Normal Texture" },
+	{ "BSEffectShaderProperty", "Env Mask Texture" },
+	{ "NiSourceTexture", "File Name" },
+};
+
+NifLoader::NifLoader( const QString & filepath, QObject * parent )
+	: NifLoader( QByteArray(), filepath, parent )
+{
+}
+
+NifLoader::NifLoader( const QByteArray & data, const QString & filepath, QObject * parent )
+	: QThread( parent ), nif( new NifModel( nullptr, BaseModel::MSG_DEFERRED ) ), filepath( filepath ), data( data )
+{
+	// Pass on at most one progress update per percent
+	connect( nif.get(), &NifModel::sigProgress, this, [this]( int c, int m ) {
+		int step = std::max( m / 100, 1 );
+		if ( c == 0 || c == m || c - lastProgress >= step ) {
+			lastProgress = c;
+			emit sigProgress( c, m );
+		}
+	}, Qt::DirectConnection );
+}
+
+NifLoader::~NifLoader()
+{
+	cancel();
+	wait();
+}
+
+void NifLoader::cancel()
+{
+	cancelled = true;
+	nif->cancelLoading();
+}
+
+void NifLoader::run()
+{
+	QStringList textures;
+	bool loaded = false;
+
+	{
+		QReadLocker lck( &NifModel::XMLlock );
+
+		if ( !cancelled ) {
+			if ( data.isNull() ) {
+				loaded = nif->loadFromFile( filepath );
+			} else {
+				QBuffer buf( &data );
+				loaded = buf.open( QIODevice::ReadOnly ) && nif->load( buf );
+			}
+		}
+
+		if ( loaded && !cancelled ) {
+			game = Game::GameManager::get_game( nif->getVersionNumber(), nif->getUserVersion(), nif->getBSVersion() );
+			textures = texturePaths();
+		}
+	}
+
+	// The model belongs to the receiver from here on
+	emit sigLoaded( loaded && !cancelled );
+
+	QString folder = QFileInfo( filepath ).absolutePath();
+	for ( const QString & tex : textures ) {
+		if ( cancelled )
+			break;
+
+		TexCache::prefetch( tex, folder, game );
+	}
+}
+
+QStringList NifLoader::texturePaths() const
+{
+	QStringList paths;
+
+	for ( int b = 0; b < nif->getBlockCount(); b++ ) {
+		for ( const auto & field : prefetchFields ) {
+			auto iBlock = nif->getBlockIndex( b, field.first );
+			if ( !iBlock.isValid() )
+				continue;
+
+			auto iPath = nif->getIndex( iBlock, field.second );
+			if ( !iPath.isValid() )
+				continue;
+
+			QStringList blockPaths;
+			if ( nif->isArray( iPath ) )
+				blockPaths << nif->getArray<QString>( iPath ).toList();
+			else
+				blockPaths << nif->get<QString>( iPath );
+
+			for ( const QString & path : blockPaths ) {
+				if ( !path.isEmpty() && !paths.contains( path, Qt::CaseInsensitive ) )
+					paths << path;
+			}
+		}
+	}
+
+	return paths;
+}
@@ -0,0 +1,100 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+notice, this list of conditions and the following disclaimer in the
+documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+#ifndef NIFLOADER_H
+#define NIFLOADER_H
+
+#include "gamemanager.h"
+
+#include <QThread> // Inherited
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <memory>
+
+
+//! @file nifloader.h NifLoader
+
+class NifModel;
+
+/*! Reads a NIF file into a detached NifModel on a worker thread.
+ *
+ * The model shown by the window is left alone while the file is parsed, so the UI
+ * stays responsive. Once sigLoaded() arrives the result is moved over with
+ * NifModel::takeContents(). The thread then goes on to read the textures referenced
+ * by the file, which overlaps the archive reads with building the scene.
+ */
+class NifLoader final : public QThread
+{
+	Q_OBJECT
+
+public:
+	//! Load a file from disk
+	NifLoader( const QString & filepath, QObject * parent = nullptr );
+	//! Load a file held in memory, e.g. extracted from an archive
+	NifLoader( const QByteArray & data, const QString & filepath, QObject * parent = nullptr );
+	~NifLoader();
+
+	//! The detached model, only to be used after sigLoaded()
+	NifModel * model() const { return nif.get(); }
+	const QString & path() const { return filepath; }
+
+	//! Stop loading or prefetching as soon as possible
+	void cancel();
+	bool isCancelled() const { return cancelled; }
+
+signals:
+	void sigProgress( int, int );
+	//! Parsing has finished; texture prefetching may still be running
+	void sigLoaded( bool success );
+
+protected:
+	void run() override final;
+
+	//! Collect the texture paths of the loaded file
+	QStringList texturePaths() const;
+
+	std::unique_ptr<NifModel> nif;
+	QString filepath;
+	QByteArray data;
+
+	//! The game the textures are looked up for
+	Game::GameMode game = Game::OTHER;
+	//! Last progress value passed on, to throttle cross-thread signals
+	int lastProgress = -1;
+
+	std::atomic<bool> cancelled{ false };
+};
+
+#endif
@@ -5,6 +5,7 @@
 #include <QMap>
 #include <QCloseEvent>
 #include <QScreen>
+#include <QThread>
 #include <QTimer>
 
 #include "ui/UiUtils.h"
@@ -27,9 +28,56 @@ Message::~Message()
 
 }
 
+//! The innermost MessageCapture of each thread
+static thread_local MessageCapture * currentCapture = nullptr;
+
+MessageCapture::MessageCapture() : previous( currentCapture )
+{
+	currentCapture = this;
+}
+
+MessageCapture::~MessageCapture()
+{
+	currentCapture = previous;
+}
+
+QStringList MessageCapture::takeMessages()
+{
+	QStringList lst = messages;
+	messages.clear();
+	return lst;
+}
+
+bool MessageCapture::capture( const QString & str, const QString & err )
+{
+	if ( !currentCapture )
+		return false;
+
+	if ( err.isEmpty() )
+		currentCapture->messages.append( str );
+	else
+		currentCapture->messages.append( str + ( str.endsWith( ':' ) ? " " : ": " ) + err );
+
+	return true;
+}
+
+//! Whether a message box can be created on this thread
+static bool isGuiThread()
+{
+	return qApp && QThread::currentThread() == qApp->thread();
+}
+
 //! Static helper for message box without detail text
 void Message::message( QWidget * parent, const QString & str, QMessageBox::Icon icon )
 {
+	if ( MessageCapture::capture( str ) )
+		return;
+
+	if ( !isGuiThread() ) {
+		QMetaObject::invokeMethod( qApp, [str, icon]() { message( nullptr, str, icon ); }, Qt::QueuedConnection );
+		return;
+	}
+
 	auto msgBox = new QMessageBox( parent );
 	msgBox->setAttribute( Qt::WA_DeleteOnClose );
 	UIUtils::setWindowTitle( msgBox );
@@ -43,6 +91,14 @@ void Message::message( QWidget * parent, const QString & str, QMessageBox::Icon
 //! Static helper for message box with detail text
 void Message::message( QWidget * parent, const QString & str, const QString & err, QMessageBox::Icon icon )
 {
+	if ( MessageCapture::capture( str, err ) )
+		return;
+
+	if ( !isGuiThread() ) {
+		QMetaObject::invokeMethod( qApp, [str, err, icon]() { message( nullptr, str, err, icon ); }, Qt::QueuedConnection );
+		return;
+	}
+
 	if ( !parent )
 		parent = qApp->activeWindow();
 
@@ -70,6 +126,10 @@ void Message::message( QWidget * parent, const QString & str, const QMessageLogC
 	}
 #endif
 
+	// The details below are for the message box only
+	if ( MessageCapture::capture( str ) )
+		return;
+
 	QString d;
 	d.append( QString( "%1: %2\n" ).arg( "File" ).arg( context->file ) );
 	d.append( QString( "%1: %2\n" ).arg( "Function" ).arg( context->function ) );
@@ -202,6 +262,14 @@ void unregisterMessageBox( DetailsMessageBox * msgBox )
 
 void Message::append( QWidget * parent, const QString & str, const QString & err, QMessageBox::Icon icon )
 {
+	if ( MessageCapture::capture( str, err ) )
+		return;
+
+	if ( !isGuiThread() ) {
+		QMetaObject::invokeMethod( qApp, [str, err, icon]() { append( nullptr, str, err, icon ); }, Qt::QueuedConnection );
+		return;
+	}
+
 	if ( !parent )
 		parent = qApp->activeWindow();
 
@@ -5,6 +5,7 @@
 #include <QMessageBox>
 #include <QMetaType>
 #include <QString>
+#include <QStringList>
 
 Q_DECLARE_LOGGING_CATEGORY( ns )
 Q_DECLARE_LOGGING_CATEGORY( nsGl )
@@ -39,6 +40,30 @@ public:
 	static void info( QWidget *, const QString &, const QString & );
 };
 
+/*! Collects the messages shown on the current thread as text while it exists, instead of showing them.
+ *
+ * Message boxes may only be created on the GUI thread. Worker threads use a capture to
+ * turn the warnings and errors of the code they run into a report; messages from other
+ * threads without one are passed on to the GUI thread.
+ */
+class MessageCapture final
+{
+public:
+	MessageCapture();
+	~MessageCapture();
+
+	//! Returns the messages captured so far and clears them
+	QStringList takeMessages();
+
+	//! Captures a message if the current thread has a capture; returns false otherwise
+	static bool capture( const QString & str, const QString & err = QString() );
+
+protected:
+	QStringList messages;
+	//! The capture this one replaced on the same thread
+	MessageCapture * previous;
+};
+
 class TestMessage
 {
 public:
@@ -69,6 +69,8 @@ void BaseModel::logMessage( const QString & message, const QString & details, QM
 {
 	if ( msgMode == MSG_USER ) {
 		Message::append( nullptr, message, details, lvl );
+	} else if ( msgMode == MSG_DEFERRED ) {
+		deferredMessages.append( { message, details, lvl } );
 	} else {
 		testMsg( details );
 	}
@@ -129,6 +131,14 @@ QList<TestMessage> BaseModel::getMessages() const
 	return lst;
 }
 
+void BaseModel::relayMessages( const BaseModel * src ) const
+{
+	for ( const DeferredMessage & m : src->deferredMessages )
+		logMessage( m.message, m.details, m.lvl );
+
+	src->deferredMessages.clear();
+}
+
 /*
  *  array functions
  */
@@ -842,6 +852,8 @@ void BaseModel::reportError( const QString & err ) const
 {
 	if ( msgMode == MSG_USER )
 		Message::append(getWindow(), "Parsing warnings:", err);
+	else if ( msgMode == MSG_DEFERRED )
+		deferredMessages.append( { "Parsing warnings:", err, QMessageBox::Warning } );
 	else
 		testMsg(err);
 }
@@ -79,7 +79,9 @@ class BaseModel : public QAbstractItemModel
 public:
 	enum MsgMode
 	{
-		MSG_USER, MSG_TEST
+		MSG_USER, MSG_TEST,
+		//! Keep the user messages for another model to report, see relayMessages()
+		MSG_DEFERRED
 	};
 
 	BaseModel( QObject * parent, MsgMode msgMode );
@@ -203,6 +205,8 @@ public:
 
 	//! Get Messages collected
 	QList<TestMessage> getMessages() const;
+	//! Report the user messages kept by a model in MSG_DEFERRED mode through this model (also clears them)
+	void relayMessages( const BaseModel * src ) const;
 
 	//! Column names
 	enum
@@ -585,6 +589,16 @@ protected:
 	//! Handle a test message
 	void testMsg( const QString & m ) const;
 
+	//! A user message kept in MSG_DEFERRED mode
+	struct DeferredMessage
+	{
+		QString message;
+		QString details;
+		QMessageBox::Icon lvl;
+	};
+	//! The user messages kept in MSG_DEFERRED mode
+	mutable QList<DeferredMessage> deferredMessages;
+
 	MsgMode msgMode;
 
 	//! The model's state
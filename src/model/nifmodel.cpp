@@ -1654,6 +1654,30 @@ void NifModel::reset()
 	endResetModel();
 }
 
+void NifModel::takeContents( NifModel * src )
+{
+	beginResetModel();
+
+	std::swap( root, src->root );
+	root->setModel( this );
+	src->root->setModel( src );
+
+	version = src->version;
+	bsVersion = src->bsVersion;
+	childLinks = src->childLinks;
+	parentLinks = src->parentLinks;
+	rootLinks = src->rootLinks;
+
+	fileinfo = src->fileinfo;
+	filename = src->filename;
+	folder = src->folder;
+
+	resetState();
+	endResetModel();
+
+	relayMessages( src );
+}
+
 bool NifModel::removeRows( int iStart, int count, const QModelIndex & parent )
 {
 	NifItem * item = getItem( parent );
@@ -1827,6 +1851,9 @@ bool NifModel::load( QIODevice & device )
 			for ( int c = 0; c < numblocks; c++ ) {
 				emit sigProgress( c + 1, numblocks );
 
+				if ( loadCancelled )
+					throw tr( "loading cancelled" );
+
 				if ( device.atEnd() )
 					throw tr( "unexpected EOF during load" );
 
@@ -1955,6 +1982,9 @@ bool NifModel::load( QIODevice & device )
 				for ( qint32 c = 0; true; c++ ) {
 					emit sigProgress( c + 1, 0 );
 
+					if ( loadCancelled )
+						throw tr( "loading cancelled" );
+
 					if ( device.atEnd() )
 						throw tr( "unexpected EOF during load" );
 
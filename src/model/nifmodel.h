@@ -40,6 +40,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QStack>
 #include <QStringList>
 
+#include <atomic>
 #include <memory>
 
 class SpellBook;
@@ -111,6 +112,15 @@ public:
 	//! Resets the model to its original state in any attached views.
 	void reset();
 
+	/*! Replace the contents of this model with those of another one.
+	 *
+	 * Used to swap in a file read by a detached model on a worker thread (see NifLoader).
+	 * The messages collected by the source model are reported through this model.
+	 */
+	void takeContents( NifModel * src );
+	//! Abort load() at the next block; safe to call from any thread. The model stays cancelled.
+	void cancelLoading() { loadCancelled = true; }
+
 	//! Invalidate only the conditions of the items dependent on this item
 	void invalidateDependentConditions( NifItem * item );
 	//! Reset all cached conditions of the header
@@ -756,6 +766,9 @@ protected:
 	quint32 bsVersion;
 	void cacheBSVersion( const NifItem * headerItem );
 
+	//! Set by cancelLoading()
+	std::atomic<bool> loadCancelled{ false };
+
 	QString topItemRepr( const NifItem * item ) const override final;
 	void onItemValueChange( NifItem * item ) override final;
 
@@ -35,6 +35,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "glview.h"
 #include "message.h"
+#include "io/nifloader.h"
 #include "spellbook.h"
 #include "gl/glscene.h"
 #include "model/kfmmodel.h"
@@ -50,7 +51,6 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <QAction>
 #include <QApplication>
-#include <QBuffer>
 #include <QByteArray>
 #include <QCloseEvent>
 #include <QDebug>
@@ -62,6 +62,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QProgressBar>
 #include <QSettings>
 #include <QTimer>
+#include <QToolButton>
 #include <QTranslator>
 #include <QUrl>
 #include <QCryptographicHash>
@@ -268,6 +269,13 @@ NifSkope::NifSkope()
 	progress->setMaximumSize( 200, 18 );
 	progress->setVisible( false );
 
+	cancelLoad = new QToolButton( ui->statusbar );
+	cancelLoad->setText( tr( "Cancel" ) );
+	cancelLoad->setToolTip( tr( "Stop loading the file" ) );
+	cancelLoad->setAutoRaise( true );
+	cancelLoad->setVisible( false );
+	connect( cancelLoad, &QToolButton::clicked, this, &NifSkope::cancelLoading );
+
 	// Process progress events
 	connect( nif, &NifModel::sigProgress, [this]( int c, int m ) {
 		progress->setRange( 0, m );
@@ -803,9 +811,6 @@ void NifSkope::openArchive( const QString & archive )
 
 		setCurrentArchive( bsa );
 
-		// Models
-		bsaModel->init();
-
 		// Populate model from BSA
 		bsa->fillModel( bsaModel, "meshes" );
 
@@ -884,30 +889,9 @@ void NifSkope::openArchiveFileString( BSA * bsa, const QString & filepath )
 		// Format like "BSANAME.BSA/path/to/file.nif"
 		QString path = bsa->name() + "/" + filepath;
 
-		QBuffer buf;
-		buf.setData( data );
-		if ( buf.open( QBuffer::ReadOnly ) ) {
-
-			emit beginLoading();
-
-			bool loaded = nif->load( buf );
-			if ( loaded )
-				setCurrentFile( path );
-
-			emit completeLoading( loaded, path );
+		emit beginLoading();
 
-			//if ( loaded ) {
-			//	QCryptographicHash hash( QCryptographicHash::Md5 );
-			//	hash.addData( data );
-			//	filehash = hash.result();
-			//
-			//	QFileInfo f( path );
-			//	
-			//	checkFile( f, filehash );
-			//}
-
-			buf.close();
-		}
+		startLoading( new NifLoader( data, path, this ) );
 	}
 }
 
@@ -968,14 +952,13 @@ void NifSkope::saveFile( const QString & filename )
 
 void NifSkope::loadFile( const QString & filename )
 {
-	QApplication::setOverrideCursor( Qt::WaitCursor );
-
-	setCurrentFile( filename );
+	loadingFile = filename;
 	QTimer::singleShot( 0, this, SLOT( load() ) );
 }
 
 void NifSkope::reload()
 {
+	loadingFile = currentFile;
 	QTimer::singleShot( 0, this, SLOT( load() ) );
 }
 
@@ -983,7 +966,7 @@ void NifSkope::load()
 {
 	emit beginLoading();
 
-	QFileInfo f( QDir::fromNativeSeparators( currentFile ) );
+	QFileInfo f( QDir::fromNativeSeparators( loadingFile ) );
 	f.makeAbsolute();
 
 	QString fname = f.filePath();
@@ -991,6 +974,8 @@ void NifSkope::load()
 	// TODO: This is rather poor in terms of file validation
 
 	if ( f.suffix().compare( "kfm", Qt::CaseInsensitive ) == 0 ) {
+		setCurrentFile( loadingFile );
+		detachViews();
 		emit completeLoading( kfm->loadFromFile( fname ), fname );
 
 		f.setFile( kfm->getFolder(), kfm->get<QString>( kfm->getKFMroot(), "NIF File Name" ) );
@@ -998,19 +983,74 @@ void NifSkope::load()
 		return;
 	}
 
-	bool loaded = nif->loadFromFile( fname );
+	startLoading( new NifLoader( fname, this ) );
+}
+
+void NifSkope::startLoading( NifLoader * l )
+{
+	// A superseded loader finishes in the background and is ignored
+	if ( loader )
+		loader->cancel();
+
+	loader = l;
+
+	connect( l, &NifLoader::sigProgress, this, [this]( int c, int m ) {
+		progress->setRange( 0, m );
+		progress->setValue( c );
+	} );
+
+	connect( l, &NifLoader::sigLoaded, this, [this, l]( bool loaded ) {
+		if ( l != loader )
+			return;
+
+		loader = nullptr;
+		cancelLoad->setVisible( false );
+
+		QString fname = l->path();
+
+		detachViews();
+		nif->takeContents( l->model() );
+
+		// Until now the previous file stayed current, as its model was still open
+		if ( loaded )
+			setCurrentFile( fname );
+		else
+			currentFile = QDir::fromNativeSeparators( fname ); // Dropped from the recent files by onLoadComplete()
+
+		emit completeLoading( loaded, fname );
+	} );
+
+	connect( l, &QThread::finished, l, &QObject::deleteLater );
+
+	// Saving now would write the open model, which is about to be replaced
+	ui->aSaveMenu->setEnabled( false );
+	ui->aSave->setEnabled( false );
+	ui->aSaveAs->setEnabled( false );
 
-	emit completeLoading( loaded, fname );
+	cancelLoad->setVisible( true );
+	l->start();
+}
+
+void NifSkope::cancelLoading()
+{
+	if ( !loader )
+		return;
+
+	loader->cancel();
+	loader = nullptr;
 
-	//if ( loaded ) {
-	//	filehash = fileChecksum( fname, QCryptographicHash::Md5 );
-	//
-	//	checkFile( f, filehash );
-	//}
+	cancelLoad->setVisible( false );
+	progress->setVisible( false );
+
+	// The previous file is still open
+	updateFileMenus();
 }
 
 void NifSkope::save()
 {
+	if ( loader )
+		return;
+
 	// Assure file path is absolute
 	// If not absolute, it is loaded from a BSA
 	QFileInfo curFile( currentFile );
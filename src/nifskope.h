@@ -62,6 +62,7 @@ class GLView;
 class GLGraphicsView;
 class InspectView;
 class KfmModel;
+class NifLoader;
 class NifModel;
 class NifProxyModel;
 class NifTreeView;
@@ -80,6 +81,7 @@ class QGraphicsScene;
 class QProgressBar;
 class QStringList;
 class QTimer;
+class QToolButton;
 class QTreeView;
 class QUdpSocket;
 class QSlider;
@@ -193,6 +195,9 @@ public slots:
 	//! A slot for starting the XML checker.
 	void on_aShredder_triggered();
 
+	//! A slot for starting the batch texture conversion.
+	void on_aTextureBatch_triggered();
+
 	//! Reset "block details"
 	void on_aHeader_triggered();
 
@@ -237,6 +242,9 @@ protected slots:
 	void onLoadComplete( bool, QString & );
 	void onSaveComplete( bool, QString & );
 
+	//! Abort the file currently being loaded
+	void cancelLoading();
+
 	//! Display a context menu at the specified position
 	void contextMenu( const QPoint & pos );
 
@@ -271,6 +279,11 @@ protected:
 	bool eventFilter( QObject * o, QEvent * e ) override final;
 
 private:
+	//! Run a NifLoader, replacing any load still in progress
+	void startLoading( NifLoader * l );
+	//! Detach the views from the models while their contents are replaced
+	void detachViews();
+
 	void initActions();
 	void initDockWidgets();
 	void initToolBars();
@@ -379,6 +392,12 @@ private:
 	bool selecting = false;
 	
 	QProgressBar * progress = nullptr;
+	QToolButton * cancelLoad = nullptr;
+
+	//! The file being loaded in the background, if any
+	NifLoader * loader = nullptr;
+	//! The file read by load(), which only becomes the current file once it has loaded
+	QString loadingFile;
 
 	QDockWidget * dList;
 	QDockWidget * dTree;
@@ -46,6 +46,7 @@ THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "ui/widgets/lightingwidget.h"
 #include "ui/widgets/nifview.h"
 #include "ui/widgets/refrbrowser.h"
+#include "ui/widgets/texbatch.h"
 #include "ui/widgets/inspect.h"
 #include "ui/widgets/xmlcheck.h"
 #include "ui/about_dialog.h"
@@ -526,6 +527,7 @@ void NifSkope::initToolBars()
 	// Status Bar
 	ui->statusbar->setContentsMargins( 0, 0, 0, 0 );
 	ui->statusbar->addPermanentWidget( progress );
+	ui->statusbar->addPermanentWidget( cancelLoad );
 	
 	// TODO: Split off into own widget
 	ui->statusbar->addPermanentWidget( filePathWidget( this ) );
@@ -739,6 +741,13 @@ void NifSkope::openDlg()
 }
 
 void NifSkope::onLoadBegin()
+{
+	// NIF files are read on a worker thread, the current file stays visible until then
+	progress->setVisible( true );
+	progress->reset();
+}
+
+void NifSkope::detachViews()
 {
 	setEnabled( false );
 	ogl->setUpdatesEnabled( false );
@@ -757,15 +766,10 @@ void NifSkope::onLoadBegin()
 	animGroups->clear();
 	hideAnimToolbar();
 	setLodSliderEnabled( false );
-
-	progress->setVisible( true );
-	progress->reset();
 }
 
 void NifSkope::onLoadComplete( bool success, QString & fname )
 {
-	QApplication::restoreOverrideCursor();
-
 	int timeout = 2500;
 	if ( !success ) {
 		// File failed to load
@@ -1406,6 +1410,11 @@ void NifSkope::on_aShredder_triggered()
 	TestShredder::create();
 }
 
+void NifSkope::on_aTextureBatch_triggered()
+{
+	TextureBatch::create();
+}
+
 void NifSkope::on_aHeader_triggered()
 {
 	if ( tree )
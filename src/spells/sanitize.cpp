@@ -1,6 +1,7 @@
 #include "spellbook.h"
 #include "sanitize.h"
 #include "spells/misc.h"
+#include "gl/gltex.h"
 
 #include <QInputDialog>
 
@@ -713,6 +714,16 @@ void spErrorInvalidPaths::checkPath( NifModel * nif, const QModelIndex & idx, co
 			nif->logMessage( message(), tr( "[%1] '%2' has a filepath without a file extension." ).arg( i ).arg( name ) );
 		else if ( (invalid & P_ABSOLUTE) && path.size() > 2 && path.at( 1 ) == ':' )
 			nif->logMessage( message(), tr( "[%1] '%2' has an absolute filepath." ).arg( i ).arg( name ) );
+
+		// Only the header is read, so this stays fast for many textures
+		if ( path.endsWith( ".dds", Qt::CaseInsensitive ) ) {
+			QString filepath, format;
+			GLuint width = 0, height = 0, mipmaps = 0;
+			auto game = Game::GameManager::get_game( nif->getVersionNumber(), nif->getUserVersion(), nif->getBSVersion() );
+
+			if ( !TexCache::probe( path, nif->getFolder(), filepath, format, width, height, mipmaps, game ) && !filepath.isEmpty() )
+				nif->logMessage( message(), tr( "[%1] '%2' is not a valid DDS texture: %3" ).arg( i ).arg( name ).arg( filepath ) );
+		}
 	}
 }
 
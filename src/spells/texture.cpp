@@ -1,7 +1,9 @@
 #include "texture.h"
 
 #include "spellbook.h"
+#include "gl/bcencoder.h"
 #include "gl/gltex.h"
+#include "gl/gltexloaders.h"
 #include "spells/blocks.h"
 #include "ui/widgets/fileselect.h"
 #include "ui/widgets/nifeditors.h"
@@ -13,13 +15,25 @@
 #include <QCheckBox>
 #include <QColorDialog>
 #include <QComboBox>
+#include <QDir>
 #include <QFileDialog>
+#include <QFileInfo>
 #include <QGridLayout>
 #include <QLabel>
 #include <QListView>
+#include <QMessageBox>
+#include <QMutex>
+#include <QProgressDialog>
 #include <QPushButton>
+#include <QSaveFile>
 #include <QSettings>
 #include <QStringListModel>
+#include <QTemporaryFile>
+#include <QThread>
+
+#include <atomic>
+#include <future>
+#include <vector>
 
 
 // Brief description is deliberately not autolinked to class Spell
@@ -1040,6 +1054,406 @@ public:
 
 REGISTER_SPELL( spEmbedTexture )
 
+//! A texture exported by NiPixelData_exportTextures()
+struct TextureExport
+{
+	QPersistentModelIndex iSource;
+	QString filepath;
+	//! Decoded on the calling thread, compressed and written by a worker
+	gli::texture texture;
+	QString format;
+	QString result;
+	bool ok = false;
+	bool skipped = false;
+};
+
+//! Name of the formats written by NiPixelData_exportTextures()
+static QString textureExportFormat( gli::format format )
+{
+	switch ( format ) {
+	case gli::FORMAT_RGB_DXT1_UNORM_BLOCK8:
+	case gli::FORMAT_RGB_DXT1_SRGB_BLOCK8:
+	case gli::FORMAT_RGBA_DXT1_UNORM_BLOCK8:
+	case gli::FORMAT_RGBA_DXT1_SRGB_BLOCK8:
+		return "DXT1";
+	case gli::FORMAT_RGBA_DXT3_UNORM_BLOCK16:
+	case gli::FORMAT_RGBA_DXT3_SRGB_BLOCK16:
+		return "DXT3";
+	case gli::FORMAT_RGBA_DXT5_UNORM_BLOCK16:
+	case gli::FORMAT_RGBA_DXT5_SRGB_BLOCK16:
+		return "DXT5";
+	default:
+		return gli::is_compressed( format ) ? "compressed" : "uncompressed";
+	}
+}
+
+//! The NiPixelData of an NiSourceTexture with an embedded texture
+static QModelIndex embeddedPixelData( const NifModel * nif, const QModelIndex & iBlock )
+{
+	if ( nif->isNiBlock( iBlock, "NiSourceTexture" ) && nif->get<int>( iBlock, "Use External" ) == 0 )
+		return nif->getBlockIndex( nif->getLink( iBlock, "Pixel Data" ) );
+
+	return QModelIndex();
+}
+
+//! The DDS files the embedded textures of a model are exported to, named after the textures and unique within the model
+static QList<QPair<QPersistentModelIndex, QString>> textureExportPaths( const NifModel * nif, const QString & folder )
+{
+	QList<QPair<QPersistentModelIndex, QString>> paths;
+	QSet<QString> names;
+
+	for ( int n = 0; n < nif->getBlockCount(); n++ ) {
+		QModelIndex iSource = nif->getBlockIndex( n );
+		if ( !embeddedPixelData( nif, iSource ).isValid() )
+			continue;
+
+		QString name = QFileInfo( nif->get<QString>( iSource, "File Name" ) ).completeBaseName();
+		if ( name.isEmpty() )
+			name = QString( "texture_%1" ).arg( n );
+
+		QString unique = name;
+		for ( int i = 2; names.contains( unique.toLower() ); i++ )
+			unique = QString( "%1_%2" ).arg( name ).arg( i );
+
+		names.insert( unique.toLower() );
+		paths.append( qMakePair( QPersistentModelIndex( iSource ), QDir( folder ).filePath( unique + ".dds" ) ) );
+	}
+
+	return paths;
+}
+
+//! Create an empty file if there is none yet, so that exports to the same folder on other threads see it as taken
+static bool claimTextureFile( const QString & filepath )
+{
+	static QMutex mutex;
+	QMutexLocker lock( &mutex );
+
+	if ( QFileInfo::exists( filepath ) )
+		return false;
+
+	QFile f( filepath );
+	return f.open( QIODevice::WriteOnly );
+}
+
+//! Compress and write one texture; runs on the worker threads
+static void exportTexture( TextureExport & e, bool compress )
+{
+	if ( e.skipped )
+		return;
+
+	if ( e.texture.empty() ) {
+		if ( e.result.isEmpty() )
+			e.result = QObject::tr( "could not decode the pixel data" );
+		return;
+	}
+
+	gli::texture texture = e.texture;
+
+	if ( compress ) {
+		gli::texture2d compressed = bcCompress( texture );
+		if ( !compressed.empty() )
+			texture = compressed;
+	}
+
+	std::vector<char> data;
+	if ( !gli::save_dds( texture, data ) ) {
+		e.result = QObject::tr( "could not encode the DDS file" );
+		return;
+	}
+
+	QSaveFile f( e.filepath );
+	if ( !f.open( QIODevice::WriteOnly ) || f.write( data.data(), qint64( data.size() ) ) != qint64( data.size() ) || !f.commit() ) {
+		e.result = QObject::tr( "could not write %1" ).arg( e.filepath );
+		return;
+	}
+
+	e.ok = true;
+	e.result = QObject::tr( "%1 -> %2, %3x%4, %5 mipmaps" )
+	           .arg( e.format )
+	           .arg( textureExportFormat( texture.format() ) )
+	           .arg( texture.extent().x )
+	           .arg( texture.extent().y )
+	           .arg( texture.levels() );
+}
+
+// documented in texture.h
+int NiPixelData_exportTextures( NifModel * nif, const QString & folder, bool compress, TextureExistsPolicy exists,
+								QStringList & report, int numThreads, const std::function<void( int, int )> & progress )
+{
+	// The model is read on this thread, the workers only compress and write
+	std::vector<TextureExport> exports;
+
+	for ( const auto & path : textureExportPaths( nif, folder ) ) {
+		TextureExport e;
+		e.iSource = path.first;
+		e.filepath = path.second;
+
+		if ( exists == TEXTURE_EXISTS_RENAME ) {
+			QFileInfo file( path.second );
+			for ( int i = 2; !claimTextureFile( e.filepath ); i++ )
+				e.filepath = file.dir().filePath( QString( "%1_%2.dds" ).arg( file.completeBaseName() ).arg( i ) );
+		} else if ( exists == TEXTURE_EXISTS_SKIP && !claimTextureFile( e.filepath ) ) {
+			e.skipped = true;
+			e.result = QObject::tr( "skipped, the file already exists" );
+			exports.push_back( e );
+			continue;
+		}
+
+		try
+		{
+			texDecode( embeddedPixelData( nif, e.iSource ), e.format, e.texture );
+		}
+		catch ( QString & err )
+		{
+			e.result = err;
+		}
+
+		exports.push_back( e );
+	}
+
+	std::atomic<int> next( 0 );
+	std::atomic<int> done( 0 );
+	auto worker = [&exports, &next, &done, compress]() {
+		for ( int i = next++; i < int( exports.size() ); i = next++ ) {
+			exportTexture( exports[i], compress );
+			done++;
+		}
+	};
+
+	numThreads = std::min( numThreads, int( exports.size() ) );
+	if ( numThreads > 1 ) {
+		std::vector<std::future<void>> jobs;
+		for ( int i = 0; i < numThreads; i++ )
+			jobs.push_back( std::async( std::launch::async, worker ) );
+
+		for ( auto & job : jobs ) {
+			while ( job.wait_for( std::chrono::milliseconds( 50 ) ) != std::future_status::ready ) {
+				if ( progress )
+					progress( done, int( exports.size() ) );
+			}
+		}
+	} else {
+		worker();
+	}
+
+	// Point the sources at the files and write the report
+	int exported = 0;
+
+	for ( const TextureExport & e : exports ) {
+		if ( e.ok ) {
+			exported++;
+			nif->set<int>( e.iSource, "Use External", 1 );
+			nif->set<QString>( e.iSource, "File Name", TexCache::stripPath( e.filepath, nif->getFolder() ) );
+		} else if ( !e.skipped && exists != TEXTURE_EXISTS_OVERWRITE ) {
+			// Do not leave the claimed file behind
+			QFile f( e.filepath );
+			if ( f.size() == 0 )
+				f.remove();
+		}
+
+		report << QString( "[%1] %2: %3%4" )
+		          .arg( nif->getBlockNumber( e.iSource ) )
+		          .arg( QFileInfo( e.filepath ).fileName() )
+		          .arg( ( e.ok || e.skipped ) ? QString() : QObject::tr( "failed, " ) )
+		          .arg( e.result );
+	}
+
+	return exported;
+}
+
+// documented in texture.h
+int NiSourceTexture_embedTextures( NifModel * nif, QStringList & report )
+{
+	if ( !( nif->checkVersion( 0, 0x0A020000 ) || nif->checkVersion( 0x14000004, 0 ) ) ) {
+		report << QObject::tr( "NiPixelData cannot be embedded in version %1" ).arg( nif->getVersion() );
+		return 0;
+	}
+
+	auto game = Game::GameManager::get_game( nif->getVersionNumber(), nif->getUserVersion(), nif->getBSVersion() );
+
+	QList<QPersistentModelIndex> sources;
+	for ( int n = 0; n < nif->getBlockCount(); n++ ) {
+		QModelIndex iBlock = nif->getBlockIndex( n );
+		if ( nif->isNiBlock( iBlock, "NiSourceTexture" ) && nif->get<int>( iBlock, "Use External" ) == 1 )
+			sources.append( iBlock );
+	}
+
+	int embedded = 0;
+
+	for ( const QPersistentModelIndex & iSource : sources ) {
+		QString name = nif->get<QString>( iSource, "File Name" );
+		auto fail = [&]( const QString & reason ) {
+			report << QString( "[%1] %2: %3%4" ).arg( nif->getBlockNumber( iSource ) ).arg( name ).arg( QObject::tr( "failed, " ) ).arg( reason );
+		};
+
+		QByteArray data;
+		QString filepath = TexCache::find( name, nif->getFolder(), data, game );
+		if ( filepath.isEmpty() ) {
+			fail( QObject::tr( "texture not found" ) );
+			continue;
+		}
+
+		// texSaveNIF reads a file, textures from archives are copied to a temporary one
+		QString source = filepath;
+		QTemporaryFile tmp( QDir::temp().filePath( "nifskope_XXXXXX." + QFileInfo( filepath ).suffix() ) );
+		if ( !QFileInfo( filepath ).isFile() ) {
+			if ( data.isEmpty() || !tmp.open() || tmp.write( data ) != data.size() ) {
+				fail( QObject::tr( "could not read %1" ).arg( filepath ) );
+				continue;
+			}
+
+			tmp.close();
+			source = tmp.fileName();
+		}
+
+		int blockNum = nif->getBlockNumber( iSource );
+		nif->insertNiBlock( "NiPixelData", blockNum + 1 );
+		QModelIndex iPixelData = nif->getBlockIndex( blockNum + 1, "NiPixelData" );
+
+		bool ok = false;
+		QString err = QObject::tr( "unsupported texture format" );
+		try
+		{
+			ok = texSaveNIF( nif, source, iPixelData );
+		}
+		catch ( QString & e )
+		{
+			err = e;
+		}
+
+		if ( !ok ) {
+			nif->removeNiBlock( blockNum + 1 );
+			fail( err );
+			continue;
+		}
+
+		QString fileName = TexCache::stripPath( name, nif->getFolder() );
+		nif->set<int>( iSource, "Use External", 0 );
+		nif->set<int>( iSource, "Unknown Byte", 1 );
+		nif->setLink( iSource, "Pixel Data", blockNum + 1 );
+
+		if ( nif->checkVersion( 0x0A010000, 0 ) ) {
+			nif->set<QString>( iSource, "File Name", fileName );
+		} else {
+			nif->set<QString>( iSource, "Name", fileName );
+		}
+
+		embedded++;
+		report << QString( "[%1] %2: embedded from %3" ).arg( blockNum ).arg( name ).arg( filepath );
+	}
+
+	return embedded;
+}
+
+//! Export all embedded textures to DDS files
+class spExportAllTextures final : public Spell
+{
+public:
+	QString name() const override final { return Spell::tr( "Export All Textures" ); }
+	QString page() const override final { return Spell::tr( "Batch" ); }
+
+	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
+	{
+		if ( !nif || index.isValid() )
+			return false;
+
+		for ( int n = 0; n < nif->getBlockCount(); n++ ) {
+			if ( embeddedPixelData( nif, nif->getBlockIndex( n ) ).isValid() )
+				return true;
+		}
+
+		return false;
+	}
+
+	QModelIndex cast( NifModel * nif, const QModelIndex & ) override final
+	{
+		QString folder = QFileDialog::getExistingDirectory( qApp->activeWindow(), Spell::tr( "Export textures to" ), nif->getFolder() );
+		if ( folder.isEmpty() )
+			return QModelIndex();
+
+		int existing = 0;
+		for ( const auto & path : textureExportPaths( nif, folder ) ) {
+			if ( QFileInfo::exists( path.second ) )
+				existing++;
+		}
+
+		TextureExistsPolicy exists = TEXTURE_EXISTS_OVERWRITE;
+		if ( existing > 0 ) {
+			int answer = QMessageBox::question( qApp->activeWindow(), name(),
+			                                    Spell::tr( "%1 of the texture files already exist in %2." ).arg( existing ).arg( folder ),
+			                                    Spell::tr( "Rename" ), Spell::tr( "Overwrite" ), Spell::tr( "Skip" ), 0, -1 );
+			if ( answer < 0 )
+				return QModelIndex();
+
+			exists = ( answer == 0 ) ? TEXTURE_EXISTS_RENAME : ( answer == 1 ) ? TEXTURE_EXISTS_OVERWRITE : TEXTURE_EXISTS_SKIP;
+		}
+
+		bool compress = QMessageBox::question( qApp->activeWindow(), name(),
+		                                       Spell::tr( "Compress uncompressed textures to DXT1, or DXT5 if they have alpha?" ) ) == QMessageBox::Yes;
+
+		QProgressDialog progress( Spell::tr( "Exporting textures..." ), QString(), 0, 0, qApp->activeWindow() );
+		progress.setWindowModality( Qt::WindowModal );
+
+		QStringList report;
+		int exported = NiPixelData_exportTextures( nif, folder, compress, exists, report, QThread::idealThreadCount(),
+			[&progress]( int done, int total ) {
+				progress.setMaximum( total );
+				progress.setValue( done );
+				qApp->processEvents();
+			} );
+
+		progress.reset();
+
+		QSaveFile f( QDir( folder ).filePath( "texture_export_report.txt" ) );
+		if ( f.open( QIODevice::WriteOnly | QIODevice::Text ) ) {
+			f.write( report.join( "\n" ).toUtf8() + "\n" );
+			f.commit();
+		}
+
+		Message::append( Spell::tr( "Exported %1 of %2 textures to %3" ).arg( exported ).arg( report.count() ).arg( folder ),
+		                 report.join( "\n" ), exported == report.count() ? QMessageBox::Information : QMessageBox::Warning );
+
+		return QModelIndex();
+	}
+};
+
+REGISTER_SPELL( spExportAllTextures )
+
+//! Embed all external textures as NiPixelData
+class spEmbedAllTextures final : public Spell
+{
+public:
+	QString name() const override final { return Spell::tr( "Embed All Textures" ); }
+	QString page() const override final { return Spell::tr( "Batch" ); }
+
+	bool isApplicable( const NifModel * nif, const QModelIndex & index ) override final
+	{
+		if ( !nif || index.isValid() || !( nif->checkVersion( 0, 0x0A020000 ) || nif->checkVersion( 0x14000004, 0 ) ) )
+			return false;
+
+		for ( int n = 0; n < nif->getBlockCount(); n++ ) {
+			QModelIndex iBlock = nif->getBlockIndex( n );
+			if ( nif->isNiBlock( iBlock, "NiSourceTexture" ) && nif->get<int>( iBlock, "Use External" ) == 1 )
+				return true;
+		}
+
+		return false;
+	}
+
+	QModelIndex cast( NifModel * nif, const QModelIndex & ) override final
+	{
+		QStringList report;
+		int embedded = NiSourceTexture_embedTextures( nif, report );
+
+		Message::append( Spell::tr( "Embedded %1 of %2 textures" ).arg( embedded ).arg( report.count() ),
+		                 report.join( "\n" ), embedded == report.count() ? QMessageBox::Information : QMessageBox::Warning );
+
+		return QModelIndex();
+	}
+};
+
+REGISTER_SPELL( spEmbedAllTextures )
+
 TexFlipDialog::TexFlipDialog( NifModel * n, QModelIndex & index, QWidget * parent ) : QDialog( parent )
 {
 	nif = n;
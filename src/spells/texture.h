@@ -3,6 +3,9 @@
 
 #include <QDialog> // Inherited
 #include <QModelIndex>
+#include <QStringList>
+
+#include <functional>
 
 
 class NifFloatEdit;
@@ -47,4 +50,35 @@ protected slots:
 */
 QModelIndex NiTexturingProperty_addTexture( NifModel * nif, const QModelIndex & iTexProperty, const QModelIndex & iOldSrcTexBlock, const QString & texName );
 
+//! What to do when a texture would be exported to a file that already exists
+enum TextureExistsPolicy
+{
+	TEXTURE_EXISTS_SKIP,     //!< Keep the file, and the texture embedded
+	TEXTURE_EXISTS_RENAME,   //!< Append a number to the name of the new file
+	TEXTURE_EXISTS_OVERWRITE //!< Replace the file
+};
+
+/*! Export the embedded textures of a model to DDS files and point their NiSourceTexture blocks at the files
+* \param nif The model
+* \param folder The folder to write the files to, named after the textures
+* \param compress Whether to compress uncompressed textures to DXT1, or DXT5 if they have alpha
+* \param exists What to do with files that already exist
+* \param report Receives one line per texture
+* \param numThreads The number of threads compressing and writing; with 1 all work is done on the calling thread
+* \param progress Called on the calling thread with the textures done and the total while the threads run
+* \return The number of textures exported
+*/
+int NiPixelData_exportTextures( NifModel * nif, const QString & folder, bool compress, TextureExistsPolicy exists,
+								QStringList & report, int numThreads = 1, const std::function<void( int, int )> & progress = {} );
+
+/*! Embed the external textures of a model as NiPixelData blocks
+*
+* Textures are found like the renderer finds them, including in archives. TGA, BMP, uncompressed
+* or DXT1/DXT5 DDS and texture NIF files can be embedded.
+* \param nif The model
+* \param report Receives one line per texture
+* \return The number of textures embedded
+*/
+int NiSourceTexture_embedTextures( NifModel * nif, QStringList & report );
+
 #endif
@@ -0,0 +1,358 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+#include "texbatch.h"
+
+#include "message.h"
+#include "model/nifmodel.h"
+#include "ui/widgets/fileselect.h"
+
+#include <QCheckBox>
+#include <QCloseEvent>
+#include <QBuffer>
+#include <QComboBox>
+#include <QDir>
+#include <QFileInfo>
+#include <QLabel>
+#include <QLayout>
+#include <QMessageBox>
+#include <QProgressBar>
+#include <QPushButton>
+#include <QSaveFile>
+#include <QSettings>
+#include <QSpinBox>
+#include <QTextBrowser>
+
+
+//! @file texbatch.cpp TextureBatch, TextureBatchThread
+
+TextureBatch * TextureBatch::create()
+{
+	TextureBatch * batch = new TextureBatch();
+	batch->setAttribute( Qt::WA_DeleteOnClose );
+	batch->show();
+	return batch;
+}
+
+
+TextureBatch::TextureBatch()
+	: QWidget()
+{
+	setWindowTitle( tr( "Batch Texture Conversion" ) );
+
+	QSettings settings;
+	settings.beginGroup( "Texture Batch" );
+
+	directory = new FileSelector( FileSelector::Folder, "Dir", QBoxLayout::RightToLeft );
+	directory->setText( settings.value( "Directory" ).toString() );
+
+	recursive = new QCheckBox( tr( "Recursive" ), this );
+	recursive->setChecked( settings.value( "Recursive", true ).toBool() );
+	recursive->setToolTip( tr( "Recurse into sub directories" ) );
+
+	direction = new QComboBox( this );
+	direction->addItem( tr( "Export embedded textures to DDS" ) );
+	direction->addItem( tr( "Embed external textures" ) );
+	direction->setCurrentIndex( settings.value( "Direction", 0 ).toInt() );
+	direction->setToolTip( tr( "Exported textures are written next to each .nif" ) );
+
+	compress = new QCheckBox( tr( "Compress to DXT1/DXT5" ), this );
+	compress->setChecked( settings.value( "Compress", true ).toBool() );
+	compress->setToolTip( tr( "Compress uncompressed textures when exporting, to DXT5 if they have alpha" ) );
+
+	exists = new QComboBox( this );
+	exists->addItem( tr( "Skip existing files" ), TEXTURE_EXISTS_SKIP );
+	exists->addItem( tr( "Rename new files" ), TEXTURE_EXISTS_RENAME );
+	exists->addItem( tr( "Overwrite existing files" ), TEXTURE_EXISTS_OVERWRITE );
+	exists->setCurrentIndex( settings.value( "Existing Files", 0 ).toInt() );
+
+	connect( direction, static_cast<void (QComboBox::*)(int)>(&QComboBox::currentIndexChanged), [this]( int i ) {
+		compress->setEnabled( i == 0 );
+		exists->setEnabled( i == 0 );
+	} );
+	compress->setEnabled( direction->currentIndex() == 0 );
+	exists->setEnabled( direction->currentIndex() == 0 );
+
+	count = new QSpinBox();
+	count->setRange( 1, 16 );
+	count->setValue( settings.value( "Threads", QThread::idealThreadCount() ).toInt() );
+
+	text = new QTextBrowser();
+	text->setReadOnly( true );
+	text->setOpenExternalLinks( true );
+
+	progress = new QProgressBar( this );
+
+	label = new QLabel( this );
+	label->setHidden( true );
+
+	btRun = new QPushButton( tr( "Run" ), this );
+	btRun->setCheckable( true );
+	connect( btRun, &QPushButton::clicked, this, &TextureBatch::run );
+
+	QPushButton * btClose = new QPushButton( tr( "Close" ), this );
+	connect( btClose, &QPushButton::clicked, this, &TextureBatch::close );
+
+	QVBoxLayout * lay = new QVBoxLayout();
+	setLayout( lay );
+
+	QHBoxLayout * hbox = new QHBoxLayout();
+	lay->addLayout( hbox );
+	hbox->addWidget( directory );
+	hbox->addWidget( recursive );
+
+	lay->addLayout( hbox = new QHBoxLayout() );
+	hbox->addWidget( direction );
+	hbox->addWidget( compress );
+	hbox->addWidget( exists );
+	hbox->addWidget( new QLabel( tr( "Threads:" ) ) );
+	hbox->addWidget( count );
+
+	lay->addWidget( text );
+
+	lay->addLayout( hbox = new QHBoxLayout() );
+	hbox->addWidget( progress );
+	hbox->addWidget( label );
+
+	lay->addLayout( hbox = new QHBoxLayout() );
+	hbox->addWidget( btRun );
+	hbox->addWidget( btClose );
+
+	settings.endGroup();
+}
+
+TextureBatch::~TextureBatch()
+{
+	QSettings settings;
+	settings.beginGroup( "Texture Batch" );
+
+	settings.setValue( "Directory", directory->text() );
+	settings.setValue( "Recursive", recursive->isChecked() );
+	settings.setValue( "Direction", direction->currentIndex() );
+	settings.setValue( "Compress", compress->isChecked() );
+	settings.setValue( "Existing Files", exists->currentIndex() );
+	settings.setValue( "Threads", count->value() );
+
+	settings.endGroup();
+
+	queue.clear();
+}
+
+void TextureBatch::run()
+{
+	progress->setMaximum( progress->maximum() - queue.count() );
+	queue.clear();
+
+	if ( !btRun->isChecked() )
+		return;
+
+	for ( TextureBatchThread * thread : threads )
+		thread->wait();
+
+	QString folder = directory->text();
+	if ( folder.isEmpty() || !QDir( folder ).exists() ) {
+		btRun->setChecked( false );
+		return;
+	}
+
+	if ( QMessageBox::question( this, windowTitle(), tr( "The .nif files in %1 will be changed and saved in place. Continue?" ).arg( folder ) ) != QMessageBox::Yes ) {
+		btRun->setChecked( false );
+		return;
+	}
+
+	text->clear();
+	label->setHidden( true );
+	filesChanged = texturesConverted = texturesTotal = 0;
+
+	queue.init( folder, { "*.nif" }, recursive->isChecked() );
+
+	time = QDateTime::currentDateTime();
+
+	progress->setRange( 0, queue.count() );
+	progress->setValue( 0 );
+
+	qDeleteAll( threads );
+	threads.clear();
+
+	for ( int i = 0; i < count->value(); i++ ) {
+		TextureBatchThread * thread = new TextureBatchThread( this, &queue );
+		connect( thread, &TextureBatchThread::sigStart, this, &TextureBatch::threadStarted );
+		connect( thread, &TextureBatchThread::sigReady, text, &QTextBrowser::append );
+		connect( thread, &TextureBatchThread::sigConverted, this, &TextureBatch::onConverted );
+		connect( thread, &TextureBatchThread::finished, this, &TextureBatch::threadFinished );
+		threads.append( thread );
+
+		thread->exportTextures = ( direction->currentIndex() == 0 );
+		thread->compress = compress->isChecked();
+		thread->exists = TextureExistsPolicy( exists->currentData().toInt() );
+
+		thread->start();
+	}
+}
+
+void TextureBatch::threadStarted()
+{
+	progress->setValue( progress->maximum() - queue.count() );
+}
+
+void TextureBatch::onConverted( int converted, int total )
+{
+	if ( converted > 0 )
+		filesChanged++;
+
+	texturesConverted += converted;
+	texturesTotal += total;
+}
+
+void TextureBatch::threadFinished()
+{
+	if ( !queue.isEmpty() )
+		return;
+
+	for ( TextureBatchThread * thread : threads ) {
+		if ( thread->isRunning() )
+			return;
+	}
+
+	btRun->setChecked( false );
+	progress->setValue( progress->maximum() );
+
+	QString summary = tr( "%1 of %2 textures converted in %3 files" ).arg( texturesConverted ).arg( texturesTotal ).arg( filesChanged );
+	text->append( summary );
+
+	label->setText( tr( "%1 files in %2 seconds" ).arg( progress->maximum() ).arg( time.secsTo( QDateTime::currentDateTime() ) ) );
+	label->setVisible( true );
+
+	QSaveFile f( QDir( directory->text() ).filePath( "texture_batch_report.txt" ) );
+	if ( f.open( QIODevice::WriteOnly | QIODevice::Text ) ) {
+		f.write( text->toPlainText().toUtf8() + "\n" );
+		f.commit();
+	}
+}
+
+void TextureBatch::closeEvent( QCloseEvent * e )
+{
+	for ( TextureBatchThread * thread : threads ) {
+		if ( thread->isRunning() ) {
+			e->ignore();
+			queue.clear();
+		}
+	}
+}
+
+/*
+ *  Thread
+ */
+
+TextureBatchThread::TextureBatchThread( QObject * o, FileQueue * q )
+	: QThread( o ), queue( q )
+{
+}
+
+TextureBatchThread::~TextureBatchThread()
+{
+	if ( isRunning() ) {
+		quit.lock();
+		wait();
+		quit.unlock();
+	}
+}
+
+void TextureBatchThread::run()
+{
+	NifModel nif;
+
+	QString filepath = queue->dequeue();
+
+	while ( !filepath.isEmpty() ) {
+		emit sigStart( filepath );
+
+		QStringList report;
+		auto ready = [this, &filepath, &report]() {
+			QString result = QString( "<a href=\"nif:%1\">%1</a>" ).arg( filepath );
+			for ( const QString & line : report )
+				result += "<br>" + line.toHtmlEscaped();
+
+			emit sigReady( result );
+		};
+
+		int converted = 0;
+		int total = 0;
+
+		{
+			QReadLocker lck( &nif.XMLlock );
+
+			// No message boxes on this thread, what the loaders and savers report goes into the report
+			MessageCapture messages;
+
+			if ( !nif.loadFromFile( filepath ) ) {
+				report << tr( "failed to load" ) << messages.takeMessages();
+				ready();
+			} else {
+				if ( exportTextures )
+					converted = NiPixelData_exportTextures( &nif, QFileInfo( filepath ).absolutePath(), compress, exists, report );
+				else
+					converted = NiSourceTexture_embedTextures( &nif, report );
+
+				total = report.count();
+				report << messages.takeMessages();
+
+				// Files without textures to convert are left alone and not listed
+				if ( converted > 0 ) {
+					// Written in full or not at all, the original is replaced
+					QBuffer buf;
+					QSaveFile f( filepath );
+					bool saved = buf.open( QIODevice::WriteOnly ) && nif.save( buf )
+					             && f.open( QIODevice::WriteOnly ) && f.write( buf.data() ) == buf.size() && f.commit();
+
+					if ( !saved ) {
+						report << messages.takeMessages() << tr( "failed to save the file, it was left unchanged" );
+						converted = 0;
+					}
+				}
+
+				if ( !report.isEmpty() )
+					ready();
+			}
+		}
+
+		emit sigConverted( converted, total );
+
+		if ( quit.tryLock() )
+			quit.unlock();
+		else
+			break;
+
+		filepath = queue->dequeue();
+	}
+}
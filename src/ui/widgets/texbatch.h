@@ -0,0 +1,128 @@
+/***** BEGIN LICENSE BLOCK *****
+
+BSD License
+
+Copyright (c) 2005-2015, NIF File Format Library and Tools
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+1. Redistributions of source code must retain the above copyright
+   notice, this list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright
+   notice, this list of conditions and the following disclaimer in the
+   documentation and/or other materials provided with the distribution.
+3. The name of the NIF File Format Library and Tools project may not be
+   used to endorse or promote products derived from this software
+   without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+***** END LICENCE BLOCK *****/
+
+
+#ifndef TEXBATCH_H
+#define TEXBATCH_H
+
+#include "spells/texture.h"
+#include "ui/widgets/xmlcheck.h"
+
+#include <QThread> // Inherited
+#include <QWidget> // Inherited
+#include <QDateTime>
+#include <QMutex>
+
+
+class QCheckBox;
+class QComboBox;
+class QLabel;
+class QProgressBar;
+class QPushButton;
+class QSpinBox;
+class QTextBrowser;
+
+class FileSelector;
+
+
+//! Converts the textures of the files in a FileQueue, one file at a time
+class TextureBatchThread final : public QThread
+{
+	Q_OBJECT
+
+public:
+	TextureBatchThread( QObject * o, FileQueue * q );
+	~TextureBatchThread();
+
+	//! Export embedded textures next to each file, or embed external ones
+	bool exportTextures = true;
+	bool compress = false;
+	TextureExistsPolicy exists = TEXTURE_EXISTS_SKIP;
+
+signals:
+	void sigStart( const QString & file );
+	void sigReady( const QString & result );
+	//! Counts of the textures converted and attempted in one file
+	void sigConverted( int converted, int total );
+
+protected:
+	void run() override final;
+
+	FileQueue * queue;
+
+	QMutex quit;
+};
+
+//! The batch texture conversion widget, exports or embeds the textures of all NIFs in a folder
+class TextureBatch final : public QWidget
+{
+	Q_OBJECT
+
+public:
+	TextureBatch();
+	~TextureBatch();
+
+	static TextureBatch * create();
+
+protected slots:
+	void run();
+
+	void threadStarted();
+	void threadFinished();
+	void onConverted( int converted, int total );
+
+protected:
+	void closeEvent( QCloseEvent * ) override final;
+
+	FileSelector * directory;
+	QCheckBox * recursive;
+	QComboBox * direction;
+	QCheckBox * compress;
+	QComboBox * exists;
+	QSpinBox * count;
+	QTextBrowser * text;
+	QProgressBar * progress;
+	QLabel * label;
+	QPushButton * btRun;
+
+	FileQueue queue;
+
+	QList<TextureBatchThread *> threads;
+
+	QDateTime time;
+
+	int filesChanged = 0;
+	int texturesConverted = 0;
+	int texturesTotal = 0;
+};
+
+#endif